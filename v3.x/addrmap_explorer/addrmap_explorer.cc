@@ -0,0 +1,377 @@
+// Address mapping explorer
+//
+// Decodes a memory address trace under many candidate DRAM address mappings 
+// (using the simulator's own linear_to_raw_address_translation) and reports
+// channel/bank load balance and row buffer locality for each of them.  This 
+// screens -gpgpu_mem_addr_mapping / -gpgpu_mem_address_mask / channel count 
+// choices in seconds instead of a full simulation per candidate. 
+//
+// Candidates are decoded through their mapping masks (addrdec_tlx_masked). 
+// The simulator's addrdec_tlx() hashes the row address into chip/bank/row and 
+// ignores the masks, so the ranking describes the mask-based mapping, not the 
+// current timing model; -hashed_decode 1 decodes as the simulator does. 
+// Candidates that decode some address to a chip beyond -gpgpu_n_mem are 
+// reported as rejected and left out of the ranking. 
+//
+// Trace format: one request per line, either a bare address (decimal or 0x 
+// hex, optionally followed by other fields) or the DRAM trace line printed by 
+// memory_partition_unit::dram_cycle() ("MEM_TRACE: <cycle>, <is_write>, <addr>").
+// Lines that match neither (e.g. the rest of the simulator output) are ignored. 
+//
+// Candidate file: one candidate per line, given as the decoder options of one 
+// memory tier exactly as they would appear in gpgpusim.config, e.g. 
+//    -gpgpu_n_mem_t1 8 -gpgpu_n_sub_partition_per_mchannel_t1 2 -gpgpu_mem_addr_mapping_t1 dramid@8;00000000.00000000.00000000.00000000.0000RRRR.RRRRRRRR.BBBCCCCB.CCSSSSSS
+// '#' starts a comment.  Without a candidate file, the decoder options given on 
+// the command line form the only candidate.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "../src/option_parser.h"
+#include "../src/gpgpu-sim/addrdec.h"
+#include "../src/gpgpu-sim/histogram.h"
+
+// tool options 
+static char *g_trace_filename; 
+static char *g_candidate_filename; 
+static unsigned g_tier; 
+static unsigned g_n_threads; 
+static bool g_print_bank_hist; 
+static bool g_hashed_decode; 
+
+class mapping_candidate {
+public:
+   mapping_candidate( unsigned id, const std::string &options ) 
+      : m_id(id), m_options(options), 
+        m_row_hits_per_activation("row_hits_per_activation") 
+   {
+      m_n_req = 0; 
+      m_n_write = 0; 
+      m_n_row_hit = 0; 
+      m_n_row_conflict = 0; 
+      m_n_activation = 0; 
+      m_rejected = false; 
+   }
+
+   void reg_options( option_parser_t opp, const char *num_str )
+   {
+      option_parser_register_mem(opp, "-gpgpu_n_mem", OPT_UINT32, &m_n_mem, 
+                   "number of memory modules (e.g. memory controllers) in gpu",
+                   "8", num_str);
+      option_parser_register_mem(opp, "-gpgpu_n_sub_partition_per_mchannel", OPT_UINT32, &m_n_sub_partition_per_memory_channel, 
+                   "number of memory subpartition in each memory module",
+                   "1", num_str);
+      m_address_mapping.addrdec_setoption(opp, num_str);
+   }
+
+   void init()
+   {
+      printf("Candidate %u: %s\n", m_id, m_options.c_str()); 
+      m_address_mapping.init(m_n_mem, m_n_sub_partition_per_memory_channel); 
+      m_n_bank = m_address_mapping.num_bank(); 
+      m_channel_hist.assign(m_n_mem, 0); 
+      m_bank_hist.assign(m_n_mem * m_n_bank, 0); 
+      m_open_row.assign(m_n_mem * m_n_bank, (unsigned)-1); 
+      m_open_row_hits.assign(m_n_mem * m_n_bank, 0); 
+   }
+
+   // replay the trace in order through an open-row policy per bank; a mapping 
+   // that decodes an address to a chip beyond -gpgpu_n_mem (more chip bits in 
+   // the mask than the channel count has) is rejected 
+   void run( const std::vector<new_addr_type> &trace, const std::vector<bool> &is_write )
+   {
+      for (size_t n = 0; n < trace.size(); n++) {
+         addrdec_t tlx; 
+         if (g_hashed_decode) 
+            m_address_mapping.addrdec_tlx(trace[n], &tlx); 
+         else 
+            m_address_mapping.addrdec_tlx_masked(trace[n], &tlx); 
+         if (tlx.chip >= m_n_mem) {
+            m_rejected = true; 
+            m_rejected_addr = trace[n]; 
+            m_rejected_chip = tlx.chip; 
+            return; 
+         }
+         unsigned bank = tlx.chip * m_n_bank + tlx.bk; 
+
+         m_n_req++; 
+         if (is_write[n]) m_n_write++; 
+         m_channel_hist[tlx.chip]++; 
+         m_bank_hist[bank]++; 
+
+         if (m_open_row[bank] == tlx.row) {
+            m_n_row_hit++; 
+            m_open_row_hits[bank]++; 
+         } else {
+            if (m_open_row[bank] != (unsigned)-1) {
+               m_n_row_conflict++; 
+               m_row_hits_per_activation.add2bin(m_open_row_hits[bank]); 
+            }
+            m_n_activation++; 
+            m_open_row[bank] = tlx.row; 
+            m_open_row_hits[bank] = 0; 
+         }
+      }
+      // close the rows still open at the end of the trace 
+      for (unsigned b = 0; b < m_open_row.size(); b++) {
+         if (m_open_row[b] != (unsigned)-1) 
+            m_row_hits_per_activation.add2bin(m_open_row_hits[b]); 
+      }
+   }
+
+   float row_hit_rate() const { return (m_n_req)? (float)m_n_row_hit / m_n_req : 0.0f; }
+   float channel_imbalance() const { return imbalance(m_channel_hist); }
+   float bank_imbalance() const { return imbalance(m_bank_hist); }
+   bool rejected() const { return m_rejected; }
+   unsigned id() const { return m_id; }
+   const std::string &options() const { return m_options; }
+
+   void print( FILE *fout ) const 
+   {
+      fprintf(fout, "Candidate %u: %s\n", m_id, m_options.c_str()); 
+      if (m_rejected) {
+         fprintf(fout, "   rejected: address 0x%llx decodes to chip %u of %u\n", 
+                 m_rejected_addr, m_rejected_chip, m_n_mem); 
+         return; 
+      }
+      fprintf(fout, "   n_req = %llu (write = %llu)\n", m_n_req, m_n_write); 
+      fprintf(fout, "   row_buffer_hit = %llu (%.4f)\n", m_n_row_hit, row_hit_rate()); 
+      fprintf(fout, "   row_buffer_conflict = %llu\n", m_n_row_conflict); 
+      fprintf(fout, "   row_activation = %llu\n", m_n_activation); 
+      fprintf(fout, "   channel_imbalance (max/avg) = %.4f\n", channel_imbalance()); 
+      fprintf(fout, "   bank_imbalance (max/avg) = %.4f\n", bank_imbalance()); 
+      fprintf(fout, "   channel_hist = "); 
+      for (unsigned c = 0; c < m_channel_hist.size(); c++) 
+         fprintf(fout, "%llu ", m_channel_hist[c]); 
+      fprintf(fout, "\n"); 
+      if (g_print_bank_hist) {
+         for (unsigned c = 0; c < m_n_mem; c++) {
+            fprintf(fout, "   bank_hist[%u] = ", c); 
+            for (unsigned b = 0; b < m_n_bank; b++) 
+               fprintf(fout, "%llu ", m_bank_hist[c * m_n_bank + b]); 
+            fprintf(fout, "\n"); 
+         }
+      }
+      fprintf(fout, "   "); 
+      m_row_hits_per_activation.fprint(fout); 
+      fprintf(fout, "\n"); 
+   }
+
+private:
+   static float imbalance( const std::vector<unsigned long long> &hist ) 
+   {
+      unsigned long long max = 0, sum = 0; 
+      for (unsigned i = 0; i < hist.size(); i++) {
+         max = std::max(max, hist[i]); 
+         sum += hist[i]; 
+      }
+      return (sum)? (float)max * hist.size() / sum : 0.0f; 
+   }
+
+   unsigned m_id; 
+   std::string m_options; 
+
+   unsigned m_n_mem; 
+   unsigned m_n_sub_partition_per_memory_channel; 
+   unsigned m_n_bank; 
+   linear_to_raw_address_translation m_address_mapping; 
+
+   unsigned long long m_n_req; 
+   unsigned long long m_n_write; 
+   unsigned long long m_n_row_hit; 
+   unsigned long long m_n_row_conflict; 
+   unsigned long long m_n_activation; 
+   bool m_rejected; 
+   new_addr_type m_rejected_addr; 
+   unsigned m_rejected_chip; 
+   std::vector<unsigned long long> m_channel_hist; 
+   std::vector<unsigned long long> m_bank_hist;      // [chip * n_bank + bank]
+   std::vector<unsigned> m_open_row;                 // [chip * n_bank + bank]
+   std::vector<unsigned> m_open_row_hits;            // [chip * n_bank + bank]
+   pow2_histogram m_row_hits_per_activation; 
+};
+
+static bool compare_row_hit_rate( const mapping_candidate *a, const mapping_candidate *b )
+{
+   return a->row_hit_rate() > b->row_hit_rate(); 
+}
+
+static void read_trace( const char *filename, std::vector<new_addr_type> &trace, std::vector<bool> &is_write )
+{
+   FILE *fp = fopen(filename, "r"); 
+   if (fp == NULL) {
+      fprintf(stderr, "ERROR: Cannot open address trace '%s'\n", filename); 
+      exit(1); 
+   }
+   char line[1024]; 
+   while (fgets(line, sizeof(line), fp)) {
+      const char *mem_trace = strstr(line, "MEM_TRACE:"); 
+      if (mem_trace != NULL) {
+         unsigned long long cycle, addr; 
+         int write; 
+         if (sscanf(mem_trace, "MEM_TRACE: %llu, %d, %llu", &cycle, &write, &addr) == 3) {
+            trace.push_back(addr); 
+            is_write.push_back(write != 0); 
+         }
+      } else if (line[0] >= '0' and line[0] <= '9') {
+         trace.push_back(strtoull(line, NULL, 0)); 
+         is_write.push_back(false); 
+      }
+   }
+   fclose(fp); 
+}
+
+static void read_candidates( const char *filename, std::vector<std::string> &candidates )
+{
+   FILE *fp = fopen(filename, "r"); 
+   if (fp == NULL) {
+      fprintf(stderr, "ERROR: Cannot open candidate file '%s'\n", filename); 
+      exit(1); 
+   }
+   char line[4096]; 
+   while (fgets(line, sizeof(line), fp)) {
+      std::string options(line); 
+      size_t comment = options.find('#'); 
+      if (comment != std::string::npos) 
+         options.erase(comment); 
+      size_t first = options.find_first_not_of(" \t\r\n"); 
+      if (first == std::string::npos) continue; 
+      size_t last = options.find_last_not_of(" \t\r\n"); 
+      candidates.push_back(options.substr(first, last - first + 1)); 
+   }
+   fclose(fp); 
+}
+
+struct explorer_thread_arg {
+   unsigned thread_id; 
+   std::vector<mapping_candidate*> *candidates; 
+   const std::vector<new_addr_type> *trace; 
+   const std::vector<bool> *is_write; 
+}; 
+
+static void *explorer_thread( void *ptr )
+{
+   explorer_thread_arg *arg = (explorer_thread_arg*) ptr; 
+   std::vector<mapping_candidate*> &candidates = *(arg->candidates); 
+   for (unsigned c = arg->thread_id; c < candidates.size(); c += g_n_threads) 
+      candidates[c]->run(*(arg->trace), *(arg->is_write)); 
+   return NULL; 
+}
+
+int main( int argc, const char *argv[] )
+{
+   char num_str[16]; 
+
+   option_parser_t opp = option_parser_create(); 
+   option_parser_register(opp, "-trace", OPT_CSTR, &g_trace_filename, 
+                          "address trace to decode (bare addresses or MEM_TRACE lines)", NULL); 
+   option_parser_register(opp, "-candidates", OPT_CSTR, &g_candidate_filename, 
+                          "file with one candidate address mapping (decoder options) per line", NULL); 
+   option_parser_register(opp, "-tier", OPT_UINT32, &g_tier, 
+                          "memory tier whose option names (_t<tier>) the candidates use", "1"); 
+   option_parser_register(opp, "-threads", OPT_UINT32, &g_n_threads, 
+                          "number of worker threads (0 = one per online cpu)", "0"); 
+   option_parser_register(opp, "-print_bank_hist", OPT_BOOL, &g_print_bank_hist, 
+                          "print the per-bank request histogram of each candidate", "0"); 
+   option_parser_register(opp, "-hashed_decode", OPT_BOOL, &g_hashed_decode, 
+                          "decode with the simulator's row hash (ignores the mapping masks)", "0"); 
+   option_parser_register(opp, "-gpgpu_mem_addr_fast_row_hash", OPT_BOOL, &g_addrdec_fast_row_hash, 
+                          "row hash without reseeding the C library generator (with -hashed_decode)", "0"); 
+
+   // command line decoder options form the candidate used when no candidate file is given
+   std::vector<mapping_candidate*> candidates; 
+   mapping_candidate *cmdline_candidate = new mapping_candidate(0, "(command line)"); 
+   // peek the tier before registering the decoder options under its suffix 
+   for (int i = 1; i + 1 < argc; i++) 
+      if (strcmp(argv[i], "-tier") == 0) 
+         g_tier = atoi(argv[i + 1]); 
+   if (g_tier == 0) g_tier = 1; 
+   snprintf(num_str, sizeof(num_str), "%u", g_tier); 
+   cmdline_candidate->reg_options(opp, num_str); 
+   option_parser_cmdline(opp, argc, argv); 
+
+   if (g_trace_filename == NULL) {
+      fprintf(stderr, "usage: %s -trace <address trace> [-candidates <file>] [-tier <n>] [-threads <n>] [decoder options]\n", argv[0]); 
+      option_parser_print(opp, stderr); 
+      exit(1); 
+   }
+   if (g_n_threads == 0) 
+      g_n_threads = sysconf(_SC_NPROCESSORS_ONLN); 
+   if (g_hashed_decode) {
+      // addrdec_tlx() reseeds the C library generator, shared by all threads, 
+      // unless -gpgpu_mem_addr_fast_row_hash is set (glibc only) 
+#ifdef __GLIBC__
+      if (!g_addrdec_fast_row_hash) g_n_threads = 1; 
+#else
+      g_n_threads = 1; 
+#endif
+      printf("WARNING: -hashed_decode ignores -gpgpu_mem_addr_mapping and -gpgpu_mem_address_mask; "
+             "candidates differing only in those score identically\n"); 
+   }
+
+   if (g_candidate_filename) {
+      delete cmdline_candidate; 
+      std::vector<std::string> candidate_options; 
+      read_candidates(g_candidate_filename, candidate_options); 
+      for (unsigned c = 0; c < candidate_options.size(); c++) {
+         mapping_candidate *candidate = new mapping_candidate(c, candidate_options[c]); 
+         option_parser_t copp = option_parser_create(); 
+         candidate->reg_options(copp, num_str); 
+         option_parser_delimited_string(copp, candidate_options[c].c_str(), " \t"); 
+         option_parser_destroy(copp); 
+         candidates.push_back(candidate); 
+      }
+   } else {
+      candidates.push_back(cmdline_candidate); 
+   }
+   option_parser_destroy(opp); 
+
+   // decoder init prints and is not thread-safe: do it up front 
+   for (unsigned c = 0; c < candidates.size(); c++) 
+      candidates[c]->init(); 
+
+   std::vector<new_addr_type> trace; 
+   std::vector<bool> is_write; 
+   read_trace(g_trace_filename, trace, is_write); 
+   printf("\nDecoding %zu requests under %zu candidate mappings with %u threads\n\n", 
+          trace.size(), candidates.size(), g_n_threads); 
+
+   std::vector<pthread_t> threads(g_n_threads); 
+   std::vector<explorer_thread_arg> args(g_n_threads); 
+   for (unsigned t = 0; t < g_n_threads; t++) {
+      args[t].thread_id = t; 
+      args[t].candidates = &candidates; 
+      args[t].trace = &trace; 
+      args[t].is_write = &is_write; 
+      pthread_create(&threads[t], NULL, explorer_thread, &args[t]); 
+   }
+   for (unsigned t = 0; t < g_n_threads; t++) 
+      pthread_join(threads[t], NULL); 
+
+   for (unsigned c = 0; c < candidates.size(); c++) 
+      candidates[c]->print(stdout); 
+
+   // ranking by row buffer locality 
+   std::vector<mapping_candidate*> ranking; 
+   for (unsigned c = 0; c < candidates.size(); c++) 
+      if (!candidates[c]->rejected()) 
+         ranking.push_back(candidates[c]); 
+   std::stable_sort(ranking.begin(), ranking.end(), compare_row_hit_rate); 
+   printf("\nRanking (row_buffer_hit_rate channel_imbalance bank_imbalance candidate):\n"); 
+   for (unsigned c = 0; c < ranking.size(); c++) {
+      printf("%4u: %.4f %.4f %.4f %u %s\n", c, ranking[c]->row_hit_rate(), 
+             ranking[c]->channel_imbalance(), ranking[c]->bank_imbalance(), 
+             ranking[c]->id(), ranking[c]->options().c_str()); 
+   }
+
+   for (unsigned c = 0; c < candidates.size(); c++) 
+      delete candidates[c]; 
+   return 0; 
+}
@@ -922,6 +922,7 @@ __host__ cudaError_t CUDARTAPI cudaLaunch( const char *hostFun )
 	dim3 blockDim = config.block_dim();
 	printf("GPGPU-Sim PTX: pushing kernel \'%s\' to stream %u, gridDim= (%u,%u,%u) blockDim = (%u,%u,%u) \n",
 			kname.c_str(), stream?stream->get_uid():0, gridDim.x,gridDim.y,gridDim.z,blockDim.x,blockDim.y,blockDim.z );
+	gpgpu_sweep_fork(); // no-op unless -gpgpu_sweep
 	stream_operation op(grid,g_ptx_sim_mode,stream);
 	g_stream_manager->push(op);
 	g_cuda_launch_stack.pop_back();
@@ -1038,8 +1039,7 @@ __host__ cudaError_t CUDARTAPI cudaEventSynchronize(cudaEvent_t event)
 	printf("GPGPU-Sim API: cudaEventSynchronize ** waiting for event\n");
 	fflush(stdout);
 	CUevent_st *e = (CUevent_st*) event;
-	while( !e->done() )
-		;
+	g_stream_manager->wait_for_event(e);
 	printf("GPGPU-Sim API: cudaEventSynchronize ** event detected\n");
 	fflush(stdout);
 	return g_last_cudaError = cudaSuccess;
@@ -1298,43 +1298,51 @@ void extract_code_using_cuobjdump(){
 
    std::string app_binary = get_app_binary(); 
 
-	char fname[1024];
-	snprintf(fname,1024,"_cuobjdump_complete_output_XXXXXX");
-	int fd=mkstemp(fname);
-	close(fd);
-	// Running cuobjdump using dynamic link to current process
-	snprintf(command,1000,"md5sum %s ", app_binary.c_str());
-	printf("Running md5sum using \"%s\"\n", command);
-	system(command);
-	// Running cuobjdump using dynamic link to current process
-	snprintf(command,1000,"$CUDA_INSTALL_PATH/bin/cuobjdump -ptx -elf -sass %s > %s", app_binary.c_str(), fname);
-	printf("Running cuobjdump using \"%s\"\n", command);
-	bool parse_output = true; 
-	int result = system(command);
-	if(result) {
-		if (context->get_device()->get_gpgpu()->get_config().experimental_lib_support() && (result == 65280)) {  
-			// Some CUDA application may exclusively use kernels provided by CUDA
-			// libraries (e.g. CUBLAS).  Skipping cuobjdump extraction from the
-			// executable for this case. 
-			// 65280 is the return code from cuobjdump denoting the specific error (tested on CUDA 4.0/4.1/4.2)
-			printf("WARNING: Failed to execute: %s\n", command); 
-			printf("         Executable binary does not contain any GPU kernel.\n"); 
-			parse_output = false; 
-		} else {
-			printf("ERROR: Failed to execute: %s\n", command); 
-			exit(1);
-		}
-	}
-
-	if (parse_output) {
-		printf("Parsing file %s\n", fname);
-		cuobjdump_in = fopen(fname, "r");
-
+	// a cached output for this binary (-gpgpu_ptxinfo_cache_dir) skips cuobjdump
+	std::string cache_file = cuobjdump_cache_file(app_binary.c_str());
+	cuobjdump_in = cache_file.empty()? NULL : fopen(cache_file.c_str(), "r");
+	if (cuobjdump_in) {
+		printf("Parsing cached cuobjdump output %s\n", cache_file.c_str());
 		cuobjdump_parse();
 		fclose(cuobjdump_in);
 		printf("Done parsing!!!\n");
 	} else {
-		printf("Parsing skipped for %s\n", fname); 
+		char fname[1024];
+		snprintf(fname,1024,"_cuobjdump_complete_output_XXXXXX");
+		int fd=mkstemp(fname);
+		close(fd);
+		// Running cuobjdump using dynamic link to current process
+		snprintf(command,1000,"$CUDA_INSTALL_PATH/bin/cuobjdump -ptx -elf -sass %s > %s", app_binary.c_str(), fname);
+		printf("Running cuobjdump using \"%s\"\n", command);
+		bool parse_output = true; 
+		int result = system(command);
+		if(result) {
+			if (context->get_device()->get_gpgpu()->get_config().experimental_lib_support() && (result == 65280)) {  
+				// Some CUDA application may exclusively use kernels provided by CUDA
+				// libraries (e.g. CUBLAS).  Skipping cuobjdump extraction from the
+				// executable for this case. 
+				// 65280 is the return code from cuobjdump denoting the specific error (tested on CUDA 4.0/4.1/4.2)
+				printf("WARNING: Failed to execute: %s\n", command); 
+				printf("         Executable binary does not contain any GPU kernel.\n"); 
+				parse_output = false; 
+			} else {
+				printf("ERROR: Failed to execute: %s\n", command); 
+				exit(1);
+			}
+		}
+
+		if (parse_output) {
+			if (!cache_file.empty())
+				cuobjdump_cache_store(fname, cache_file);
+			printf("Parsing file %s\n", fname);
+			cuobjdump_in = fopen(fname, "r");
+
+			cuobjdump_parse();
+			fclose(cuobjdump_in);
+			printf("Done parsing!!!\n");
+		} else {
+			printf("Parsing skipped for %s\n", fname); 
+		}
 	}
 
 	if (context->get_device()->get_gpgpu()->get_config().experimental_lib_support()){
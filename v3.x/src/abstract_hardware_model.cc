@@ -72,6 +72,14 @@ void gpgpu_functional_sim_config::reg_options(class OptionParser * opp)
                  &m_ptx_force_max_capability,
                  "Force maximum compute capability",
                  "0");
+    option_parser_register(opp, "-gpgpu_ptx_warp_exec", OPT_BOOL,
+                 &m_ptx_warp_exec,
+                 "Execute simple ALU instructions for a whole warp at once in the functional model",
+                 "1");
+    option_parser_register(opp, "-gpgpu_global_mem_mmap", OPT_BOOL,
+                 &m_global_mem_mmap,
+                 "Back the device heap of global memory with one sparse anonymous mmap",
+                 "0");
    option_parser_register(opp, "-gpgpu_ptx_inst_debug_to_file", OPT_BOOL, 
                 &g_ptx_inst_debug_to_file, 
                 "Dump executed instructions' debug information to file", 
@@ -92,7 +100,10 @@ void gpgpu_functional_sim_config::ptx_set_tex_cache_linesize(unsigned linesize)
 gpgpu_t::gpgpu_t( const gpgpu_functional_sim_config &config )
     : m_function_model_config(config)
 {
-   m_global_mem = new memory_space_impl<8192>("global",64*1024);
+   if( config.global_mem_mmap() )
+      m_global_mem = new memory_space_mmap("global",64*1024);
+   else
+      m_global_mem = new memory_space_impl<8192>("global",64*1024);
    m_tex_mem = new memory_space_impl<8192>("tex",64*1024);
    m_surf_mem = new memory_space_impl<8192>("surf",64*1024);
 
@@ -123,6 +134,31 @@ const char * mem_access_type_str(enum mem_access_type access_type)
    return access_type_str[access_type]; 
 }
 
+void inst_t::compute_reg_mask()
+{
+    int regs[MAX_REG_MASK_WORDS] = { (int)out[0], (int)out[1], (int)out[2], (int)out[3],
+                                     (int)in[0], (int)in[1], (int)in[2], (int)in[3],
+                                     pred, ar1, ar2 };
+    n_reg_mask = 0;
+    for( unsigned r=0; r < MAX_REG_MASK_WORDS; r++ ) {
+        if( regs[r] <= 0 ) 
+            continue;
+        unsigned word = regs[r] / 64;
+        unsigned long long bit = 1ULL << (regs[r] % 64);
+        unsigned w;
+        for( w=0; w < n_reg_mask; w++ ) {
+            if( reg_mask[w].word == word ) 
+                break;
+        }
+        if( w == n_reg_mask ) {
+            reg_mask[w].word = word;
+            reg_mask[w].bits = 0;
+            n_reg_mask++;
+        }
+        reg_mask[w].bits |= bit;
+    }
+    reg_mask_valid = true;
+}
 
 void warp_inst_t::clear_active( const active_mask_t &inactive ) {
     active_mask_t test = m_warp_active_mask;
@@ -748,10 +784,18 @@ void simt_stack::update( simt_mask_t &thread_done, addr_vector_t &next_pc, addre
 
 void core_t::execute_warp_inst_t(warp_inst_t &inst, unsigned warpId)
 {
+    if(warpId==(unsigned (-1)))
+        warpId = inst.warp_id();
+    active_mask_t active = inst.get_active_mask();
+    if( ptx_thread_info::ptx_exec_warp_inst(&m_thread[m_warp_size*warpId],inst,m_warp_size) ) {
+        for ( unsigned t=0; t < m_warp_size; t++ ) {
+            if( active.test(t) )
+                checkExecutionStatusAndUpdate(inst,t,m_warp_size*warpId+t);
+        }
+        return;
+    }
     for ( unsigned t=0; t < m_warp_size; t++ ) {
         if( inst.active(t) ) {
-            if(warpId==(unsigned (-1)))
-                warpId = inst.warp_id();
             unsigned tid=m_warp_size*warpId+t;
             m_thread[tid]->ptx_exec_inst(inst,t);
             
@@ -407,6 +407,8 @@ public:
     const char* get_ptx_inst_debug_file() const  { return g_ptx_inst_debug_file; }
     int         get_ptx_inst_debug_thread_uid() const { return g_ptx_inst_debug_thread_uid; }
     unsigned    get_texcache_linesize() const { return m_texcache_linesize; }
+    bool        warp_exec() const { return m_ptx_warp_exec; }
+    bool        global_mem_mmap() const { return m_global_mem_mmap; }
 
 private:
     // PTX options
@@ -414,6 +416,8 @@ private:
     int m_ptx_use_cuobjdump;
     int m_experimental_lib_support;
     unsigned m_ptx_force_max_capability;
+    int m_ptx_warp_exec;
+    int m_global_mem_mmap;
 
     int   g_ptx_inst_debug_to_file;
     char* g_ptx_inst_debug_file;
@@ -682,6 +686,7 @@ public:
 
 // the maximum number of destination, source, or address uarch operands in a instruction
 #define MAX_REG_OPERANDS 8
+#define MAX_REG_MASK_WORDS 11 // out[4], in[4], pred, ar1, ar2
 
 struct dram_callback_t {
    dram_callback_t() { function=NULL; instruction=NULL; thread=NULL; }
@@ -717,6 +722,8 @@ public:
             arch_reg.dst[i] = -1;
         }
         isize=0;
+        n_reg_mask=0;
+        reg_mask_valid=false;
     }
     bool valid() const { return m_decoded; }
     virtual void print_insn( FILE *fp ) const 
@@ -755,6 +762,18 @@ public:
         int src[MAX_REG_OPERANDS];
     } arch_reg;
     //int arch_reg[MAX_REG_OPERANDS]; // register number for bank conflict evaluation
+
+    // Registers read or written by this instruction (out, in, pred, ar1, ar2)
+    // as a sparse bitmask with one entry per 64-register word, so that the
+    // scoreboard can test it with a few ANDs. Built by compute_reg_mask().
+    struct reg_mask_word {
+        unsigned word;
+        unsigned long long bits;
+    };
+    reg_mask_word reg_mask[MAX_REG_MASK_WORDS];
+    unsigned n_reg_mask;
+    bool reg_mask_valid;
+    void compute_reg_mask();
     unsigned latency; // operation latency 
     unsigned initiation_interval;
 
@@ -270,6 +270,8 @@ void function_info::ptx_assemble()
       print_ipostdominators();
    }
 
+   allocate_frame_registers();
+
    printf("GPGPU-Sim PTX: pre-decoding instructions for \'%s\'...\n", m_name.c_str() );
    for ( unsigned ii=0; ii < n; ii += m_instr_mem[ii]->inst_size() ) { // handle branch instructions
       ptx_instruction *pI = m_instr_mem[ii];
@@ -407,9 +409,7 @@ void gpgpu_t::memcpy_to_gpu( size_t dst_start_addr, const void *src, size_t coun
       printf("GPGPU-Sim PTX: copying %zu bytes from CPU[0x%Lx] to GPU[0x%Lx] ... ", count, (unsigned long long) src, (unsigned long long) dst_start_addr );
       fflush(stdout);
    }
-   char *src_data = (char*)src;
-   for (unsigned n=0; n < count; n ++ ) 
-      m_global_mem->write(dst_start_addr+n,1, src_data+n,NULL,NULL);
+   m_global_mem->write(dst_start_addr,count,src,NULL,NULL);
    if(g_debug_execution >= 3) {
       printf( " done.\n");
       fflush(stdout);
@@ -422,9 +422,7 @@ void gpgpu_t::memcpy_from_gpu( void *dst, size_t src_start_addr, size_t count )
       printf("GPGPU-Sim PTX: copying %zu bytes from GPU[0x%Lx] to CPU[0x%Lx] ...", count, (unsigned long long) src_start_addr, (unsigned long long) dst );
       fflush(stdout);
    }
-   unsigned char *dst_data = (unsigned char*)dst;
-   for (unsigned n=0; n < count; n ++ ) 
-      m_global_mem->read(src_start_addr+n,1,dst_data+n);
+   m_global_mem->read(src_start_addr,count,dst);
    if(g_debug_execution >= 3) {
       printf( " done.\n");
       fflush(stdout);
@@ -438,11 +436,7 @@ void gpgpu_t::memcpy_gpu_to_gpu( size_t dst, size_t src, size_t count )
           (unsigned long long) src, (unsigned long long) dst );
       fflush(stdout);
    }
-   for (unsigned n=0; n < count; n ++ ) {
-      unsigned char tmp;
-      m_global_mem->read(src+n,1,&tmp); 
-      m_global_mem->write(dst+n,1, &tmp,NULL,NULL);
-   }
+   m_global_mem->copy(dst,src,count);
    if(g_debug_execution >= 3) {
       printf( " done.\n");
       fflush(stdout);
@@ -456,9 +450,7 @@ void gpgpu_t::gpu_memset( size_t dst_start_addr, int c, size_t count )
           count, (unsigned char) c, (unsigned long long) dst_start_addr );
       fflush(stdout);
    }
-   unsigned char c_value = (unsigned char)c;
-   for (unsigned n=0; n < count; n ++ ) 
-      m_global_mem->write(dst_start_addr+n,1,&c_value,NULL,NULL);
+   m_global_mem->fill(dst_start_addr,count,(unsigned char)c);
    if(g_debug_execution >= 3) {
       printf( " done.\n");
       fflush(stdout);
@@ -809,8 +801,30 @@ static unsigned datatype2size( unsigned data_type )
    return data_size; 
 }
 
+static const ptx_exec_fn g_ptx_exec_fn[NUM_OPCODES] = {
+#define OP_DEF(OP,FUNC,STR,DST,CLASSIFICATION) FUNC,
+#include "opcodes.def"
+#undef OP_DEF
+};
+
+static const int g_ptx_op_classification[NUM_OPCODES] = {
+#define OP_DEF(OP,FUNC,STR,DST,CLASSIFICATION) CLASSIFICATION,
+#include "opcodes.def"
+#undef OP_DEF
+};
+
 void ptx_instruction::pre_decode()
 {
+   if ( m_opcode >= 0 && m_opcode < NUM_OPCODES ) {
+      m_exec_fn = g_ptx_exec_fn[m_opcode];
+      m_op_classification = g_ptx_op_classification[m_opcode];
+   }
+   m_pred_is_reg = m_pred != NULL && m_pred->is_reg();
+   for ( unsigned o=0; o < m_operands.size(); o++ )
+      m_operands[o].pre_decode();
+   m_return_var.pre_decode();
+   m_warp_kernel = ptx_warp_kernel(this);
+
    pc = m_PC;
    isize = m_inst_size;
    for( unsigned i=0; i<4; i++) {
@@ -963,6 +977,8 @@ void ptx_instruction::pre_decode()
    // get reconvergence pc
    reconvergence_pc = get_converge_point(pc);
 
+   compute_reg_mask();
+
    m_decoded=true;
 }
 
@@ -1179,6 +1195,60 @@ static unsigned get_tex_datasize( const ptx_instruction *pI, ptx_thread_info *th
    return data_size; 
 }
 
+bool ptx_thread_info::pred_skip( const ptx_instruction *pI )
+{
+   ptx_reg_t pred_value;
+   if( pI->pred_is_reg() ) {
+      pred_value = get_reg(pI->get_pred_symbol());
+   } else {
+      const operand_info &pred = pI->get_pred();
+      pred_value = get_operand_value(pred, pred, PRED_TYPE, this, 0);
+   }
+   if(pI->get_pred_mod() == -1)
+      return (pred_value.pred & 0x0001) ^ pI->get_pred_neg(); //ptxplus inverts the zero flag
+   return !pred_lookup(pI->get_pred_mod(), pred_value.pred & 0x000F);
+}
+
+void ptx_thread_info::count_inst( const ptx_instruction *pI, int op_classification )
+{
+   g_ptx_sim_num_insn++;
+   
+   //not using it with functional simulation mode
+   if(!(this->m_functionalSimulationMode))
+       ptx_file_line_stats_add_exec_count(pI);
+   if(g_ptx_bbv_enabled)
+       ptx_bbv_add_exec_count(pI);
+   
+   if ( gpgpu_ptx_instruction_classification ) {
+      init_inst_classification_stat();
+      unsigned space_type=0;
+      switch ( pI->get_space().get_type() ) {
+      case global_space: space_type = 10; break;
+      case local_space:  space_type = 11; break; 
+      case tex_space:    space_type = 12; break; 
+      case surf_space:   space_type = 13; break; 
+      case param_space_kernel:
+      case param_space_local:
+                         space_type = 14; break; 
+      case shared_space: space_type = 15; break; 
+      case const_space:  space_type = 16; break;
+      default: 
+         space_type = 0 ;
+         break;
+      }
+      StatAddSample( g_inst_classification_stat[g_ptx_kernel_count],  op_classification);
+      if (space_type) StatAddSample( g_inst_classification_stat[g_ptx_kernel_count], ( int )space_type);
+      StatAddSample( g_inst_op_classification_stat[g_ptx_kernel_count], (int)  pI->get_opcode() );
+   }
+   if ( (g_ptx_sim_num_insn % 100000) == 0 ) {
+      dim3 ctaid = get_ctaid();
+      dim3 tid = get_tid();
+      printf("GPGPU-Sim PTX: %u instructions simulated : ctaid=(%u,%u,%u) tid=(%u,%u,%u)\n",
+             g_ptx_sim_num_insn, ctaid.x,ctaid.y,ctaid.z,tid.x,tid.y,tid.z );
+      fflush(stdout);
+   }
+}
+
 void ptx_thread_info::ptx_exec_inst( warp_inst_t &inst, unsigned lane_id)
 {
     
@@ -1210,15 +1280,8 @@ void ptx_thread_info::ptx_exec_inst( warp_inst_t &inst, unsigned lane_id)
    }
    
    
-   if( pI->has_pred() ) {
-      const operand_info &pred = pI->get_pred();
-      ptx_reg_t pred_value = get_operand_value(pred, pred, PRED_TYPE, this, 0);
-      if(pI->get_pred_mod() == -1) {
-            skip = (pred_value.pred & 0x0001) ^ pI->get_pred_neg(); //ptxplus inverts the zero flag
-      } else {
-            skip = !pred_lookup(pI->get_pred_mod(), pred_value.pred & 0x000F);
-      }
-   }
+   if( pI->has_pred() )
+      skip = pred_skip(pI);
    
    if( skip ) {
       inst.set_not_active(lane_id);
@@ -1230,11 +1293,12 @@ void ptx_thread_info::ptx_exec_inst( warp_inst_t &inst, unsigned lane_id)
          *((warp_inst_t*)pJ) = inst; // copy active mask information
          pI = pJ;
       }
-      switch ( pI->get_opcode() ) {
-#define OP_DEF(OP,FUNC,STR,DST,CLASSIFICATION) case OP: FUNC(pI,this); op_classification = CLASSIFICATION; break;
-#include "opcodes.def"
-#undef OP_DEF
-      default: printf( "Execution error: Invalid opcode (0x%x)\n", pI->get_opcode() ); break;
+      ptx_exec_fn exec_fn = pI->get_exec_fn();
+      if( exec_fn ) {
+         exec_fn(pI,this);
+         op_classification = pI->get_op_classification();
+      } else {
+         printf( "Execution error: Invalid opcode (0x%x)\n", pI->get_opcode() );
       }
       delete pJ;
       pI = pI_saved;
@@ -1314,40 +1378,7 @@ void ptx_thread_info::ptx_exec_inst( warp_inst_t &inst, unsigned lane_id)
          dump_regs(stdout);
    }
    update_pc();
-   g_ptx_sim_num_insn++;
-   
-   //not using it with functional simulation mode
-   if(!(this->m_functionalSimulationMode))
-       ptx_file_line_stats_add_exec_count(pI);
-   
-   if ( gpgpu_ptx_instruction_classification ) {
-      init_inst_classification_stat();
-      unsigned space_type=0;
-      switch ( pI->get_space().get_type() ) {
-      case global_space: space_type = 10; break;
-      case local_space:  space_type = 11; break; 
-      case tex_space:    space_type = 12; break; 
-      case surf_space:   space_type = 13; break; 
-      case param_space_kernel:
-      case param_space_local:
-                         space_type = 14; break; 
-      case shared_space: space_type = 15; break; 
-      case const_space:  space_type = 16; break;
-      default: 
-         space_type = 0 ;
-         break;
-      }
-      StatAddSample( g_inst_classification_stat[g_ptx_kernel_count],  op_classification);
-      if (space_type) StatAddSample( g_inst_classification_stat[g_ptx_kernel_count], ( int )space_type);
-      StatAddSample( g_inst_op_classification_stat[g_ptx_kernel_count], (int)  pI->get_opcode() );
-   }
-   if ( (g_ptx_sim_num_insn % 100000) == 0 ) {
-      dim3 ctaid = get_ctaid();
-      dim3 tid = get_tid();
-      printf("GPGPU-Sim PTX: %u instructions simulated : ctaid=(%u,%u,%u) tid=(%u,%u,%u)\n",
-             g_ptx_sim_num_insn, ctaid.x,ctaid.y,ctaid.z,tid.x,tid.y,tid.z );
-      fflush(stdout);
-   }
+   count_inst(pI,op_classification);
    
    // "Return values"
    if(!skip) {
@@ -1640,10 +1671,8 @@ void gpgpu_ptx_sim_memcpy_symbol(const char *hostVar, const void *src, size_t co
    }
    printf("GPGPU-Sim PTX: gpgpu_ptx_sim_memcpy_symbol: copying %s memory %zu bytes %s symbol %s+%zu @0x%x ...\n", 
           mem_name, count, (to?" to ":"from"), sym_name.c_str(), offset, dst );
-   for ( unsigned n=0; n < count; n++ ) {
-      if( to ) mem->write(dst+n,1,((char*)src)+n,NULL,NULL); 
-      else mem->read(dst+n,1,((char*)src)+n); 
-   }
+   if( to ) mem->write(dst,count,src,NULL,NULL); 
+   else mem->read(dst,count,(void*)src); 
    fflush(stdout);
 }
 
@@ -1833,6 +1862,8 @@ void functionalCoreSim::executeWarp(unsigned i, bool &allAtBarrier, bool & someO
         warp_inst_t inst =getExecuteWarp(i);
         execute_warp_inst_t(inst,i);
         if(inst.isatomic()) inst.do_atomic(true);
+        if(m_gpu->warming_up() && inst.space.get_type()==global_space && (inst.is_load() || inst.is_store()))
+            m_gpu->warm_access(inst);
         if(inst.op==BARRIER_OP || inst.op==MEMORY_BARRIER_OP ) m_warpAtBarrier[i]=true;
         updateSIMTStack( i, &inst );
     }
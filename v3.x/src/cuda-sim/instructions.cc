@@ -52,17 +52,18 @@ const char *g_opcode_string[NUM_OPCODES] = {
 };
 
 void inst_not_implemented( const ptx_instruction * pI ) ;
-ptx_reg_t srcOperandModifiers(ptx_reg_t opData, operand_info opInfo, operand_info dstInfo, unsigned type, ptx_thread_info *thread);
+ptx_reg_t srcOperandModifiers(ptx_reg_t opData, const operand_info &opInfo, const operand_info &dstInfo, unsigned type, ptx_thread_info *thread);
 
 void sign_extend( ptx_reg_t &data, unsigned src_size, const operand_info &dst );
 
 void ptx_thread_info::set_reg( const symbol *reg, const ptx_reg_t &value ) 
 {
    assert( reg != NULL );
-   if( reg->name() == "_" ) return;
+   // "_" never gets a frame slot, so only registers without one need the name check
+   if( reg->frame_func() == NULL && reg->name() == "_" ) return;
    assert( !m_regs.empty() );
    assert( reg->uid() > 0 );
-   m_regs.back()[ reg ] = value;
+   m_regs.back().define(reg) = value;
    if (m_enable_debug_trace ) 
       m_debug_trace_regs_modified.back()[ reg ] = value;
    m_last_set_operand_value = value;
@@ -73,8 +74,8 @@ ptx_reg_t ptx_thread_info::get_reg( const symbol *reg )
    static bool unfound_register_warned = false;
    assert( reg != NULL );
    assert( !m_regs.empty() );
-   reg_map_t::iterator regs_iter = m_regs.back().find(reg);
-   if (regs_iter == m_regs.back().end()) {
+   ptx_reg_t *value = m_regs.back().find(reg);
+   if (value == NULL) {
       assert( reg->type()->get_key().is_reg() );
       const std::string &name = reg->name();
       unsigned call_uid = m_callstack.back().m_call_uid;
@@ -88,17 +89,24 @@ ptx_reg_t ptx_thread_info::get_reg( const symbol *reg )
                  file_loc.c_str(), name.c_str(), call_uid );
           unfound_register_warned = true;
       }
-      regs_iter = m_regs.back().find(reg);
+      value = m_regs.back().find(reg);
    }
    if (m_enable_debug_trace ) 
-      m_debug_trace_regs_read.back()[ reg ] = regs_iter->second;
-   return regs_iter->second;
+      m_debug_trace_regs_read.back()[ reg ] = *value;
+   return *value;
 }
 
-ptx_reg_t ptx_thread_info::get_operand_value( const operand_info &op, operand_info dstInfo, unsigned opType, ptx_thread_info *thread, int derefFlag )
+ptx_reg_t ptx_thread_info::get_operand_value( const operand_info &op, const operand_info &dstInfo, unsigned opType, ptx_thread_info *thread, int derefFlag )
 {
    ptx_reg_t result, tmp;
 
+   if( (opType != BB128_TYPE) && (opType != BB64_TYPE) && (opType != FF64_TYPE) ) {
+      if( op.is_predecoded_reg() ) 
+         return get_reg( op.get_symbol() );
+      if( op.is_predecoded_literal() ) 
+         return op.get_predecoded_literal();
+   }
+
 
    if(op.get_double_operand_type() == 0) {
       if(((opType != BB128_TYPE) && (opType != BB64_TYPE) && (opType != FF64_TYPE)) || (op.get_addr_space() != undefined_space)) {
@@ -333,9 +341,9 @@ void ptx_thread_info::get_vector_operand_values( const operand_info &op, ptx_reg
       const symbol *sym = NULL;
       sym = op.vec_symbol(idx);
       if( strcmp(sym->name().c_str(),"_") != 0) {
-         reg_map_t::iterator reg_iter = m_regs.back().find(sym);
-         assert( reg_iter != m_regs.back().end() );
-         ptx_regs[idx] = reg_iter->second;
+         ptx_reg_t *value = m_regs.back().find(sym);
+         assert( value != NULL );
+         ptx_regs[idx] = *value;
       }
    }
 }
@@ -371,7 +379,7 @@ void ptx_thread_info::set_operand_value( const operand_info &dst, const ptx_reg_
         ptx_reg_t predValue;
         
         const symbol *sym = dst.vec_symbol(0);
-        predValue.u64 = (m_regs.back()[ sym ].u64) & ~(0x0C);
+        predValue.u64 = (m_regs.back().define(sym).u64) & ~(0x0C);
         predValue.u64 |= ((overflow & 0x01)<<3);
         predValue.u64 |= ((carry & 0x01)<<2);
 
@@ -498,11 +506,11 @@ void ptx_thread_info::set_operand_value( const operand_info &dst, const ptx_reg_
 
           if(dst.get_operand_lohi() == 1)
           {
-              setValue.u64 = ((m_regs.back()[ regName ].u64) & (~(0xFFFF))) + (data.u64 & 0xFFFF);
+              setValue.u64 = ((m_regs.back().define(regName).u64) & (~(0xFFFF))) + (data.u64 & 0xFFFF);
           }
           else if(dst.get_operand_lohi() == 2)
           {
-              setValue.u64 = ((m_regs.back()[ regName ].u64) & (~(0xFFFF0000))) + ((data.u64<<16) & 0xFFFF0000);
+              setValue.u64 = ((m_regs.back().define(regName).u64) & (~(0xFFFF0000))) + ((data.u64<<16) & 0xFFFF0000);
           }
 
           set_reg(predName,predValue);
@@ -555,11 +563,11 @@ void ptx_thread_info::set_operand_value( const operand_info &dst, const ptx_reg_
       {
           if(dst.get_operand_lohi() == 1)
           {
-              setValue.u64 = ((m_regs.back()[ dst.get_symbol() ].u64) & (~(0xFFFF))) + (data.u64 & 0xFFFF);
+              setValue.u64 = ((m_regs.back().define(dst.get_symbol()).u64) & (~(0xFFFF))) + (data.u64 & 0xFFFF);
           }
           else if(dst.get_operand_lohi() == 2)
           {
-              setValue.u64 = ((m_regs.back()[ dst.get_symbol() ].u64) & (~(0xFFFF0000))) + ((data.u64<<16) & 0xFFFF0000);
+              setValue.u64 = ((m_regs.back().define(dst.get_symbol()).u64) & (~(0xFFFF0000))) + ((data.u64<<16) & 0xFFFF0000);
           }
           set_reg(dst.get_symbol(),setValue);
       }
@@ -4160,7 +4168,7 @@ void inst_not_implemented( const ptx_instruction * pI )
    abort();
 }
 
-ptx_reg_t srcOperandModifiers(ptx_reg_t opData, operand_info opInfo, operand_info dstInfo, unsigned type, ptx_thread_info *thread)
+ptx_reg_t srcOperandModifiers(ptx_reg_t opData, const operand_info &opInfo, const operand_info &dstInfo, unsigned type, ptx_thread_info *thread)
 {
    ptx_reg_t result;
    memory_space *mem = NULL;
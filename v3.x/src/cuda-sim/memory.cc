@@ -27,8 +27,85 @@
 
 #include "memory.h"
 #include <stdlib.h>
+#include <sys/mman.h>
 #include "../debug.h"
 
+void memory_space::set_watch( addr_t addr, unsigned watchpoint ) 
+{
+   m_watchpoints[watchpoint]=addr;
+}
+
+void memory_space::check_watchpoints( mem_addr_t addr, size_t length, ptx_thread_info *thd, const ptx_instruction *pI )
+{
+   if( !m_watchpoints.empty() ) {
+      std::map<unsigned,mem_addr_t>::iterator i;
+      for( i=m_watchpoints.begin(); i!=m_watchpoints.end(); i++ ) {
+         mem_addr_t wa = i->second;
+         if( ((addr<=wa) && ((addr+length)>wa)) || ((addr>wa) && (addr < (wa+4))) ) 
+            hit_watchpoint(i->first,thd,pI);
+      }
+   }
+}
+
+// A memory image is the magic string below followed by records of a 64-bit
+// address, a 64-bit length and length bytes of data, ended by a record of
+// length zero. Ranges without a record are zero.
+static const char g_mem_image_magic[8] = { 'G','P','G','P','U','M','E','M' };
+
+void memory_space::save_record( FILE *fp, mem_addr_t addr, size_t length, const void *data )
+{
+   unsigned long long header[2] = { addr, length };
+   if( fwrite(header,sizeof(header),1,fp) != 1 || fwrite(data,1,length,fp) != length ) {
+      printf("GPGPU-Sim PTX: ERROR ** could not write memory image\n");
+      abort();
+   }
+}
+
+void memory_space::save_image( FILE *fp ) const
+{
+   unsigned long long end[2] = { 0, 0 };
+   if( fwrite(g_mem_image_magic,sizeof(g_mem_image_magic),1,fp) != 1 ) {
+      printf("GPGPU-Sim PTX: ERROR ** could not write memory image\n");
+      abort();
+   }
+   save_records(fp);
+   if( fwrite(end,sizeof(end),1,fp) != 1 ) {
+      printf("GPGPU-Sim PTX: ERROR ** could not write memory image\n");
+      abort();
+   }
+}
+
+void memory_space::load_image( FILE *fp )
+{
+   char magic[sizeof(g_mem_image_magic)];
+   if( fread(magic,sizeof(magic),1,fp) != 1 || memcmp(magic,g_mem_image_magic,sizeof(magic)) ) {
+      printf("GPGPU-Sim PTX: ERROR ** not a memory image\n");
+      abort();
+   }
+   clear();
+   unsigned char buffer[64*1024];
+   while( 1 ) {
+      unsigned long long header[2];
+      if( fread(header,sizeof(header),1,fp) != 1 ) {
+         printf("GPGPU-Sim PTX: ERROR ** truncated memory image\n");
+         abort();
+      }
+      if( header[1] == 0 )
+         break;
+      for( unsigned long long done=0; done < header[1]; ) {
+         size_t n = header[1] - done;
+         if( n > sizeof(buffer) ) 
+            n = sizeof(buffer);
+         if( fread(buffer,1,n,fp) != n ) {
+            printf("GPGPU-Sim PTX: ERROR ** truncated memory image\n");
+            abort();
+         }
+         write(header[0]+done,n,buffer,NULL,NULL);
+         done += n;
+      }
+   }
+}
+
 template<unsigned BSIZE> memory_space_impl<BSIZE>::memory_space_impl( std::string name, unsigned hash_size )
 {
    m_name = name;
@@ -54,8 +131,8 @@ template<unsigned BSIZE> void memory_space_impl<BSIZE>::write( mem_addr_t addr,
       m_data[index].write(offset,nbytes,(const unsigned char*)data);
    } else {
       // slow route for inter-block access
-      unsigned nbytes_remain = length;
-      unsigned src_offset = 0; 
+      size_t nbytes_remain = length;
+      size_t src_offset = 0; 
       mem_addr_t current_addr = addr; 
 
       while (nbytes_remain > 0) {
@@ -76,14 +153,7 @@ template<unsigned BSIZE> void memory_space_impl<BSIZE>::write( mem_addr_t addr,
       }
       assert(nbytes_remain == 0); 
    }
-   if( !m_watchpoints.empty() ) {
-      std::map<unsigned,mem_addr_t>::iterator i;
-      for( i=m_watchpoints.begin(); i!=m_watchpoints.end(); i++ ) {
-         mem_addr_t wa = i->second;
-         if( ((addr<=wa) && ((addr+length)>wa)) || ((addr>wa) && (addr < (wa+4))) ) 
-            hit_watchpoint(i->first,thd,pI);
-      }
-   }
+   check_watchpoints(addr,length,thd,pI);
 }
 
 template<unsigned BSIZE> void memory_space_impl<BSIZE>::read_single_block( mem_addr_t blk_idx, mem_addr_t addr, size_t length, void *data) const
@@ -115,8 +185,8 @@ template<unsigned BSIZE> void memory_space_impl<BSIZE>::read( mem_addr_t addr, s
       read_single_block(index, addr, length, data); 
    } else {
       // slow route for inter-block access 
-      unsigned nbytes_remain = length;
-      unsigned dst_offset = 0; 
+      size_t nbytes_remain = length;
+      size_t dst_offset = 0; 
       mem_addr_t current_addr = addr; 
 
       while (nbytes_remain > 0) {
@@ -139,6 +209,71 @@ template<unsigned BSIZE> void memory_space_impl<BSIZE>::read( mem_addr_t addr, s
    }
 }
 
+// Blocks that were never written read as zero, so zeroing a range only
+// touches the blocks that already exist and drops the ones it covers
+// completely; a large cudaMemset(0) allocates nothing.
+template<unsigned BSIZE> void memory_space_impl<BSIZE>::fill( mem_addr_t addr, size_t length, unsigned char value )
+{
+   fill_blocks(addr,length,value);
+   check_watchpoints(addr,length,NULL,NULL);
+}
+
+template<unsigned BSIZE> void memory_space_impl<BSIZE>::fill_blocks( mem_addr_t addr, size_t length, unsigned char value )
+{
+   mem_addr_t current_addr = addr;
+   size_t nbytes_remain = length;
+   while (nbytes_remain > 0) {
+      unsigned offset = current_addr & (BSIZE-1);
+      mem_addr_t page = current_addr >> m_log2_block_size;
+      size_t tx_bytes = BSIZE - offset;
+      if (tx_bytes > nbytes_remain) 
+         tx_bytes = nbytes_remain;
+
+      if (value == 0) {
+         typename map_t::iterator i = m_data.find(page);
+         if (i != m_data.end()) {
+            if (tx_bytes == BSIZE) 
+               m_data.erase(i);
+            else 
+               i->second.fill(offset, tx_bytes, 0);
+         }
+      } else {
+         m_data[page].fill(offset, tx_bytes, value);
+      }
+
+      current_addr += tx_bytes;
+      nbytes_remain -= tx_bytes;
+   }
+}
+
+// Moves at most one block per step, split where either the source or the
+// destination crosses a block boundary. Unwritten source blocks are zero
+// and are copied as a fill, so they stay unallocated at the destination.
+template<unsigned BSIZE> void memory_space_impl<BSIZE>::copy( mem_addr_t dst, mem_addr_t src, size_t length )
+{
+   unsigned char buffer[BSIZE];
+   size_t done = 0;
+   while (done < length) {
+      mem_addr_t src_addr = src + done;
+      mem_addr_t dst_addr = dst + done;
+      size_t tx_bytes = length - done;
+      if (tx_bytes > BSIZE - (src_addr & (BSIZE-1))) 
+         tx_bytes = BSIZE - (src_addr & (BSIZE-1));
+      if (tx_bytes > BSIZE - (dst_addr & (BSIZE-1))) 
+         tx_bytes = BSIZE - (dst_addr & (BSIZE-1));
+
+      typename map_t::const_iterator i = m_data.find(src_addr >> m_log2_block_size);
+      if (i == m_data.end()) {
+         fill_blocks(dst_addr, tx_bytes, 0);
+      } else {
+         i->second.read(src_addr & (BSIZE-1), tx_bytes, buffer);
+         m_data[dst_addr >> m_log2_block_size].write(dst_addr & (BSIZE-1), tx_bytes, buffer);
+      }
+      done += tx_bytes;
+   }
+   check_watchpoints(dst,length,NULL,NULL);
+}
+
 template<unsigned BSIZE> void memory_space_impl<BSIZE>::print( const char *format, FILE *fout ) const
 {
    typename map_t::const_iterator i_page;
@@ -148,9 +283,19 @@ template<unsigned BSIZE> void memory_space_impl<BSIZE>::print( const char *forma
    }
 }
 
-template<unsigned BSIZE> void memory_space_impl<BSIZE>::set_watch( addr_t addr, unsigned watchpoint ) 
+template<unsigned BSIZE> void memory_space_impl<BSIZE>::save_records( FILE *fp ) const
 {
-   m_watchpoints[watchpoint]=addr;
+   typename map_t::const_iterator i_page;
+   unsigned char buffer[BSIZE];
+   for (i_page = m_data.begin(); i_page != m_data.end(); ++i_page) {
+      i_page->second.read(0, BSIZE, buffer);
+      save_record(fp, i_page->first << m_log2_block_size, BSIZE, buffer);
+   }
+}
+
+template<unsigned BSIZE> void memory_space_impl<BSIZE>::clear()
+{
+   m_data.clear();
 }
 
 template class memory_space_impl<32>;
@@ -158,6 +303,174 @@ template class memory_space_impl<64>;
 template class memory_space_impl<8192>;
 template class memory_space_impl<16*1024>;
 
+#define HEAP_PAGE_SIZE 4096
+
+memory_space_mmap::memory_space_mmap( std::string name, unsigned hash_size )
+   : m_name(name), m_low(name,hash_size)
+{
+   m_heap_size = 0x100000000ULL - GLOBAL_HEAP_START;
+   m_heap_used = 0;
+   void *heap = mmap(NULL, m_heap_size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+   if( heap == MAP_FAILED ) {
+      printf("GPGPU-Sim PTX: ERROR ** could not map %zu bytes for memory \'%s\'\n", m_heap_size, m_name.c_str());
+      abort();
+   }
+   m_heap = (unsigned char*)heap;
+}
+
+memory_space_mmap::~memory_space_mmap()
+{
+   munmap(m_heap, m_heap_size);
+}
+
+size_t memory_space_mmap::low_part( mem_addr_t addr, size_t length )
+{
+   if( addr >= GLOBAL_HEAP_START ) 
+      return 0;
+   return (length < (size_t)(GLOBAL_HEAP_START - addr))? length : GLOBAL_HEAP_START - addr;
+}
+
+void memory_space_mmap::write( mem_addr_t addr, size_t length, const void *data, ptx_thread_info *thd, const ptx_instruction *pI )
+{
+   size_t low = low_part(addr,length);
+   if( low ) 
+      m_low.write(addr,low,data,thd,pI);
+   if( low < length ) {
+      size_t offset = addr + low - GLOBAL_HEAP_START;
+      assert( offset + (length-low) <= m_heap_size );
+      memcpy(m_heap+offset, (const unsigned char*)data+low, length-low);
+      if( offset + (length-low) > m_heap_used ) 
+         m_heap_used = offset + (length-low);
+   }
+   check_watchpoints(addr,length,thd,pI);
+}
+
+void memory_space_mmap::read( mem_addr_t addr, size_t length, void *data ) const
+{
+   size_t low = low_part(addr,length);
+   if( low ) 
+      m_low.read(addr,low,data);
+   if( low < length ) {
+      size_t offset = addr + low - GLOBAL_HEAP_START;
+      assert( offset + (length-low) <= m_heap_size );
+      memcpy((unsigned char*)data+low, m_heap+offset, length-low);
+   }
+}
+
+// Zeroing hands whole pages back to the OS (they read as zero again) and
+// never touches pages above the highest byte written.
+void memory_space_mmap::fill( mem_addr_t addr, size_t length, unsigned char value )
+{
+   size_t low = low_part(addr,length);
+   if( low ) 
+      m_low.fill(addr,low,value);
+   if( low < length ) {
+      size_t start = addr + low - GLOBAL_HEAP_START;
+      size_t end = start + (length-low);
+      assert( end <= m_heap_size );
+      if( value ) {
+         memset(m_heap+start, value, end-start);
+         if( end > m_heap_used ) 
+            m_heap_used = end;
+      } else {
+         if( end > m_heap_used ) 
+            end = m_heap_used;
+         size_t page_start = (start + HEAP_PAGE_SIZE-1) & ~(size_t)(HEAP_PAGE_SIZE-1);
+         size_t page_end = end & ~(size_t)(HEAP_PAGE_SIZE-1);
+         if( page_start < page_end ) {
+            madvise(m_heap+page_start, page_end-page_start, MADV_DONTNEED);
+            memset(m_heap+start, 0, page_start-start);
+            memset(m_heap+page_end, 0, end-page_end);
+         } else if( start < end ) {
+            memset(m_heap+start, 0, end-start);
+         }
+      }
+   }
+   check_watchpoints(addr,length,NULL,NULL);
+}
+
+void memory_space_mmap::copy( mem_addr_t dst, mem_addr_t src, size_t length )
+{
+   if( dst >= GLOBAL_HEAP_START && src >= GLOBAL_HEAP_START ) {
+      size_t dst_offset = dst - GLOBAL_HEAP_START;
+      size_t src_offset = src - GLOBAL_HEAP_START;
+      assert( dst_offset + length <= m_heap_size && src_offset + length <= m_heap_size );
+      // the part of the source that was never written is a zero fill
+      size_t written = (src_offset >= m_heap_used)? 0 : m_heap_used - src_offset;
+      if( written > length ) 
+         written = length;
+      memmove(m_heap+dst_offset, m_heap+src_offset, written);
+      if( dst_offset + written > m_heap_used ) 
+         m_heap_used = dst_offset + written;
+      if( written < length ) 
+         fill(dst+written, length-written, 0);
+   } else {
+      unsigned char buffer[64*1024];
+      for( size_t done=0; done < length; ) {
+         size_t n = length - done;
+         if( n > sizeof(buffer) ) 
+            n = sizeof(buffer);
+         read(src+done,n,buffer);
+         write(dst+done,n,buffer,NULL,NULL);
+         done += n;
+      }
+   }
+   check_watchpoints(dst,length,NULL,NULL);
+}
+
+bool memory_space_mmap::heap_page_is_zero( size_t offset ) const
+{
+   static const unsigned char zero_page[HEAP_PAGE_SIZE] = {0};
+   size_t n = (m_heap_size - offset < HEAP_PAGE_SIZE)? m_heap_size - offset : HEAP_PAGE_SIZE;
+   return memcmp(m_heap+offset, zero_page, n) == 0;
+}
+
+void memory_space_mmap::print( const char *format, FILE *fout ) const
+{
+   m_low.print(format,fout);
+   for( size_t offset=0; offset < m_heap_used; offset += HEAP_PAGE_SIZE ) {
+      if( heap_page_is_zero(offset) ) 
+         continue;
+      fprintf(fout, "%s - %#x:", m_name.c_str(), (unsigned)(GLOBAL_HEAP_START + offset));
+      const unsigned int *i_data = (const unsigned int*)(m_heap+offset);
+      for (unsigned d = 0; d < HEAP_PAGE_SIZE / sizeof(unsigned int); d++) {
+         if (d % 8 == 0) 
+            fprintf(fout, "\n");
+         fprintf(fout, format, i_data[d]);
+         fprintf(fout, " ");
+      }
+      fprintf(fout, "\n");
+   }
+   fflush(fout);
+}
+
+// one record per run of non-zero pages
+void memory_space_mmap::save_records( FILE *fp ) const
+{
+   m_low.save_records(fp);
+   size_t run_start = 0, run_length = 0;
+   for( size_t offset=0; offset < m_heap_used; offset += HEAP_PAGE_SIZE ) {
+      if( heap_page_is_zero(offset) ) {
+         if( run_length ) 
+            save_record(fp, GLOBAL_HEAP_START + run_start, run_length, m_heap+run_start);
+         run_length = 0;
+      } else {
+         if( !run_length ) 
+            run_start = offset;
+         run_length += HEAP_PAGE_SIZE;
+      }
+   }
+   if( run_length ) 
+      save_record(fp, GLOBAL_HEAP_START + run_start, run_length, m_heap+run_start);
+}
+
+void memory_space_mmap::clear()
+{
+   m_low.clear();
+   madvise(m_heap, m_heap_size, MADV_DONTNEED);
+   m_heap_used = 0;
+}
+
 void g_print_memory_space(memory_space *mem, const char *format = "%08x", FILE *fout = stdout) 
 {
     mem->print(format,fout);
@@ -197,6 +510,23 @@ int main(int argc, char *argv[] )
       }
    }
 
+   // bulk fill and copy across block boundaries
+   mem->fill(100,200,0xAB);
+   mem->copy(1000,90,220);
+   mem->fill(0,64,0);
+   for( mem_addr_t addr=0; addr < 1300; addr+=1) {
+      unsigned char tmp=0, val;
+      mem->read(addr,1,&tmp);
+      if( addr < 64 ) val = 0;
+      else if( addr >= 100 && addr < 300 ) val = 0xAB;
+      else if( addr >= 1000 && addr < 1220 ) val = (addr-910 >= 100 && addr-910 < 300)? 0xAB : (addr - 910 + 128) % 256;
+      else val = (addr + 128) % 256;
+      if( tmp != val ) {
+         errors_found=1;
+         printf("ERROR ** mem[0x%x] = 0x%x, expected 0x%x\n", addr, (unsigned)tmp, (unsigned)val );
+      }
+   }
+
    if( errors_found ) {
       printf("SUMMARY:  ERRORS FOUND\n");
    } else {
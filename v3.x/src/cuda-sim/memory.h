@@ -77,6 +77,12 @@ public:
       memcpy(data,m_data+offset,length);
    }
 
+   void fill( unsigned offset, size_t length, unsigned char value )
+   {
+      assert( offset + length <= BSIZE );
+      memset(m_data+offset,value,length);
+   }
+
    void print( const char *format, FILE *fout ) const
    {
       unsigned int *i_data = (unsigned int*)m_data;
@@ -105,8 +111,25 @@ public:
    virtual ~memory_space() {}
    virtual void write( mem_addr_t addr, size_t length, const void *data, ptx_thread_info *thd, const ptx_instruction *pI ) = 0;
    virtual void read( mem_addr_t addr, size_t length, void *data ) const = 0;
+   // bulk host-side operations (cudaMemset, device to device cudaMemcpy)
+   virtual void fill( mem_addr_t addr, size_t length, unsigned char value ) = 0;
+   virtual void copy( mem_addr_t dst, mem_addr_t src, size_t length ) = 0;
    virtual void print( const char *format, FILE *fout ) const = 0;
-   virtual void set_watch( addr_t addr, unsigned watchpoint ) = 0;
+   virtual void set_watch( addr_t addr, unsigned watchpoint );
+
+   // Memory image holding every byte that may be non-zero (format in
+   // memory.cc). load_image() replaces the whole contents of the space.
+   void save_image( FILE *fp ) const;
+   void load_image( FILE *fp );
+
+   virtual void save_records( FILE *fp ) const = 0;
+   virtual void clear() = 0; // back to all zero
+
+protected:
+   void check_watchpoints( mem_addr_t addr, size_t length, ptx_thread_info *thd, const ptx_instruction *pI );
+   static void save_record( FILE *fp, mem_addr_t addr, size_t length, const void *data );
+
+   std::map<unsigned,mem_addr_t> m_watchpoints;
 };
 
 template<unsigned BSIZE> class memory_space_impl : public memory_space {
@@ -115,16 +138,49 @@ public:
 
    virtual void write( mem_addr_t addr, size_t length, const void *data, ptx_thread_info *thd, const ptx_instruction *pI );
    virtual void read( mem_addr_t addr, size_t length, void *data ) const;
+   virtual void fill( mem_addr_t addr, size_t length, unsigned char value );
+   virtual void copy( mem_addr_t dst, mem_addr_t src, size_t length );
    virtual void print( const char *format, FILE *fout ) const;
-   virtual void set_watch( addr_t addr, unsigned watchpoint ); 
+   virtual void save_records( FILE *fp ) const;
+   virtual void clear();
 
 private:
    void read_single_block( mem_addr_t blk_idx, mem_addr_t addr, size_t length, void *data) const; 
+   void fill_blocks( mem_addr_t addr, size_t length, unsigned char value );
    std::string m_name;
    unsigned m_log2_block_size;
    typedef mem_map<mem_addr_t,mem_storage<BSIZE> > map_t;
    map_t m_data;
-   std::map<unsigned,mem_addr_t> m_watchpoints;
+};
+
+// Global memory with the device heap [GLOBAL_HEAP_START, 4GB) held in one
+// sparse anonymous mapping (-gpgpu_global_mem_mmap). Accesses there are
+// plain address arithmetic and the OS zero-fills pages on first touch, so a
+// multi-GB footprint costs neither a block allocation nor a hash lookup per
+// 4KB. Lower addresses (static allocations) stay in a memory_space_impl.
+class memory_space_mmap : public memory_space {
+public:
+   memory_space_mmap( std::string name, unsigned hash_size );
+   virtual ~memory_space_mmap();
+
+   virtual void write( mem_addr_t addr, size_t length, const void *data, ptx_thread_info *thd, const ptx_instruction *pI );
+   virtual void read( mem_addr_t addr, size_t length, void *data ) const;
+   virtual void fill( mem_addr_t addr, size_t length, unsigned char value );
+   virtual void copy( mem_addr_t dst, mem_addr_t src, size_t length );
+   virtual void print( const char *format, FILE *fout ) const;
+   virtual void save_records( FILE *fp ) const;
+   virtual void clear();
+
+private:
+   // splits [addr,addr+length) at GLOBAL_HEAP_START; returns the low part's length
+   static size_t low_part( mem_addr_t addr, size_t length );
+   bool heap_page_is_zero( size_t offset ) const;
+
+   std::string m_name;
+   memory_space_impl<8192> m_low;
+   unsigned char *m_heap;
+   size_t m_heap_size;
+   size_t m_heap_used; // offset past the highest byte ever written
 };
 
 #endif
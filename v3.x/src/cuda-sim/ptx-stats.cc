@@ -154,6 +154,24 @@ void ptx_file_line_stats_add_exec_count(const ptx_instruction *pInsn)
     ptx_file_line_stats_tracker[ptx_file_line(pInsn->source_file(), pInsn->source_line())].exec_count += 1;
 }
 
+bool g_ptx_bbv_enabled = false;
+static tr1_hash_map<unsigned,unsigned long long> ptx_bbv_tracker;
+
+void ptx_bbv_add_exec_count(const ptx_instruction *pInsn)
+{
+    const basic_block_t *bb = const_cast<ptx_instruction*>(pInsn)->get_bb();
+    unsigned pc = (bb && bb->ptx_begin)? bb->ptx_begin->get_PC() : pInsn->get_PC();
+    ptx_bbv_tracker[pc] += 1;
+}
+
+// hands over the vector collected since the last call
+void ptx_bbv_take(std::map<unsigned,unsigned long long> &bbv)
+{
+    bbv.clear();
+    bbv.insert(ptx_bbv_tracker.begin(), ptx_bbv_tracker.end());
+    ptx_bbv_tracker.clear();
+}
+
 // attribute pipeline latency to this ptx instruction (specified by the pc)
 // pipeline latency is the number of cycles a warp with this instruction spent in the pipeline
 void ptx_file_line_stats_add_latency(unsigned pc, unsigned latency)
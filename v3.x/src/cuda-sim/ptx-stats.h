@@ -38,9 +38,16 @@ void ptx_file_line_stats_options(option_parser_t opp);
 void ptx_file_line_stats_write_file();
 
 #ifdef __cplusplus
+#include <map>
 // stat collection interface to cuda-sim
 class ptx_instruction;
 void ptx_file_line_stats_add_exec_count(const ptx_instruction *pInsn);
+
+// basic block vector of the running kernel (-gpgpu_sampling 1): thread
+// instructions executed per basic block, keyed by the block's first PC
+extern bool g_ptx_bbv_enabled;
+void ptx_bbv_add_exec_count(const ptx_instruction *pInsn);
+void ptx_bbv_take(std::map<unsigned,unsigned long long> &bbv);
 #endif
 
 // stat collection interface to gpgpu-sim
@@ -35,6 +35,7 @@
 #include <list>
 #include <assert.h>
 #include <algorithm>
+#include <cxxabi.h>
 #include "assert.h"
 
 #include "cuda-sim.h"
@@ -138,6 +139,15 @@ symbol *symbol_table::lookup( const char *identifier )
    return NULL;
 }
 
+void symbol_table::get_registers( std::vector<symbol*> &regs ) const
+{
+   std::map<std::string, symbol *>::const_iterator i;
+   for ( i=m_symbols.begin(); i != m_symbols.end(); i++ ) {
+      if ( i->second->is_reg() )
+         regs.push_back(i->second);
+   }
+}
+
 symbol *symbol_table::add_variable( const char *identifier, const type_info *type, unsigned size, const char *filename, unsigned line )
 {
    char buf[1024];
@@ -277,6 +287,21 @@ unsigned operand_info::get_uid()
    return result;
 }
 
+// must agree with the first branches of ptx_thread_info::get_operand_value()
+void operand_info::pre_decode()
+{
+   m_predecoded = PREDECODED_NONE;
+   if ( !m_valid || m_double_operand_type != 0 || m_addr_space != undefined_space
+        || m_operand_lohi != 0 || m_operand_neg ) 
+      return;
+   if ( is_reg() ) {
+      m_predecoded = PREDECODED_REG;
+   } else if ( m_type != builtin_t && !m_immediate_address && m_type != memory_t && is_literal() ) {
+      m_predecoded = PREDECODED_LITERAL;
+      m_predecoded_literal = get_literal_value();
+   }
+}
+
 std::list<ptx_instruction*>::iterator function_info::find_next_real_instruction( std::list<ptx_instruction*>::iterator i)
 {
    while( (i != m_instructions.end()) && (*i)->is_label() ) 
@@ -351,6 +376,22 @@ void function_info::create_basic_blocks()
    m_basic_blocks.push_back( /*exit basic block*/ new basic_block_t(bb_id,NULL,NULL,0,1) );
 }
 
+void function_info::allocate_frame_registers()
+{
+   // registers of other scopes (e.g. ptxplus registers shared between
+   // functions) and the non-architectural "_" keep no slot and are looked
+   // up by symbol instead
+   std::vector<symbol*> regs;
+   m_symtab->get_registers(regs);
+   m_frame_regs.clear();
+   for ( unsigned r=0; r < regs.size(); r++ ) {
+      if ( regs[r]->is_non_arch_reg() )
+         continue;
+      regs[r]->set_frame_slot(this, m_frame_regs.size());
+      m_frame_regs.push_back(regs[r]);
+   }
+}
+
 void function_info::print_basic_blocks()
 {
    printf("Printing basic blocks for function \'%s\':\n", m_name.c_str() );
@@ -1038,6 +1079,10 @@ ptx_instruction::ptx_instruction( int opcode,
    m_atomic_spec = 0;
    m_membar_level = 0;
    m_inst_size = 8; // bytes
+   m_exec_fn = NULL;
+   m_op_classification = 0;
+   m_pred_is_reg = false;
+   m_warp_kernel = 0;
 
    std::list<int>::const_iterator i;
    unsigned n=1;
@@ -1245,17 +1290,37 @@ function_info::function_info(int entry_point )
    m_local_mem_framesize = 0;
 }
 
+// first word of the demangled name without its parameter list, as printed
+// by "c++filt -p"; names that are not mangled are returned unchanged
+static std::string demangled_name( const std::string &name )
+{
+   int status;
+   char *d = abi::__cxa_demangle(name.c_str(),NULL,NULL,&status);
+   if( status != 0 || !d ) 
+      return name;
+   std::string result(d);
+   free(d);
+   if( !result.empty() && result[result.size()-1] == ')' ) {
+      int depth = 0;
+      for( size_t i=result.size(); i-- > 0; ) {
+         if( result[i] == ')' ) depth++;
+         else if( result[i] == '(' && --depth == 0 ) {
+            result.erase(i);
+            break;
+         }
+      }
+   }
+   size_t space = result.find_first_of(" \t");
+   if( space != std::string::npos ) 
+      result.erase(space);
+   return result;
+}
+
 unsigned function_info::print_insn( unsigned pc, FILE * fp ) const
 {
    unsigned inst_size=1; // return offset to next instruction or 1 if unknown
    unsigned index = pc - m_start_PC;
-   char command[1024];
-   char buffer[1024];
-   snprintf(command,1024,"c++filt -p %s",m_name.c_str());
-   FILE *p = popen(command,"r");
-   buffer[0]=0;
-   fscanf(p,"%1023s",buffer);
-   fprintf(fp,"%s",buffer);
+   fprintf(fp,"%s",demangled_name(m_name).c_str());
    if ( index >= m_instr_mem_size ) {
       fprintf(fp, "<past last instruction (max pc=%u)>", m_start_PC + m_instr_mem_size - 1 );
    } else {
@@ -1265,7 +1330,6 @@ unsigned function_info::print_insn( unsigned pc, FILE * fp ) const
       } else
          fprintf(fp, "<no instruction at pc = %u>", pc );
    }
-   pclose(p);
    return inst_size;
 }
 
@@ -169,6 +169,8 @@ public:
       m_function = NULL;
       m_reg_num=(unsigned)-1;
       m_arch_reg_num=(unsigned)-1;
+      m_frame_func=NULL;
+      m_frame_slot=(unsigned)-1;
       m_address=(unsigned)-1;
       m_initializer.clear();
       if ( type ) m_is_shared = type->get_key().is_shared();
@@ -202,6 +204,15 @@ public:
       m_reg_num = regno;
       m_arch_reg_num = arch_regno;
    }
+   // slot in the flat register frame of the function that declares the
+   // register (see function_info::allocate_frame_registers)
+   void set_frame_slot( const function_info *func, unsigned slot )
+   {
+      m_frame_func = func;
+      m_frame_slot = slot;
+   }
+   const function_info *frame_func() const { return m_frame_func; }
+   unsigned frame_slot() const { return m_frame_slot; }
 
    void set_address( addr_t addr )
    {
@@ -288,6 +299,8 @@ private:
    unsigned m_reg_num; 
    unsigned m_arch_reg_num; 
    bool m_reg_num_valid; 
+   const function_info *m_frame_func;
+   unsigned m_frame_slot;
 
    std::list<operand_info> m_initializer;
    static unsigned sm_next_uid;
@@ -330,6 +343,7 @@ public:
    iterator const_iterator_end() { return m_consts.end();}
 
    void dump();
+   void get_registers( std::vector<symbol*> &regs ) const;
 private:
    unsigned m_reg_allocator;
    unsigned m_shared_next;
@@ -405,6 +419,7 @@ public:
       m_vector = false;
       m_neg_pred = false;
       m_is_return_var = false;
+      m_predecoded = PREDECODED_NONE;
       m_immediate_address=false;
    }
    operand_info( const symbol *addr1, const symbol *addr2 )
@@ -428,6 +443,7 @@ public:
       m_vector = false;
       m_neg_pred = false;
       m_is_return_var = false;
+      m_predecoded = PREDECODED_NONE;
       m_immediate_address=false;
    }
    operand_info( int builtin_id, int dim_mod )
@@ -447,6 +463,7 @@ public:
       m_addr_offset = dim_mod;
       m_neg_pred = false;
       m_is_return_var = false;
+      m_predecoded = PREDECODED_NONE;
       m_immediate_address=false;
    }
    operand_info( const symbol *addr, int offset )
@@ -466,6 +483,7 @@ public:
       m_addr_offset = offset;
       m_neg_pred = false;
       m_is_return_var = false;
+      m_predecoded = PREDECODED_NONE;
       m_immediate_address=false;
    }
    operand_info( unsigned x )
@@ -485,6 +503,7 @@ public:
       m_addr_offset = x;
       m_neg_pred = false;
       m_is_return_var = false;
+      m_predecoded = PREDECODED_NONE;
       m_immediate_address=true;
    }
    operand_info( int x )
@@ -504,6 +523,7 @@ public:
       m_addr_offset = 0;
       m_neg_pred = false;
       m_is_return_var = false;
+      m_predecoded = PREDECODED_NONE;
       m_immediate_address=false;
    }
    operand_info( float x )
@@ -523,6 +543,7 @@ public:
       m_addr_offset = 0;
       m_neg_pred = false;
       m_is_return_var = false;
+      m_predecoded = PREDECODED_NONE;
       m_immediate_address=false;
    }
    operand_info( double x )
@@ -542,6 +563,7 @@ public:
       m_addr_offset = 0;
       m_neg_pred = false;
       m_is_return_var = false;
+      m_predecoded = PREDECODED_NONE;
       m_immediate_address=false;
    }
    operand_info( const symbol *s1, const symbol *s2, const symbol *s3, const symbol *s4 )
@@ -565,6 +587,7 @@ public:
       m_addr_offset = 0;
       m_neg_pred = false;
       m_is_return_var = false;
+      m_predecoded = PREDECODED_NONE;
       m_immediate_address=false;
    }
    void init()
@@ -595,6 +618,7 @@ public:
        m_neg_pred=0;
        m_is_return_var=0;
        m_is_non_arch_reg=0;
+       m_predecoded=PREDECODED_NONE;
 
    }
    void make_memory_operand() { m_type = memory_t;}
@@ -761,7 +785,19 @@ public:
    addr_t get_const_mem_offset() const { return m_const_mem_offset; }
    bool is_non_arch_reg() const { return m_is_non_arch_reg; }
 
+   // Operands that read as a plain register or literal, whatever the
+   // instruction, are classified once when the instruction is decoded so
+   // that ptx_thread_info::get_operand_value() can skip the general case.
+   void pre_decode();
+   bool is_predecoded_reg() const { return m_predecoded == PREDECODED_REG; }
+   bool is_predecoded_literal() const { return m_predecoded == PREDECODED_LITERAL; }
+   const ptx_reg_t &get_predecoded_literal() const { return m_predecoded_literal; }
+
 private:
+   enum predecoded_t { PREDECODED_NONE, PREDECODED_REG, PREDECODED_LITERAL };
+   enum predecoded_t m_predecoded;
+   ptx_reg_t m_predecoded_literal;
+
    unsigned m_uid;
    bool m_valid;
    bool m_vector;
@@ -840,6 +876,8 @@ struct gpgpu_recon_t {
    class ptx_instruction* target_inst;
 };
 
+typedef void (*ptx_exec_fn)( const class ptx_instruction *pI, class ptx_thread_info *thread );
+
 class ptx_instruction : public warp_inst_t {
 public:
     ptx_instruction( int opcode, 
@@ -876,6 +914,12 @@ public:
    unsigned get_num_operands() const { return m_operands.size();}
    bool has_pred() const { return m_pred != NULL;}
    operand_info get_pred() const { return operand_info( m_pred );}
+   const symbol *get_pred_symbol() const { return m_pred; }
+   bool pred_is_reg() const { return m_pred_is_reg; }
+   // opcodes.def handler and classification, resolved by pre_decode()
+   ptx_exec_fn get_exec_fn() const { return m_exec_fn; }
+   int get_op_classification() const { return m_op_classification; }
+   unsigned get_warp_kernel() const { return m_warp_kernel; }
    bool get_pred_neg() const { return m_neg_pred;}
    int get_pred_mod() const { return m_pred_mod;}
    const char *get_source() const { return m_source.c_str();}
@@ -1065,6 +1109,11 @@ private:
    int m_instr_mem_index; //index into m_instr_mem array
    unsigned m_inst_size; // bytes
 
+   ptx_exec_fn m_exec_fn;
+   int m_op_classification;
+   bool m_pred_is_reg;
+   unsigned m_warp_kernel;
+
    virtual void pre_decode();
    friend class function_info;
    static unsigned g_num_ptx_inst_uid;
@@ -1209,6 +1258,11 @@ public:
    {
       return m_return_var_sym;
    }
+   // gives every register declared in the function a dense slot number, so
+   // that a thread's register frame can be a flat array
+   void allocate_frame_registers();
+   unsigned num_frame_registers() const { return m_frame_regs.size(); }
+   const symbol *get_frame_register( unsigned slot ) const { return m_frame_regs[slot]; }
    const ptx_instruction *get_instruction( unsigned PC ) const
    {
       unsigned index = PC - m_start_PC;
@@ -1271,6 +1325,7 @@ private:
    std::map<unsigned,param_info> m_ptx_kernel_param_info;
    const symbol *m_return_var_sym;
    std::vector<const symbol*> m_args;
+   std::vector<const symbol*> m_frame_regs; // by frame slot
    std::list<ptx_instruction*> m_instructions;
    std::vector<basic_block_t*> m_basic_blocks;
    std::list<std::pair<unsigned, unsigned> > m_back_edges;
@@ -31,7 +31,9 @@
 #include "ptx_parser.h"
 #include <unistd.h>
 #include <dirent.h>
+#include <sys/stat.h>
 #include <fstream>
+#include <sstream>
 
 /// globals
 
@@ -54,6 +56,8 @@ extern FILE *ptxinfo_in;
 static bool g_save_embedded_ptx;
 bool g_keep_intermediate_files;
 bool m_ptx_save_converted_ptxplus;
+static char *g_ptxinfo_cache_dir;
+static char *g_ptxinfo_file;
 
 bool keep_intermediate_files() {return g_keep_intermediate_files;}
 
@@ -69,6 +73,12 @@ void ptx_reg_options(option_parser_t opp)
                 &m_ptx_save_converted_ptxplus,
                 "Saved converted ptxplus to a file",
                 "0");
+   option_parser_register(opp, "-gpgpu_ptxinfo_cache_dir", OPT_CSTR, &g_ptxinfo_cache_dir, 
+                "Directory caching ptxas resource usage and cuobjdump output by input contents and tool binary, so repeated runs skip those tools (default off)",
+                NULL);
+   option_parser_register(opp, "-gpgpu_ptxinfo_file", OPT_CSTR, &g_ptxinfo_file, 
+                "Use this ptxas -v output for every PTX source instead of running ptxas (default off)",
+                NULL);
 }
 
 void print_ptx_file( const char *p, unsigned source_num, const char *filename )
@@ -133,14 +143,9 @@ char* gpgpu_ptx_sim_convert_ptx_and_sass_to_ptxplus(const std::string ptxfilenam
 	strcpy(ptxplus_str, text.c_str());
 
 	if (!m_ptx_save_converted_ptxplus){
-		char rm_commandline[1024];
-
-		snprintf(rm_commandline,1024,"rm -f %s", fname_ptxplus);
-
-		printf("GPGPU-Sim PTX: removing temporary files using \"%s\"\n", rm_commandline);
-		int rm_result = system(rm_commandline);
-		if( rm_result != 0 ) {
-			printf("GPGPU-Sim PTX: ERROR ** while removing temporary files %d\n", rm_result);
+		printf("GPGPU-Sim PTX: removing temporary file \"%s\"\n", fname_ptxplus);
+		if( unlink(fname_ptxplus) != 0 ) {
+			printf("GPGPU-Sim PTX: ERROR ** while removing temporary files\n");
 			exit(1);
 		}
 	}
@@ -182,36 +187,148 @@ symbol_table *gpgpu_ptx_sim_load_ptx_from_string( const char *p, unsigned source
     return symtab;
 }
 
-void gpgpu_ptxinfo_load_from_string( const char *p_for_info, unsigned source_num )
+static unsigned long long fnv1a( unsigned long long hash, const char *s, size_t len )
 {
-    char fname[1024];
-    snprintf(fname,1024,"_ptx_XXXXXX");
-    int fd=mkstemp(fname); 
-    close(fd);
+    for( size_t i=0; i < len; i++ ) 
+        hash = (hash ^ (unsigned char)s[i]) * 1099511628211ULL;
+    return hash;
+}
 
-    printf("GPGPU-Sim PTX: extracting embedded .ptx to temporary file \"%s\"\n", fname);
-    FILE *ptxfile = fopen(fname,"w");
-    fprintf(ptxfile,"%s", p_for_info);
-    fclose(ptxfile);
+// Tool output cache (-gpgpu_ptxinfo_cache_dir): ptxas -v output keyed by
+// a hash of the PTX and the ptxas flags, cuobjdump output keyed by a hash of
+// the application binary. The key also covers the tool binary (path, size
+// and modification time, so a CUDA upgrade in place misses). Entries are
+// written under a temporary name and renamed, so runs sharing the directory
+// never read a partial one. Empty if caching is off or there is no tool to
+// key on.
+static std::string tool_cache_file( const char *tool, const char *input, size_t len, const char *flags )
+{
+    if( !g_ptxinfo_cache_dir ) 
+        return std::string();
+    const char *cuda_path = getenv("CUDA_INSTALL_PATH");
+    std::string tool_path = std::string(cuda_path? cuda_path : "") + "/bin/" + tool;
+    struct stat st;
+    if( stat(tool_path.c_str(),&st) ) 
+        return std::string();
+    unsigned long long hash = 14695981039346656037ULL; // 64-bit FNV-1a
+    hash = fnv1a(hash,input,len);
+    hash = fnv1a(hash,flags,strlen(flags));
+    hash = fnv1a(hash,tool_path.data(),tool_path.size());
+    unsigned long long tool_id[2] = { (unsigned long long)st.st_size, (unsigned long long)st.st_mtime };
+    hash = fnv1a(hash,(const char*)tool_id,sizeof(tool_id));
+    char buf[1024];
+    snprintf(buf,1024,"%s/%s_%016llx_%zu.txt", g_ptxinfo_cache_dir, tool, hash, len);
+    return std::string(buf);
+}
 
-    char fname2[1024];
-    snprintf(fname2,1024,"_ptx2_XXXXXX");
-    fd=mkstemp(fname2); 
-    close(fd);
-    char commandline2[4096];
-    snprintf(commandline2,4096,"cat %s | sed 's/.version 1.5/.version 1.4/' | sed 's/, texmode_independent//' | sed 's/\\(\\.extern \\.const\\[1\\] .b8 \\w\\+\\)\\[\\]/\\1\\[1\\]/' | sed 's/const\\[.\\]/const\\[0\\]/g' > %s", fname, fname2);
-    printf("Running: %s\n", commandline2);
-    int result = system(commandline2);
-    if( result != 0 ) {
-       printf("GPGPU-Sim PTX: ERROR ** while loading PTX (a) %d\n", result);
-       printf("               Ensure you have write access to simulation directory\n");
-       printf("               and have \'cat\' and \'sed\' in your path.\n");
-       exit(1);
+static void tool_cache_store( const std::string &output, const std::string &cache_file )
+{
+    char suffix[64];
+    snprintf(suffix,64,".tmp.%d",(int)getpid());
+    std::string tmp = cache_file + suffix;
+    std::ofstream out(tmp.c_str(), std::ios::binary);
+    out << output;
+    out.close();
+    if( !out || rename(tmp.c_str(),cache_file.c_str()) ) {
+        printf("GPGPU-Sim PTX: WARNING ** could not add \"%s\" to the tool output cache\n", cache_file.c_str());
+        unlink(tmp.c_str());
     }
+}
 
-    char tempfile_ptxinfo[1024];
-    snprintf(tempfile_ptxinfo,1024,"%sinfo",fname);
-    char commandline[1024];
+std::string cuobjdump_cache_file( const char *app_binary )
+{
+    if( !g_ptxinfo_cache_dir ) 
+        return std::string();
+    std::ifstream in(app_binary, std::ios::binary);
+    if( !in.is_open() ) 
+        return std::string();
+    std::stringstream contents;
+    contents << in.rdbuf();
+    std::string binary = contents.str();
+    return tool_cache_file("cuobjdump",binary.data(),binary.size(),"-ptx -elf -sass");
+}
+
+void cuobjdump_cache_store( const char *output_file, const std::string &cache_file )
+{
+    std::ifstream in(output_file, std::ios::binary);
+    std::stringstream output;
+    output << in.rdbuf();
+    if( in.is_open() ) 
+        tool_cache_store(output.str(),cache_file);
+}
+
+// whole file, or without the lines containing drop (if not NULL); false if unreadable
+static bool read_text_file( const char *filename, std::string &text, const char *drop )
+{
+    std::ifstream in(filename, std::ios::binary);
+    if( !in.is_open() ) 
+        return false;
+    std::string line;
+    text.clear();
+    while( getline(in,line) ) {
+        if( drop && line.find(drop) != std::string::npos ) 
+            continue;
+        text += line + "\n";
+    }
+    return true;
+}
+
+static void ptxinfo_parse_string( const std::string &ptxinfo, const char *name )
+{
+    ptxinfo_in = fmemopen((void*)ptxinfo.data(), ptxinfo.size(), "r");
+    if( !ptxinfo_in ) {
+        printf("GPGPU-Sim PTX: ERROR ** could not read ptxinfo \"%s\"\n", name);
+        exit(1);
+    }
+    g_ptxinfo_filename = name;
+    ptxinfo_parse();
+    fclose(ptxinfo_in);
+}
+
+// The edits ptxas needs to accept GPGPU-Sim's PTX, done line by line:
+//   .version 1.5                           -> .version 1.4
+//   , texmode_independent                  -> (removed)
+//   .extern .const[1] .b8 name[]           -> .extern .const[1] .b8 name[1]
+//   const[N]                               -> const[0]  (every bank)
+static std::string ptxas_compatible_ptx( const char *ptx )
+{
+    std::string out;
+    out.reserve(strlen(ptx)+64);
+    const char *line = ptx;
+    while( *line ) {
+        const char *eol = strchr(line,'\n');
+        std::string l = eol? std::string(line,eol-line+1) : std::string(line);
+        line += l.size();
+
+        size_t pos = l.find(".version 1.5");
+        if( pos != std::string::npos ) 
+            l.replace(pos+11,1,"4");
+        pos = l.find(", texmode_independent");
+        if( pos != std::string::npos ) 
+            l.erase(pos,strlen(", texmode_independent"));
+        pos = l.find(".extern .const[1] ");
+        if( pos != std::string::npos ) {
+            size_t n = pos + strlen(".extern .const[1] ");
+            if( l.compare(n+1,3,"b8 ") == 0 ) {
+                n += 4;
+                size_t w = n;
+                while( w < l.size() && (isalnum(l[w]) || l[w] == '_') ) 
+                    w++;
+                if( w > n && l.compare(w,2,"[]") == 0 ) 
+                    l.insert(w+1,"1");
+            }
+        }
+        for( pos = l.find("const["); pos != std::string::npos; pos = l.find("const[",pos+1) ) {
+            if( pos+7 < l.size() && l[pos+7] == ']' ) 
+                l[pos+6] = '0';
+        }
+        out += l;
+    }
+    return out;
+}
+
+void gpgpu_ptxinfo_load_from_string( const char *p_for_info, unsigned source_num )
+{
     char extra_flags[1024];
     extra_flags[0]=0;
 
@@ -219,28 +336,62 @@ void gpgpu_ptxinfo_load_from_string( const char *p_for_info, unsigned source_num
     snprintf(extra_flags,1024,"--gpu-name=sm_20");
 #endif
 
+    std::string ptxinfo;
+    if( g_ptxinfo_file ) {
+        if( !read_text_file(g_ptxinfo_file,ptxinfo,"warning") ) {
+            printf("GPGPU-Sim PTX: ERROR ** cannot read ptxinfo file \"%s\"\n", g_ptxinfo_file);
+            exit(1);
+        }
+        printf("GPGPU-Sim PTX: loading ptxinfo from \"%s\"\n", g_ptxinfo_file);
+        ptxinfo_parse_string(ptxinfo,g_ptxinfo_file);
+        return;
+    }
+    std::string cache_file;
+    if( g_ptxinfo_cache_dir ) {
+        cache_file = tool_cache_file("ptxas",p_for_info,strlen(p_for_info),extra_flags);
+        if( !cache_file.empty() && read_text_file(cache_file.c_str(),ptxinfo,NULL) ) {
+            printf("GPGPU-Sim PTX: loading ptxinfo from cache \"%s\"\n", cache_file.c_str());
+            ptxinfo_parse_string(ptxinfo,cache_file.c_str());
+            return;
+        }
+    }
+
+    // ptxas only reads files
+    char fname[1024];
+    snprintf(fname,1024,"_ptx_XXXXXX");
+    int fd=mkstemp(fname); 
+    FILE *ptxfile = (fd >= 0)? fdopen(fd,"w") : NULL;
+    if( !ptxfile ) {
+       printf("GPGPU-Sim PTX: ERROR ** while loading PTX (a)\n");
+       printf("               Ensure you have write access to simulation directory.\n");
+       exit(1);
+    }
+    std::string ptx = ptxas_compatible_ptx(p_for_info);
+    fwrite(ptx.data(),1,ptx.size(),ptxfile);
+    fclose(ptxfile);
+    printf("GPGPU-Sim PTX: extracted embedded .ptx for ptxas to temporary file \"%s\"\n", fname);
+
+    char tempfile_ptxinfo[1024];
+    snprintf(tempfile_ptxinfo,1024,"%sinfo",fname);
+    char commandline[1024];
+
     snprintf(commandline,1024,"$CUDA_INSTALL_PATH/bin/ptxas %s -v %s --output-file  /dev/null 2> %s",
-             extra_flags, fname2, tempfile_ptxinfo);
+             extra_flags, fname, tempfile_ptxinfo);
     printf("GPGPU-Sim PTX: generating ptxinfo using \"%s\"\n", commandline);
-    result = system(commandline);
+    int result = system(commandline);
     if( result != 0 ) {
        printf("GPGPU-Sim PTX: ERROR ** while loading PTX (b) %d\n", result);
        printf("               Ensure ptxas is in your path.\n");
        exit(1);
     }
 
-    snprintf(commandline,1024,"sed -i /warning/d %s", tempfile_ptxinfo);
-    result = system(commandline);
-
-    ptxinfo_in = fopen(tempfile_ptxinfo,"r");
-    g_ptxinfo_filename = tempfile_ptxinfo;
-    ptxinfo_parse();
-    snprintf(commandline,1024,"rm -f %s %s %s", fname, fname2, tempfile_ptxinfo);
-    printf("GPGPU-Sim PTX: removing ptxinfo using \"%s\"\n", commandline);
-    result = system(commandline);
-    if( result != 0 ) {
-       printf("GPGPU-Sim PTX: ERROR ** while loading PTX (c) %d\n", result);
-       exit(1);
+    read_text_file(tempfile_ptxinfo,ptxinfo,"warning");
+    if( !g_keep_intermediate_files ) {
+        unlink(fname);
+        unlink(tempfile_ptxinfo);
     }
+    if( !cache_file.empty() )
+        tool_cache_store(ptxinfo,cache_file);
+    ptxinfo_parse_string(ptxinfo,tempfile_ptxinfo);
 }
 
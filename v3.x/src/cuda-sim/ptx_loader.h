@@ -36,4 +36,9 @@ void gpgpu_ptxinfo_load_from_string( const char *p_for_info, unsigned source_num
 char* gpgpu_ptx_sim_convert_ptx_and_sass_to_ptxplus(const std::string ptx_str, const std::string sass_str, const std::string elf_str);
 bool keep_intermediate_files();
 
+// cuobjdump -ptx -elf -sass output of app_binary in -gpgpu_ptxinfo_cache_dir
+// (empty if the cache is off); store copies a fresh output file there
+std::string cuobjdump_cache_file( const char *app_binary );
+void cuobjdump_cache_store( const char *output_file, const std::string &cache_file );
+
 #endif
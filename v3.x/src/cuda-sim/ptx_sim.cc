@@ -162,7 +162,7 @@ ptx_thread_info::ptx_thread_info( kernel_info_t &kernel )
    m_hw_sid = -1;
    m_last_dram_callback.function = NULL;
    m_last_dram_callback.instruction = NULL;
-   m_regs.push_back( reg_map_t() );
+   m_regs.push_back( reg_frame() );
    m_debug_trace_regs_modified.push_back( reg_map_t() );
    m_debug_trace_regs_read.push_back( reg_map_t() );
    m_callstack.push_back( stack_entry() );
@@ -355,7 +355,7 @@ void ptx_thread_info::callstack_push( unsigned pc, unsigned rpc, const symbol *r
    m_last_was_call = true;
    assert( m_func_info != NULL );
    m_callstack.push_back( stack_entry(m_symbol_table,m_func_info,pc,rpc,return_var_src,return_var_dst,call_uid) );
-   m_regs.push_back( reg_map_t() );
+   m_regs.push_back( reg_frame() );
    m_debug_trace_regs_modified.push_back( reg_map_t() );
    m_debug_trace_regs_read.push_back( reg_map_t() );
    m_local_mem_stack_pointer += m_func_info->local_mem_framesize(); 
@@ -369,7 +369,7 @@ void ptx_thread_info::callstack_push_plus( unsigned pc, unsigned rpc, const symb
    m_last_was_call = true;
    assert( m_func_info != NULL );
    m_callstack.push_back( stack_entry(m_symbol_table,m_func_info,pc,rpc,return_var_src,return_var_dst,call_uid) );
-   //m_regs.push_back( reg_map_t() );
+   //m_regs.push_back( reg_frame() );
    //m_debug_trace_regs_modified.push_back( reg_map_t() );
    //m_debug_trace_regs_read.push_back( reg_map_t() );
    m_local_mem_stack_pointer += m_func_info->local_mem_framesize();
@@ -446,13 +446,13 @@ bool ptx_thread_info::callstack_pop_plus()
 void ptx_thread_info::dump_callstack() const
 {
    std::list<stack_entry>::const_iterator c=m_callstack.begin();
-   std::list<reg_map_t>::const_iterator r=m_regs.begin();
+   std::list<reg_frame>::const_iterator r=m_regs.begin();
 
    printf("\n\n");
    printf("Call stack for thread uid = %u (sc=%u, hwtid=%u)\n", m_uid, m_hw_sid, m_hw_tid );
    while( c != m_callstack.end() && r != m_regs.end() ) {
       const stack_entry &c_e = *c;
-      const reg_map_t &regs = *r;
+      const reg_frame &regs = *r;
       if( !c_e.m_valid ) {
          printf("  <entry>                              #regs = %zu\n", regs.size() );
       } else {
@@ -489,14 +489,62 @@ const ptx_instruction *ptx_thread_info::get_inst( addr_t pc ) const
    return m_func_info->get_instruction(pc);
 }
 
+ptx_reg_t *ptx_thread_info::reg_frame::find( const symbol *reg )
+{
+   const function_info *func = reg->frame_func();
+   if( func ) {
+      if( m_func == NULL ) {
+         m_func = func;
+         m_flat.resize( func->num_frame_registers() );
+         m_defined.resize( func->num_frame_registers(), 0 );
+      }
+      if( func == m_func ) {
+         unsigned slot = reg->frame_slot();
+         return m_defined[slot] ? &m_flat[slot] : NULL;
+      }
+   }
+   reg_map_t::iterator r = m_other.find(reg);
+   if( r == m_other.end() )
+      return NULL;
+   return &r->second;
+}
+
+ptx_reg_t &ptx_thread_info::reg_frame::define( const symbol *reg )
+{
+   ptx_reg_t *value = find(reg);
+   if( value )
+      return *value;
+   if( reg->frame_func() && reg->frame_func() == m_func ) {
+      unsigned slot = reg->frame_slot();
+      m_defined[slot] = 1;
+      return m_flat[slot];
+   }
+   return m_other[reg];
+}
+
+size_t ptx_thread_info::reg_frame::size() const
+{
+   size_t n = m_other.size();
+   for( unsigned slot=0; slot < m_defined.size(); slot++ ) 
+      n += m_defined[slot];
+   return n;
+}
+
 void ptx_thread_info::dump_regs( FILE *fp )
 {
    if(m_regs.empty()) return;
-   if(m_regs.back().empty()) return;
+   const reg_frame &frame = m_regs.back();
+   if(frame.size() == 0) return;
    fprintf(fp,"Register File Contents:\n");
    fflush(fp);
+   for( unsigned slot=0; slot < frame.m_defined.size(); slot++ ) {
+      if( !frame.m_defined[slot] ) 
+         continue;
+      std::string name = frame.m_func->get_frame_register(slot)->name();
+      print_reg(fp,name,frame.m_flat[slot],m_symbol_table);
+   }
    reg_map_t::const_iterator r;
-   for ( r=m_regs.back().begin(); r != m_regs.back().end(); ++r ) {
+   for ( r=frame.m_other.begin(); r != frame.m_other.end(); ++r ) {
       const symbol *sym = r->first;
       ptx_reg_t value = r->second;
       std::string name = sym->name();
@@ -275,11 +275,16 @@ public:
 
    void ptx_fetch_inst( inst_t &inst ) const;
    void ptx_exec_inst( warp_inst_t &inst, unsigned lane_id );
+   // runs inst for all active lanes at once if it has a warp kernel
+   // (warp_exec.cc); false if it must go through ptx_exec_inst() per lane
+   static bool ptx_exec_warp_inst( ptx_thread_info **threads, warp_inst_t &inst, unsigned warp_size );
+   bool pred_skip( const ptx_instruction *pI );
+   void count_inst( const ptx_instruction *pI, int op_classification );
 
    const ptx_version &get_ptx_version() const;
    void set_reg( const symbol *reg, const ptx_reg_t &value );
    ptx_reg_t get_reg( const symbol *reg );
-   ptx_reg_t get_operand_value( const operand_info &op, operand_info dstInfo, unsigned opType, ptx_thread_info *thread, int derefFlag );
+   ptx_reg_t get_operand_value( const operand_info &op, const operand_info &dstInfo, unsigned opType, ptx_thread_info *thread, int derefFlag );
    void set_operand_value( const operand_info &dst, const ptx_reg_t &data, unsigned type, ptx_thread_info *thread, const ptx_instruction *pI );
    void set_operand_value( const operand_info &dst, const ptx_reg_t &data, unsigned type, ptx_thread_info *thread, const ptx_instruction *pI, int overflow, int carry );
    void get_vector_operand_values( const operand_info &op, ptx_reg_t* ptx_regs, unsigned num_elements );
@@ -461,7 +466,24 @@ private:
    unsigned m_local_mem_stack_pointer;
 
    typedef tr1_hash_map<const symbol*,ptx_reg_t> reg_map_t;
-   std::list<reg_map_t> m_regs;
+
+   // Registers of one call level. Once the frame sees a register of the
+   // function it belongs to, the registers of that function are held in a
+   // flat array indexed by symbol::frame_slot(); registers without a slot in
+   // that function (e.g. ptxplus calls, which share the caller's frame) go
+   // to a map.
+   struct reg_frame {
+      reg_frame() : m_func(NULL) {}
+      ptx_reg_t *find( const symbol *reg );
+      ptx_reg_t &define( const symbol *reg ); // zero on first use, like reg_map_t::operator[]
+      size_t size() const;
+
+      const function_info *m_func;
+      std::vector<ptx_reg_t> m_flat;
+      std::vector<unsigned char> m_defined;
+      reg_map_t m_other;
+   };
+   std::list<reg_frame> m_regs;
    std::list<reg_map_t> m_debug_trace_regs_modified;
    std::list<reg_map_t> m_debug_trace_regs_read;
    bool m_enable_debug_trace;
@@ -469,6 +491,8 @@ private:
    std::stack<class operand_info> m_breakaddrs;
 };
 
+unsigned ptx_warp_kernel( const ptx_instruction *pI );
+
 addr_t generic_to_local( unsigned smid, unsigned hwtid, addr_t addr );
 addr_t generic_to_shared( unsigned smid, addr_t addr );
 addr_t generic_to_global( addr_t addr );
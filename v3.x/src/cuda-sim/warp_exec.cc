@@ -0,0 +1,364 @@
+#include "ptx_sim.h"
+#include "ptx_ir.h"
+#include "opcodes.h"
+#include "ptx.tab.h"
+#include "cuda-sim.h"
+#include "../abstract_hardware_model.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Warp-wide functional execution of simple ALU instructions.
+ *
+ * ptx_exec_inst() runs an instruction for one thread at a time. For the
+ * integer and single precision arithmetic below, when every operand is a
+ * plain register or an immediate (operand_info::pre_decode()), the lanes of
+ * a warp do identical work on their own registers. ptx_exec_warp_inst()
+ * gathers each source operand of the executing lanes into a lane-major
+ * array, runs one loop over the warp and scatters the results, so operand
+ * decoding and handler dispatch are paid once per warp. The loops are
+ * written for the compiler to vectorize.
+ *
+ * Results are bit-for-bit those of the handlers in instructions.cc,
+ * including whatever they leave above the operand type in the register.
+ * Everything else (memory, control flow, ptxplus double destinations, other
+ * types and modifiers, instruction tracing) takes the per-thread path.
+ */
+
+enum warp_kernel_t {
+   WARP_NONE = 0,
+   WARP_MOV,
+   WARP_AND,
+   WARP_OR,
+   WARP_XOR,
+   WARP_ADD_I32,
+   WARP_ADD_F32,
+   WARP_SUB_I32,
+   WARP_SUB_F32,
+   WARP_MUL_LO_I32,
+   WARP_MUL_F32,
+   WARP_MAD_LO_I32,
+   WARP_MAD_F32,
+   WARP_SHL_B32,
+   WARP_SHR_U32,
+   WARP_SHR_S32,
+   WARP_MIN_U32,
+   WARP_MIN_S32,
+   WARP_MIN_F32,
+   WARP_MAX_U32,
+   WARP_MAX_S32,
+   WARP_MAX_F32,
+   WARP_SETP_U32,
+   WARP_SETP_S32,
+   WARP_SETP_F32,
+   WARP_SELP
+};
+
+typedef unsigned long long warp_reg_t;
+
+static inline float f32_of( warp_reg_t x )
+{
+   unsigned u = (unsigned)x;
+   float f;
+   memcpy(&f,&u,sizeof(f));
+   return f;
+}
+
+static inline warp_reg_t reg_of_f32( float f )
+{
+   unsigned u;
+   memcpy(&u,&f,sizeof(u));
+   return u;
+}
+
+static bool setp_cmpop_supported( unsigned type, unsigned cmpop )
+{
+   switch ( cmpop ) {
+   case EQ_OPTION: case NE_OPTION: case LT_OPTION:
+   case LE_OPTION: case GT_OPTION: case GE_OPTION:
+      return true;
+   case LO_OPTION: case LS_OPTION: case HI_OPTION: case HS_OPTION:
+      return type == U32_TYPE;
+   case EQU_OPTION: case NEU_OPTION: case LTU_OPTION: case LEU_OPTION:
+   case GTU_OPTION: case GEU_OPTION: case NUM_OPTION: case NAN_OPTION:
+      return type == F32_TYPE;
+   default:
+      return false;
+   }
+}
+
+unsigned ptx_warp_kernel( const ptx_instruction *pI )
+{
+   if ( pI->is_exit() || pI->has_memory_read() || pI->has_memory_write() )
+      return WARP_NONE;
+   if ( pI->has_pred() && !pI->pred_is_reg() )
+      return WARP_NONE;
+   unsigned n = pI->get_num_operands();
+   if ( n < 2 || n > 4 || !pI->dst().is_predecoded_reg() )
+      return WARP_NONE;
+   for ( unsigned o=1; o < n; o++ ) {
+      const operand_info &op = pI->operand_lookup(o);
+      if ( !op.is_predecoded_reg() && !op.is_predecoded_literal() )
+         return WARP_NONE;
+   }
+
+   unsigned type = pI->get_type();
+   bool i32 = (type == S32_TYPE) || (type == U32_TYPE);
+   bool b32 = (type == B32_TYPE) || (type == U32_TYPE);
+   bool f32_rn = (type == F32_TYPE) && (pI->rounding_mode() == RN_OPTION);
+   bool lo = pI->is_lo() && !pI->is_hi() && !pI->is_wide();
+   switch ( pI->get_opcode() ) {
+   case MOV_OP:
+      if ( n != 2 || (type == PRED_TYPE && pI->src1().is_literal()) ) break;
+      if ( type == BB64_TYPE || type == BB128_TYPE || type == FF64_TYPE ) break;
+      return WARP_MOV;
+   case AND_OP:
+   case OR_OP:
+   case XOR_OP:
+      if ( n != 3 || type == PRED_TYPE ) break;
+      if ( type == BB64_TYPE || type == BB128_TYPE || type == FF64_TYPE ) break;
+      return (pI->get_opcode() == AND_OP)? WARP_AND : (pI->get_opcode() == OR_OP)? WARP_OR : WARP_XOR;
+   case ADD_OP:
+      if ( n != 3 ) break;
+      if ( i32 ) return WARP_ADD_I32;
+      if ( f32_rn ) return WARP_ADD_F32;
+      break;
+   case SUB_OP:
+      // sub_impl ignores the rounding modifier
+      if ( n != 3 ) break;
+      if ( i32 || type == B32_TYPE ) return WARP_SUB_I32;
+      if ( type == F32_TYPE ) return WARP_SUB_F32;
+      break;
+   case MUL_OP:
+      if ( n != 3 ) break;
+      if ( i32 && lo ) return WARP_MUL_LO_I32;
+      if ( f32_rn && !pI->saturation_mode() ) return WARP_MUL_F32;
+      break;
+   case MAD_OP:
+   case FMA_OP:
+      if ( n != 4 ) break;
+      if ( i32 && lo ) return WARP_MAD_LO_I32;
+      if ( f32_rn && !pI->saturation_mode() ) return WARP_MAD_F32;
+      break;
+   case SHL_OP:
+      if ( n == 3 && b32 ) return WARP_SHL_B32;
+      break;
+   case SHR_OP:
+      if ( n != 3 ) break;
+      if ( b32 ) return WARP_SHR_U32;
+      if ( type == S32_TYPE ) return WARP_SHR_S32;
+      break;
+   case MIN_OP:
+   case MAX_OP: {
+      if ( n != 3 ) break;
+      bool min = pI->get_opcode() == MIN_OP;
+      if ( type == U32_TYPE ) return min? WARP_MIN_U32 : WARP_MAX_U32;
+      if ( type == S32_TYPE ) return min? WARP_MIN_S32 : WARP_MAX_S32;
+      if ( type == F32_TYPE ) return min? WARP_MIN_F32 : WARP_MAX_F32;
+      break;
+   }
+   case SETP_OP:
+      if ( n != 3 || !setp_cmpop_supported(type,pI->get_cmpop()) ) break;
+      if ( type == U32_TYPE ) return WARP_SETP_U32;
+      if ( type == S32_TYPE ) return WARP_SETP_S32;
+      if ( type == F32_TYPE ) return WARP_SETP_F32;
+      break;
+   case SELP_OP:
+      if ( n != 4 || !pI->src3().is_predecoded_reg() ) break;
+      if ( type == BB64_TYPE || type == BB128_TYPE || type == FF64_TYPE ) break;
+      return WARP_SELP;
+   default:
+      break;
+   }
+   return WARP_NONE;
+}
+
+// one pass over the n executing lanes; a, b, c are the lane-major sources
+#define WARP_LOOP(expr) for ( unsigned i=0; i < n; i++ ) d[i] = (expr)
+#define A32 ((unsigned)a[i])
+#define B32 ((unsigned)b[i])
+#define C32 ((unsigned)c[i])
+#define AS32 ((int)a[i])
+#define BS32 ((int)b[i])
+#define AF f32_of(a[i])
+#define BF f32_of(b[i])
+#define CF f32_of(c[i])
+#define NAN_F(x) ((x) != (x))
+
+// setp leaves 0 in the predicate when the comparison holds (ptxplus zero flag)
+#define WARP_SETP(cmp) WARP_LOOP( (cmp)? 0 : 1 )
+
+static void warp_setp( unsigned kernel, unsigned cmpop, unsigned n,
+                       const warp_reg_t *a, const warp_reg_t *b, warp_reg_t *d )
+{
+   switch ( kernel ) {
+   case WARP_SETP_U32:
+      switch ( cmpop ) {
+      case EQ_OPTION: WARP_SETP(A32 == B32); break;
+      case NE_OPTION: WARP_SETP(A32 != B32); break;
+      case LT_OPTION: case LO_OPTION: WARP_SETP(A32 < B32); break;
+      case LE_OPTION: case LS_OPTION: WARP_SETP(A32 <= B32); break;
+      case GT_OPTION: case HI_OPTION: WARP_SETP(A32 > B32); break;
+      case GE_OPTION: case HS_OPTION: WARP_SETP(A32 >= B32); break;
+      default: assert(0); break;
+      }
+      break;
+   case WARP_SETP_S32:
+      switch ( cmpop ) {
+      case EQ_OPTION: WARP_SETP(AS32 == BS32); break;
+      case NE_OPTION: WARP_SETP(AS32 != BS32); break;
+      case LT_OPTION: WARP_SETP(AS32 < BS32); break;
+      case LE_OPTION: WARP_SETP(AS32 <= BS32); break;
+      case GT_OPTION: WARP_SETP(AS32 > BS32); break;
+      case GE_OPTION: WARP_SETP(AS32 >= BS32); break;
+      default: assert(0); break;
+      }
+      break;
+   case WARP_SETP_F32:
+      switch ( cmpop ) {
+      case EQ_OPTION:  WARP_SETP((AF == BF) && !NAN_F(AF) && !NAN_F(BF)); break;
+      case NE_OPTION:  WARP_SETP((AF != BF) && !NAN_F(AF) && !NAN_F(BF)); break;
+      case LT_OPTION:  WARP_SETP((AF < BF ) && !NAN_F(AF) && !NAN_F(BF)); break;
+      case LE_OPTION:  WARP_SETP((AF <= BF) && !NAN_F(AF) && !NAN_F(BF)); break;
+      case GT_OPTION:  WARP_SETP((AF > BF ) && !NAN_F(AF) && !NAN_F(BF)); break;
+      case GE_OPTION:  WARP_SETP((AF >= BF) && !NAN_F(AF) && !NAN_F(BF)); break;
+      case EQU_OPTION: WARP_SETP((AF == BF) || NAN_F(AF) || NAN_F(BF)); break;
+      case NEU_OPTION: WARP_SETP((AF != BF) || NAN_F(AF) || NAN_F(BF)); break;
+      case LTU_OPTION: WARP_SETP((AF < BF ) || NAN_F(AF) || NAN_F(BF)); break;
+      case LEU_OPTION: WARP_SETP((AF <= BF) || NAN_F(AF) || NAN_F(BF)); break;
+      case GTU_OPTION: WARP_SETP((AF > BF ) || NAN_F(AF) || NAN_F(BF)); break;
+      case GEU_OPTION: WARP_SETP((AF >= BF) || NAN_F(AF) || NAN_F(BF)); break;
+      case NUM_OPTION: WARP_SETP(!NAN_F(AF) && !NAN_F(BF)); break;
+      case NAN_OPTION: WARP_SETP(NAN_F(AF) || NAN_F(BF)); break;
+      default: assert(0); break;
+      }
+      break;
+   default:
+      assert(0);
+   }
+}
+
+static void warp_kernel( const ptx_instruction *pI, unsigned kernel, unsigned n,
+                         const warp_reg_t *a, const warp_reg_t *b, const warp_reg_t *c,
+                         warp_reg_t *d )
+{
+   switch ( kernel ) {
+   case WARP_MOV:        WARP_LOOP( a[i] ); break;
+   case WARP_AND:        WARP_LOOP( a[i] & b[i] ); break;
+   case WARP_OR:         WARP_LOOP( a[i] | b[i] ); break;
+   case WARP_XOR:        WARP_LOOP( a[i] ^ b[i] ); break;
+   // the integer forms keep the carry out in bit 32, as add_impl/sub_impl do
+   case WARP_ADD_I32:    WARP_LOOP( (warp_reg_t)A32 + B32 ); break;
+   case WARP_SUB_I32:    WARP_LOOP( (warp_reg_t)A32 - B32 + 0x100000000ULL ); break;
+   case WARP_ADD_F32:    WARP_LOOP( reg_of_f32(AF + BF) ); break;
+   case WARP_SUB_F32:    WARP_LOOP( reg_of_f32(AF - BF) ); break;
+   case WARP_MUL_LO_I32: WARP_LOOP( (unsigned)(A32 * B32) ); break;
+   case WARP_MUL_F32:    WARP_LOOP( reg_of_f32(AF * BF) ); break;
+   case WARP_MAD_LO_I32: WARP_LOOP( (unsigned)(A32 * B32 + C32) ); break;
+   case WARP_MAD_F32:    WARP_LOOP( reg_of_f32(AF * BF + CF) ); break;
+   case WARP_SHL_B32:    WARP_LOOP( (B32 >= 32)? 0 : (unsigned)(A32 << B32) ); break;
+   case WARP_SHR_U32:    WARP_LOOP( (B32 < 32)? (A32 >> B32) : 0 ); break;
+   // shr.s32 sign extends into the upper half of the register
+   case WARP_SHR_S32:    WARP_LOOP( (warp_reg_t)(long long)((B32 < 32)? (AS32 >> B32) : (AS32 < 0)? -1 : 0) ); break;
+   case WARP_MIN_U32:    WARP_LOOP( (A32 < B32)? A32 : B32 ); break;
+   case WARP_MIN_S32:    WARP_LOOP( (unsigned)((AS32 < BS32)? AS32 : BS32) ); break;
+   case WARP_MIN_F32:    WARP_LOOP( reg_of_f32(NAN_F(AF)? BF : NAN_F(BF)? AF : (AF < BF)? AF : BF) ); break;
+   case WARP_MAX_U32:    WARP_LOOP( (A32 > B32)? A32 : B32 ); break;
+   case WARP_MAX_S32:    WARP_LOOP( (unsigned)((AS32 > BS32)? AS32 : BS32) ); break;
+   case WARP_MAX_F32:    WARP_LOOP( reg_of_f32(NAN_F(AF)? BF : NAN_F(BF)? AF : (AF > BF)? AF : BF) ); break;
+   case WARP_SETP_U32:
+   case WARP_SETP_S32:
+   case WARP_SETP_F32:   warp_setp(kernel,pI->get_cmpop(),n,a,b,d); break;
+   case WARP_SELP:       WARP_LOOP( (c[i] & 1)? b[i] : a[i] ); break;
+   default:
+      printf("GPGPU-Sim PTX: ERROR ** unknown warp kernel %u for '%s'\n", kernel, pI->get_source());
+      abort();
+   }
+}
+
+// Gathers source operand o of the executing lanes into v
+static void warp_gather( const ptx_instruction *pI, unsigned o, unsigned n,
+                         ptx_thread_info **lanes, warp_reg_t *v )
+{
+   const operand_info &op = pI->operand_lookup(o);
+   if ( op.is_predecoded_literal() ) {
+      warp_reg_t x = op.get_predecoded_literal().u64;
+      for ( unsigned i=0; i < n; i++ )
+         v[i] = x;
+   } else {
+      const symbol *reg = op.get_symbol();
+      for ( unsigned i=0; i < n; i++ )
+         v[i] = lanes[i]->get_reg(reg).u64;
+   }
+}
+
+bool ptx_thread_info::ptx_exec_warp_inst( ptx_thread_info **threads, warp_inst_t &inst, unsigned warp_size )
+{
+   const ptx_instruction *pI = function_info::pc_to_instruction(inst.pc);
+   unsigned kernel = pI->get_warp_kernel();
+   if ( kernel == WARP_NONE || g_debug_execution >= 5 )
+      return false;
+
+   // lanes active on entry, and the ones whose predicate lets them execute
+   unsigned n_active = 0, n_lanes = 0;
+   unsigned active_id[MAX_WARP_SIZE];
+   bool skip[MAX_WARP_SIZE];
+   unsigned lane_id[MAX_WARP_SIZE];
+   ptx_thread_info *lanes[MAX_WARP_SIZE];
+   for ( unsigned t=0; t < warp_size; t++ ) {
+      if ( !inst.active(t) )
+         continue;
+      ptx_thread_info *thread = threads[t];
+      if ( n_active == 0 ) {
+         const gpgpu_functional_sim_config &config = thread->get_config();
+         if ( !config.warp_exec() || config.get_ptx_inst_debug_to_file() )
+            return false;
+      }
+      addr_t pc = thread->next_instr();
+      assert( pc == inst.pc ); // make sure timing model and functional model are in sync
+      thread->set_npc( pc + pI->inst_size() );
+      thread->clearRPC();
+      thread->m_last_set_operand_value.u64 = 0;
+      if ( thread->is_done() ) {
+         printf("attempted to execute instruction on a thread that is already done.\n");
+         assert(0);
+      }
+      bool skipped = pI->has_pred() && thread->pred_skip(pI);
+      active_id[n_active] = t;
+      skip[n_active++] = skipped;
+      if ( skipped ) {
+         inst.set_not_active(t);
+      } else {
+         lane_id[n_lanes] = t;
+         lanes[n_lanes++] = thread;
+      }
+   }
+
+   warp_reg_t a[MAX_WARP_SIZE], b[MAX_WARP_SIZE], c[MAX_WARP_SIZE], d[MAX_WARP_SIZE];
+   unsigned n_src = pI->get_num_operands() - 1;
+   warp_gather(pI,1,n_lanes,lanes,a);
+   if ( n_src > 1 ) warp_gather(pI,2,n_lanes,lanes,b);
+   if ( n_src > 2 ) warp_gather(pI,3,n_lanes,lanes,c);
+   warp_kernel(pI,kernel,n_lanes,a,b,c,d);
+
+   const symbol *dst = pI->dst().get_symbol();
+   for ( unsigned i=0; i < n_lanes; i++ ) {
+      ptx_reg_t data;
+      data.u64 = d[i];
+      lanes[i]->set_reg(dst,data);
+      inst.space = undefined_space;
+      inst.set_addr(lane_id[i], (new_addr_type)0xFEEBDAED);
+      inst.data_size = 0;
+      assert( inst.memory_op == no_memory_op );
+   }
+
+   for ( unsigned i=0; i < n_active; i++ ) {
+      ptx_thread_info *thread = threads[active_id[i]];
+      thread->update_pc();
+      thread->count_inst(pI, skip[i]? 0 : pI->get_op_classification());
+   }
+   return true;
+}
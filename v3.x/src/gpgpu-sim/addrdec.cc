@@ -27,8 +27,9 @@
 
 
 #include <string.h>
+#include <stdint.h>
+#include <vector>
 #include "addrdec.h"
-#include "gpu-sim.h"
 #include "../option_parser.h"
 
 
@@ -36,6 +37,11 @@
 static long int powli( long int x, long int y );
 static new_addr_type addrdec_packbits( new_addr_type mask, new_addr_type val, unsigned char high, unsigned char low);
 static void addrdec_getmasklimit(new_addr_type mask, unsigned char *high, unsigned char *low); 
+static void addrdec_row_hash_init(); 
+static inline unsigned addrdec_row_hash(unsigned seed); 
+static inline unsigned addrdec_row_hash_libc(unsigned seed); 
+
+bool g_addrdec_fast_row_hash = false;
 
 unsigned int LOGB2_32( unsigned int v ) 
 {
@@ -94,15 +100,14 @@ void linear_to_raw_address_translation::addrdec_setoption(option_parser_t opp, s
 new_addr_type linear_to_raw_address_translation::partition_address( new_addr_type addr ) const 
 { 
    if (!gap) {
-      return addrdec_packbits( ~(addrdec_mask[CHIP] | sub_partition_id_mask), addr, 64, 0 ); 
+      return m_partition_field.extract(addr); 
    } else {
       // see addrdec_tlx for explanation 
       unsigned long long int partition_addr; 
       partition_addr = ( (addr>>ADDR_CHIP_S) / m_n_channel) << ADDR_CHIP_S; 
       partition_addr |= addr & ((1 << ADDR_CHIP_S) - 1); 
       // remove the part of address that constributes to the sub partition ID
-      partition_addr = addrdec_packbits( ~sub_partition_id_mask, partition_addr, 64, 0); 
-      return partition_addr; 
+      return m_sub_partition_field.extract(partition_addr); 
    }
 }
 
@@ -111,22 +116,30 @@ void linear_to_raw_address_translation::addrdec_tlx(new_addr_type addr, addrdec_
 //    RRRRRRRRRRRR.BBBB.DDD.CCCCCC.SSSSSS
     tlx->burst = addr % 64ULL;
     tlx->col = (addr >> 6) % 64ULL; 
-    uint64_t rest_of_addr = addr >> 12ULL;
-    srand(rest_of_addr);
-    rand();
-    rand();
-    int robach = rand();
-    tlx->chip = robach % m_n_channel;
-    int roba = robach / m_n_channel;
-    unsigned num_bk_bits = __builtin_popcountl(addrdec_mask[BK]);
-    unsigned num_banks = 1ULL << num_bk_bits;
-    tlx->bk = roba % num_banks; 
-    tlx->row = (roba / num_banks) % 4096ULL; // 2^12 rows
-//    return;
+    unsigned robach = g_addrdec_fast_row_hash? addrdec_row_hash(addr >> 12ULL) 
+                                             : addrdec_row_hash_libc(addr >> 12ULL);
+    unsigned roba = (robach * m_chip_div_magic) >> m_chip_div_shift; // robach / m_n_channel
+    tlx->chip = robach - roba * m_n_channel;
+    tlx->bk = roba & ((1U << m_bk_bits) - 1); 
+    tlx->row = (roba >> m_bk_bits) % 4096U; // 2^12 rows
+
+   // combine the chip address and the lower bits of DRAM bank address to form the subpartition ID
+   unsigned sub_partition_addr_mask = m_n_sub_partition_in_channel - 1; 
+   tlx->sub_partition = (tlx->chip << m_sub_partition_shift) 
+                        + (tlx->bk & sub_partition_addr_mask); 
+}
 
+void linear_to_raw_address_translation::addrdec_tlx_hetero(new_addr_type addr, addrdec_t *tlx, unsigned partition_offset) const {
+    addrdec_tlx(addr, tlx);
+    //tlx->sub_partition is the global subpartiton id
+    tlx->sub_partition += partition_offset;
+}
 
-    /*
-   unsigned long long int addr_for_chip,rest_of_addr;
+// Decode through the mapping masks (-gpgpu_mem_addr_mapping / -gpgpu_mem_address_mask).
+// addrdec_tlx() hashes the row address for chip/bank/row instead, so only the
+// address explorer uses this path to tell mappings apart. 
+void linear_to_raw_address_translation::addrdec_tlx_masked(new_addr_type addr, addrdec_t *tlx) const
+{
    unsigned nchipbits = (m_n_channel == 1) ? 0 : (::LOGB2_32(m_n_channel - 1) + 1);
    unsigned xor_bits = (addr>>(ADDR_CHIP_S + nchipbits)) & ((1 << nchipbits) - 1);
    if (!gap) {
@@ -138,17 +151,14 @@ void linear_to_raw_address_translation::addrdec_tlx(new_addr_type addr, addrdec_
       tlx->col  = addrdec_packbits(addrdec_mask[COL], addr, addrdec_mkhigh[COL], addrdec_mklow[COL]);
       tlx->burst= addrdec_packbits(addrdec_mask[BURST], addr, addrdec_mkhigh[BURST], addrdec_mklow[BURST]);
    } else {
-      // Split the given address at ADDR_CHIP_S into (MSBs,LSBs)
-      // - extract chip address using modulus of MSBs
-      // - recreate the rest of the address by stitching the quotient of MSBs and the LSBs
+      // see addrdec_tlx_reference for the split at ADDR_CHIP_S 
       unsigned addr_till_ch_1 = (addr>>ADDR_CHIP_S);
       unsigned addr_till_ch_2 = (addr>>(ADDR_CHIP_S + nchipbits));
       unsigned addr_ch_bits = addr_till_ch_1 & ((1 << nchipbits) - 1);
       unsigned addr_ch_xor_bits = addr_till_ch_2 & ((1 << nchipbits) - 1);
-      addr_for_chip = (addr_till_ch_2<<nchipbits | (addr_ch_xor_bits ^ addr_ch_bits)) % m_n_channel;
+      unsigned long long int addr_for_chip = (addr_till_ch_2<<nchipbits | (addr_ch_xor_bits ^ addr_ch_bits)) % m_n_channel;
 
-//      addr_for_chip = (addr>>ADDR_CHIP_S) % m_n_channel; 
-      rest_of_addr = ( (addr>>ADDR_CHIP_S) / m_n_channel) << ADDR_CHIP_S; 
+      unsigned long long int rest_of_addr = ( (addr>>ADDR_CHIP_S) / m_n_channel) << ADDR_CHIP_S; 
       rest_of_addr |= addr & ((1 << ADDR_CHIP_S) - 1); 
 
       tlx->chip = addr_for_chip; 
@@ -157,23 +167,15 @@ void linear_to_raw_address_translation::addrdec_tlx(new_addr_type addr, addrdec_
       tlx->col  = addrdec_packbits(addrdec_mask[COL], rest_of_addr, addrdec_mkhigh[COL], addrdec_mklow[COL]);
       tlx->burst= addrdec_packbits(addrdec_mask[BURST], rest_of_addr, addrdec_mkhigh[BURST], addrdec_mklow[BURST]);
    }
-    unsigned num_bk_bits = __builtin_popcountl(addrdec_mask[BK]);
-    unsigned row_bits = tlx->row & ((1 << num_bk_bits) - 1);
-    tlx->bk ^= row_bits; 
-    */
+   unsigned num_bk_bits = __builtin_popcountll(addrdec_mask[BK]);
+   unsigned row_bits = tlx->row & ((1 << num_bk_bits) - 1);
+   tlx->bk ^= row_bits; 
 
-   // combine the chip address and the lower bits of DRAM bank address to form the subpartition ID
    unsigned sub_partition_addr_mask = m_n_sub_partition_in_channel - 1; 
    tlx->sub_partition = tlx->chip * m_n_sub_partition_in_channel
                         + (tlx->bk & sub_partition_addr_mask); 
 }
 
-void linear_to_raw_address_translation::addrdec_tlx_hetero(new_addr_type addr, addrdec_t *tlx, unsigned partition_offset) const {
-    addrdec_tlx(addr, tlx);
-    //tlx->sub_partition is the global subpartiton id
-    tlx->sub_partition += partition_offset;
-}
-
 void linear_to_raw_address_translation::addrdec_parseoption(const char *option)
 {
    unsigned int dramid_start = 0;
@@ -387,13 +389,133 @@ void linear_to_raw_address_translation::init(unsigned int n_channel, unsigned in
    }
    printf("sub_partition_id_mask = %016llx\n", sub_partition_id_mask);
 
+   addrdec_compile(); 
+
    if (run_test) {
       sweep_test(); 
    }
 }
 
+// precompute everything addrdec_tlx() and partition_address() need per request 
+void linear_to_raw_address_translation::addrdec_compile()
+{
+   m_partition_field.compile(~(addrdec_mask[CHIP] | sub_partition_id_mask)); 
+   m_sub_partition_field.compile(~sub_partition_id_mask); 
+
+   m_bk_bits = __builtin_popcountll(addrdec_mask[BK]); 
+   m_sub_partition_shift = LOGB2_32(m_n_sub_partition_in_channel); 
+
+   // x / d == (x * ceil(2^k / d)) >> k for all x < 2^31 when k = 31 + ceil(log2(d))
+   unsigned ceil_log2_channel = (m_n_channel == 1)? 0 : (LOGB2_32(m_n_channel - 1) + 1); 
+   m_chip_div_shift = 31 + ceil_log2_channel; 
+   m_chip_div_magic = ((1ULL << m_chip_div_shift) + m_n_channel - 1) / m_n_channel; 
+
+   addrdec_row_hash_init(); 
+}
+
+void addrdec_bitfield::compile(new_addr_type mask)
+{
+   m_mask = mask; 
+   m_width = 0; 
+   m_n_runs = 0; 
+   unsigned i = 0; 
+   while (i < 64) {
+      if ((mask & (1ULL << i)) == 0) {
+         i++; 
+         continue; 
+      }
+      unsigned start = i; 
+      while (i < 64 and (mask & (1ULL << i)) != 0) 
+         i++; 
+      unsigned len = i - start; 
+      new_addr_type run_bits = (len == 64)? ~0ULL : ((1ULL << len) - 1); 
+      m_shift[m_n_runs] = start - m_width; 
+      m_run_mask[m_n_runs] = run_bits << m_width; 
+      m_width += len; 
+      m_n_runs++; 
+   }
+}
+
 #include "../tr1_hash_map.h" 
 
+new_addr_type linear_to_raw_address_translation::partition_address_reference( new_addr_type addr ) const 
+{ 
+   if (!gap) {
+      return addrdec_packbits( ~(addrdec_mask[CHIP] | sub_partition_id_mask), addr, 64, 0 ); 
+   } else {
+      // see addrdec_tlx for explanation 
+      unsigned long long int partition_addr; 
+      partition_addr = ( (addr>>ADDR_CHIP_S) / m_n_channel) << ADDR_CHIP_S; 
+      partition_addr |= addr & ((1 << ADDR_CHIP_S) - 1); 
+      // remove the part of address that constributes to the sub partition ID
+      partition_addr = addrdec_packbits( ~sub_partition_id_mask, partition_addr, 64, 0); 
+      return partition_addr; 
+   }
+}
+
+void linear_to_raw_address_translation::addrdec_tlx_reference(new_addr_type addr, addrdec_t *tlx) const
+{  
+//    RRRRRRRRRRRR.BBBB.DDD.CCCCCC.SSSSSS
+    tlx->burst = addr % 64ULL;
+    tlx->col = (addr >> 6) % 64ULL; 
+    uint64_t rest_of_addr = addr >> 12ULL;
+    srand(rest_of_addr);
+    rand();
+    rand();
+    int robach = rand();
+    tlx->chip = robach % m_n_channel;
+    int roba = robach / m_n_channel;
+    unsigned num_bk_bits = __builtin_popcountl(addrdec_mask[BK]);
+    unsigned num_banks = 1ULL << num_bk_bits;
+    tlx->bk = roba % num_banks; 
+    tlx->row = (roba / num_banks) % 4096ULL; // 2^12 rows
+//    return;
+
+
+    /*
+   unsigned long long int addr_for_chip,rest_of_addr;
+   unsigned nchipbits = (m_n_channel == 1) ? 0 : (::LOGB2_32(m_n_channel - 1) + 1);
+   unsigned xor_bits = (addr>>(ADDR_CHIP_S + nchipbits)) & ((1 << nchipbits) - 1);
+   if (!gap) {
+      tlx->chip = addrdec_packbits(addrdec_mask[CHIP], addr, addrdec_mkhigh[CHIP], addrdec_mklow[CHIP]);
+      tlx->chip ^= xor_bits; 
+
+      tlx->bk   = addrdec_packbits(addrdec_mask[BK], addr, addrdec_mkhigh[BK], addrdec_mklow[BK]);
+      tlx->row  = addrdec_packbits(addrdec_mask[ROW], addr, addrdec_mkhigh[ROW], addrdec_mklow[ROW]);
+      tlx->col  = addrdec_packbits(addrdec_mask[COL], addr, addrdec_mkhigh[COL], addrdec_mklow[COL]);
+      tlx->burst= addrdec_packbits(addrdec_mask[BURST], addr, addrdec_mkhigh[BURST], addrdec_mklow[BURST]);
+   } else {
+      // Split the given address at ADDR_CHIP_S into (MSBs,LSBs)
+      // - extract chip address using modulus of MSBs
+      // - recreate the rest of the address by stitching the quotient of MSBs and the LSBs
+      unsigned addr_till_ch_1 = (addr>>ADDR_CHIP_S);
+      unsigned addr_till_ch_2 = (addr>>(ADDR_CHIP_S + nchipbits));
+      unsigned addr_ch_bits = addr_till_ch_1 & ((1 << nchipbits) - 1);
+      unsigned addr_ch_xor_bits = addr_till_ch_2 & ((1 << nchipbits) - 1);
+      addr_for_chip = (addr_till_ch_2<<nchipbits | (addr_ch_xor_bits ^ addr_ch_bits)) % m_n_channel;
+
+//      addr_for_chip = (addr>>ADDR_CHIP_S) % m_n_channel; 
+      rest_of_addr = ( (addr>>ADDR_CHIP_S) / m_n_channel) << ADDR_CHIP_S; 
+      rest_of_addr |= addr & ((1 << ADDR_CHIP_S) - 1); 
+
+      tlx->chip = addr_for_chip; 
+      tlx->bk   = addrdec_packbits(addrdec_mask[BK], rest_of_addr, addrdec_mkhigh[BK], addrdec_mklow[BK]);
+      tlx->row  = addrdec_packbits(addrdec_mask[ROW], rest_of_addr, addrdec_mkhigh[ROW], addrdec_mklow[ROW]);
+      tlx->col  = addrdec_packbits(addrdec_mask[COL], rest_of_addr, addrdec_mkhigh[COL], addrdec_mklow[COL]);
+      tlx->burst= addrdec_packbits(addrdec_mask[BURST], rest_of_addr, addrdec_mkhigh[BURST], addrdec_mklow[BURST]);
+   }
+    unsigned num_bk_bits = __builtin_popcountl(addrdec_mask[BK]);
+    unsigned row_bits = tlx->row & ((1 << num_bk_bits) - 1);
+    tlx->bk ^= row_bits; 
+    */
+
+   // combine the chip address and the lower bits of DRAM bank address to form the subpartition ID
+   unsigned sub_partition_addr_mask = m_n_sub_partition_in_channel - 1; 
+   tlx->sub_partition = tlx->chip * m_n_sub_partition_in_channel
+                        + (tlx->bk & sub_partition_addr_mask); 
+}
+
+
 bool operator==(const addrdec_t &x, const addrdec_t &y) 
 {
    return ( memcmp(&x, &y, sizeof(addrdec_t)) == 0 ); 
@@ -418,8 +540,35 @@ public:
 };
 
 // a simple sweep test to ensure that two linear addresses are not mapped to the same raw address 
+// (preceded by a randomized check that the compiled decoder agrees with the reference decoder)
 void linear_to_raw_address_translation::sweep_test() const
 {
+   const unsigned n_random_test = 1000000; 
+   unsigned long long xorshift = 0x2545F4914F6CDD1DULL; 
+   bool fast_row_hash = g_addrdec_fast_row_hash; 
+   g_addrdec_fast_row_hash = true; // check the precomputed row hash as well
+   for (unsigned n = 0; n < n_random_test; n++) {
+      xorshift ^= xorshift << 13; 
+      xorshift ^= xorshift >> 7; 
+      xorshift ^= xorshift << 17; 
+      new_addr_type raw_addr = xorshift >> (n % 32); // cover both small and very large addresses
+
+      addrdec_t tlx, tlx_ref; 
+      memset(&tlx, 0, sizeof(addrdec_t)); 
+      memset(&tlx_ref, 0, sizeof(addrdec_t)); 
+      addrdec_tlx(raw_addr, &tlx); 
+      addrdec_tlx_reference(raw_addr, &tlx_ref); 
+
+      if (!(tlx == tlx_ref) or partition_address(raw_addr) != partition_address_reference(raw_addr)) {
+         printf("[AddrDec] ** Error: compiled address decoder disagrees with reference decoder for address %llx\n", raw_addr); 
+         printf("[AddrDec] compiled:  "); tlx.print(stdout); printf(" partition_addr:%llx\n", partition_address(raw_addr)); 
+         printf("[AddrDec] reference: "); tlx_ref.print(stdout); printf(" partition_addr:%llx\n", partition_address_reference(raw_addr)); 
+         abort(); 
+      }
+   }
+   g_addrdec_fast_row_hash = fast_row_hash; 
+   printf("[AddrDec] compiled decoder matches reference decoder on %u random addresses\n", n_random_test); 
+
    new_addr_type sweep_range = 16 * 1024 * 1024; 
 
 #if tr1_hash_map_ismap == 1
@@ -505,3 +654,66 @@ static void addrdec_getmasklimit(new_addr_type mask, unsigned char *high, unsign
       }
    }
 }
+
+
+// Row/bank/chip hash used by addrdec_tlx(): the third rand() after srand(seed). 
+// glibc's rand() is an additive feedback generator: r[0] = seed, r[1..30] from 
+// the Park-Miller LCG, r[31..33] = r[0..2], r[i] = r[i-31] + r[i-3] (mod 2^32) 
+// thereafter, and the k-th rand() after seeding returns r[343+k] >> 1.  r[346] is 
+// therefore a fixed linear combination of r[0..30], so instead of reseeding the 
+// global generator (310 discarded draws) on every decode, the combination is 
+// precomputed once (-gpgpu_mem_addr_fast_row_hash). 
+#ifdef __GLIBC__
+static unsigned addrdec_row_hash_coeff[31]; 
+static bool addrdec_row_hash_ready = false; 
+
+static void addrdec_row_hash_init()
+{
+   if (addrdec_row_hash_ready) return; 
+   std::vector< std::vector<unsigned> > coeff(347, std::vector<unsigned>(31, 0)); 
+   for (unsigned i = 0; i < 31; i++) 
+      coeff[i][i] = 1; 
+   for (unsigned i = 31; i < 34; i++) 
+      coeff[i] = coeff[i - 31]; 
+   for (unsigned i = 34; i < 347; i++) 
+      for (unsigned j = 0; j < 31; j++) 
+         coeff[i][j] = coeff[i - 31][j] + coeff[i - 3][j]; 
+   for (unsigned j = 0; j < 31; j++) 
+      addrdec_row_hash_coeff[j] = coeff[346][j]; 
+   addrdec_row_hash_ready = true; 
+}
+
+static inline unsigned addrdec_row_hash(unsigned seed)
+{
+   if (seed == 0) seed = 1; // as srand()
+   int32_t word = seed; 
+   unsigned result = addrdec_row_hash_coeff[0] * (unsigned)word; 
+   for (unsigned i = 1; i < 31; i++) {
+      // word = (16807 * word) % 2147483647 without overflowing 31 bits (same as glibc)
+      long int hi = word / 127773; 
+      long int lo = word % 127773; 
+      word = 16807 * lo - 2836 * hi; 
+      if (word < 0) 
+         word += 2147483647; 
+      result += addrdec_row_hash_coeff[i] * (unsigned)word; 
+   }
+   return result >> 1; 
+}
+#else
+static void addrdec_row_hash_init() { }
+
+static inline unsigned addrdec_row_hash(unsigned seed)
+{
+   return addrdec_row_hash_libc(seed); 
+}
+#endif
+
+// the original hash; leaves the global generator seeded from the row, which
+// later rand() draws (e.g. the migration sampling in l2cache.cc) depend on
+static inline unsigned addrdec_row_hash_libc(unsigned seed)
+{
+   srand(seed); 
+   rand(); 
+   rand(); 
+   return rand(); 
+}
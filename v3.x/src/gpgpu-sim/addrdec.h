@@ -35,7 +35,16 @@
 
 #include "../abstract_hardware_model.h"
 
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
 unsigned int LOGB2_32( unsigned int v );
+
+// -gpgpu_mem_addr_fast_row_hash: compute the row hash of addrdec_tlx()
+// without reseeding the C library generator. Faster, but rand() users such
+// as the migration sampling then see a different sequence.
+extern bool g_addrdec_fast_row_hash;
 void option_parser_register_mem(option_parser_t opp, 
                             std::string name, 
                             enum option_dtype type, 
@@ -58,6 +67,36 @@ struct addrdec_t {
    unsigned sub_partition; 
 };
 
+// Gathers the bits selected by a mask into a contiguous value (same result as
+// addrdec_packbits).  The mask is compiled once at init: with BMI2 the gather
+// is a single PEXT, otherwise it is one shift/mask per contiguous run of bits.
+class addrdec_bitfield {
+public:
+   addrdec_bitfield() { compile(0); }
+   void compile(new_addr_type mask);
+
+   new_addr_type extract(new_addr_type val) const 
+   {
+#ifdef __BMI2__
+      return _pext_u64(val, m_mask);
+#else
+      new_addr_type result = 0;
+      for (unsigned r = 0; r < m_n_runs; r++) 
+         result |= (val >> m_shift[r]) & m_run_mask[r];
+      return result;
+#endif
+   }
+   new_addr_type mask() const { return m_mask; }
+   unsigned width() const { return m_width; }
+
+private:
+   new_addr_type m_mask;
+   unsigned m_width;
+   unsigned m_n_runs;
+   unsigned char m_shift[32];       // right shift that lands each run at its packed position 
+   new_addr_type m_run_mask[32];    // each run's bits at their packed position 
+};
+
 class linear_to_raw_address_translation {
 public:
    linear_to_raw_address_translation();
@@ -67,11 +106,19 @@ public:
    // accessors
    void addrdec_tlx(new_addr_type addr, addrdec_t *tlx) const; 
    void addrdec_tlx_hetero(new_addr_type addr, addrdec_t *tlx, unsigned patition_offset) const; 
+   void addrdec_tlx_masked(new_addr_type addr, addrdec_t *tlx) const; // mask-based decode, no row hash
    new_addr_type partition_address( new_addr_type addr ) const;
+   unsigned num_channel() const { return m_n_channel; }
+   unsigned num_bank() const { return 1U << m_bk_bits; } // range of addrdec_t::bk
 
 private:
    void addrdec_parseoption(const char *option);
-   void sweep_test() const; // sanity check to ensure no overlapping
+   void addrdec_compile(); 
+   void sweep_test() const; // sanity check to ensure no overlapping and that the compiled decoder matches the reference
+
+   // original (uncompiled) decoder, kept as the reference for sweep_test() 
+   void addrdec_tlx_reference(new_addr_type addr, addrdec_t *tlx) const; 
+   new_addr_type partition_address_reference( new_addr_type addr ) const;
 
    enum {
       CHIP  = 0,
@@ -95,6 +142,14 @@ private:
    unsigned int gap;
    int m_n_channel;
    int m_n_sub_partition_in_channel; 
+
+   // decoder state precomputed by addrdec_compile() 
+   addrdec_bitfield m_partition_field;       // ~(CHIP | sub partition id) bits
+   addrdec_bitfield m_sub_partition_field;   // ~(sub partition id) bits
+   unsigned m_bk_bits;                       // popcount of addrdec_mask[BK]
+   unsigned m_sub_partition_shift;           // log2(m_n_sub_partition_in_channel)
+   unsigned long long m_chip_div_magic;      // x / m_n_channel == (x * magic) >> shift for x < 2^31
+   unsigned m_chip_div_shift;
 };
 
 #endif
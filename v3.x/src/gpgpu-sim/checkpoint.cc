@@ -0,0 +1,263 @@
+// Kernel boundary checkpoints.
+//
+// After a timed kernel listed in -gpgpu_checkpoint_kernels finishes and the
+// GPU has drained, the functional state of the simulation is written to
+// <dir>/gpgpusim_ckpt_<uid>.bin: the global memory image, the device heap
+// pointer, the page placement and migration state (including the HBM
+// capacity used, the per-cacheline access counts of every memory partition
+// and the pages queued for migration), the migration pause/threshold and
+// page blocking state and the cumulative counters. Not saved: the contents
+// of the L1/L2 caches and DRAM row buffers, which the resumed run starts
+// cold, the C library rand() state, so rand() draws differ until the next
+// page placement or row hash reseeds it, and the per-unit statistics, which
+// restart from zero. Queues and MSHRs are empty at this point.
+//
+// With -gpgpu_restore_kernel N the host program is run again from the start.
+// Kernels launched before N are not timed: each one loads its own checkpoint
+// memory image if it has one and is otherwise run functionally, so host
+// readbacks see the same data. Kernel N is replaced by its checkpoint and
+// every later kernel is timed from the restored counters.
+
+#include "gpu-sim.h"
+#include "../cuda-sim/memory.h"
+#include "../cuda-sim/cuda-sim.h"
+#include "../stream_manager.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+static const char g_ckpt_magic[8] = {'G','P','G','P','U','C','K','P'};
+static const unsigned g_ckpt_version = 2;
+
+template<class T> static void ckpt_write( FILE *fp, const T &v )
+{
+    fwrite(&v,sizeof(T),1,fp);
+}
+
+template<class T> static void ckpt_write( FILE *fp, const std::vector<T> &v )
+{
+    unsigned long long n = v.size();
+    ckpt_write(fp,n);
+    for( unsigned long long i=0; i < n; i++ ) 
+        ckpt_write(fp,v[i]);
+}
+
+template<class T> static void ckpt_write( FILE *fp, const std::list<T> &l )
+{
+    unsigned long long n = l.size();
+    ckpt_write(fp,n);
+    for( typename std::list<T>::const_iterator i=l.begin(); i != l.end(); ++i ) 
+        ckpt_write(fp,*i);
+}
+
+template<class K, class V> static void ckpt_write( FILE *fp, const std::map<K,V> &m )
+{
+    unsigned long long n = m.size();
+    ckpt_write(fp,n);
+    for( typename std::map<K,V>::const_iterator i=m.begin(); i != m.end(); ++i ) {
+        ckpt_write(fp,i->first);
+        ckpt_write(fp,i->second);
+    }
+}
+
+static void ckpt_truncated()
+{
+    printf("GPGPU-Sim uArch: ERROR ** truncated checkpoint\n");
+    abort();
+}
+
+template<class T> static void ckpt_read( FILE *fp, T &v )
+{
+    if( fread(&v,sizeof(T),1,fp) != 1 )
+        ckpt_truncated();
+}
+
+template<class T> static void ckpt_read( FILE *fp, std::vector<T> &v )
+{
+    unsigned long long n;
+    ckpt_read(fp,n);
+    v.resize(n);
+    for( unsigned long long i=0; i < n; i++ ) 
+        ckpt_read(fp,v[i]);
+}
+
+template<class T> static void ckpt_read( FILE *fp, std::list<T> &l )
+{
+    unsigned long long n;
+    ckpt_read(fp,n);
+    l.clear();
+    for( unsigned long long i=0; i < n; i++ ) {
+        l.push_back(T());
+        ckpt_read(fp,l.back());
+    }
+}
+
+template<class K, class V> static void ckpt_read( FILE *fp, std::map<K,V> &m )
+{
+    unsigned long long n;
+    ckpt_read(fp,n);
+    m.clear();
+    for( unsigned long long i=0; i < n; i++ ) {
+        K key;
+        ckpt_read(fp,key);
+        ckpt_read(fp,m[key]);
+    }
+}
+
+std::string gpgpu_sim::checkpoint_file( unsigned kernel_uid ) const
+{
+    char buf[1024];
+    snprintf(buf,sizeof(buf),"%s/gpgpusim_ckpt_%u.bin", m_config.checkpoint_dir(), kernel_uid);
+    return std::string(buf);
+}
+
+void gpgpu_sim::save_checkpoint()
+{
+    unsigned uid = m_last_finished_kernel;
+    if( !uid || !m_config.checkpoint_kernel(uid) || restoring(uid) )
+        return;
+    assert( !active() );
+
+    // written under a temporary name so an interrupted save never leaves a
+    // checkpoint that looks complete
+    std::string fname = checkpoint_file(uid);
+    std::string tmpname = fname + ".tmp";
+    FILE *fp = fopen(tmpname.c_str(),"wb");
+    if( !fp ) {
+        printf("GPGPU-Sim uArch: ERROR ** could not create checkpoint \"%s\"\n", tmpname.c_str());
+        abort();
+    }
+    fwrite(g_ckpt_magic,sizeof(g_ckpt_magic),1,fp);
+    ckpt_write(fp,g_ckpt_version);
+    ckpt_write(fp,uid);
+    ckpt_write(fp,m_dev_malloc);
+
+    // memory first: kernels before the restore point only need this part
+    m_global_mem->save_image(fp);
+
+    ckpt_write(fp,gpu_tot_sim_cycle);
+    ckpt_write(fp,gpu_tot_sim_insn);
+    ckpt_write(fp,gpu_tot_issued_cta);
+    ckpt_write(fp,epoch_number);
+    ckpt_write(fp,m_map);
+    ckpt_write(fp,m_map_online);
+    ckpt_write(fp,migrationQueue);
+    ckpt_write(fp,migrationFinished);
+    ckpt_write(fp,migrationWaitCycle);
+    ckpt_write(fp,reCheckForMigration);
+    ckpt_write(fp,accessDistribution);
+    ckpt_write(fp,mallocAccesses);
+    ckpt_write(fp,num_lines_hbm);
+    ckpt_write(fp,globalPageCount);
+    ckpt_write(fp,migrationThreshold);
+    ckpt_write(fp,last_updated_at);
+    ckpt_write(fp,pageBlockingStall);
+    ckpt_write(fp,pauseMigration);
+    ckpt_write(fp,readyForNextMigration);
+    ckpt_write(fp,sendForMigrationPid);
+    ckpt_write(fp,m_memory_config->m_n_mem);
+    for( unsigned i=0; i < m_memory_config->m_n_mem; i++ ) {
+        ckpt_write(fp,m_memory_partition_unit[i]->num_access_per_cacheline);
+        ckpt_write(fp,m_memory_partition_unit[i]->threshold_cycle);
+    }
+
+    bool failed = ferror(fp);
+    failed |= (fclose(fp) != 0);
+    if( failed || rename(tmpname.c_str(),fname.c_str()) ) {
+        printf("GPGPU-Sim uArch: ERROR ** could not write checkpoint \"%s\"\n", fname.c_str());
+        abort();
+    }
+    printf("GPGPU-Sim uArch: checkpoint of kernel %u written to \"%s\" (tot_sim_cycle = %llu)\n",
+           uid, fname.c_str(), gpu_tot_sim_cycle);
+    fflush(stdout);
+}
+
+bool gpgpu_sim::restoring( unsigned kernel_uid ) const
+{
+    return kernel_uid <= m_config.restore_kernel();
+}
+
+bool gpgpu_sim::load_checkpoint( unsigned kernel_uid, bool full )
+{
+    std::string fname = checkpoint_file(kernel_uid);
+    FILE *fp = fopen(fname.c_str(),"rb");
+    if( !fp )
+        return false;
+
+    char magic[sizeof(g_ckpt_magic)];
+    unsigned version, uid;
+    unsigned long long dev_malloc;
+    ckpt_read(fp,magic);
+    ckpt_read(fp,version);
+    ckpt_read(fp,uid);
+    if( memcmp(magic,g_ckpt_magic,sizeof(magic)) || version != g_ckpt_version || uid != kernel_uid ) {
+        printf("GPGPU-Sim uArch: ERROR ** \"%s\" is not a checkpoint of kernel %u\n", fname.c_str(), kernel_uid);
+        abort();
+    }
+    ckpt_read(fp,dev_malloc);
+    if( dev_malloc != m_dev_malloc )
+        printf("GPGPU-Sim uArch: WARNING ** device heap differs from checkpoint of kernel %u (0x%llx vs 0x%llx)\n",
+               kernel_uid, m_dev_malloc, dev_malloc);
+    m_dev_malloc = dev_malloc;
+    m_global_mem->load_image(fp);
+
+    if( full ) {
+        ckpt_read(fp,gpu_tot_sim_cycle);
+        ckpt_read(fp,gpu_tot_sim_insn);
+        ckpt_read(fp,gpu_tot_issued_cta);
+        ckpt_read(fp,epoch_number);
+        ckpt_read(fp,m_map);
+        ckpt_read(fp,m_map_online);
+        ckpt_read(fp,migrationQueue);
+        ckpt_read(fp,migrationFinished);
+        ckpt_read(fp,migrationWaitCycle);
+        ckpt_read(fp,reCheckForMigration);
+        ckpt_read(fp,accessDistribution);
+        ckpt_read(fp,mallocAccesses);
+        ckpt_read(fp,num_lines_hbm);
+        ckpt_read(fp,globalPageCount);
+        ckpt_read(fp,migrationThreshold);
+        ckpt_read(fp,last_updated_at);
+        ckpt_read(fp,pageBlockingStall);
+        ckpt_read(fp,pauseMigration);
+        ckpt_read(fp,readyForNextMigration);
+        ckpt_read(fp,sendForMigrationPid);
+        unsigned n_mem;
+        ckpt_read(fp,n_mem);
+        if( n_mem != m_memory_config->m_n_mem ) {
+            printf("GPGPU-Sim uArch: ERROR ** checkpoint of kernel %u has %u memory partitions, this configuration %u\n",
+                   kernel_uid, n_mem, m_memory_config->m_n_mem);
+            abort();
+        }
+        for( unsigned i=0; i < n_mem; i++ ) {
+            ckpt_read(fp,m_memory_partition_unit[i]->num_access_per_cacheline);
+            ckpt_read(fp,m_memory_partition_unit[i]->threshold_cycle);
+        }
+    }
+    fclose(fp);
+    printf("GPGPU-Sim uArch: %s of kernel %u restored from \"%s\"\n",
+           full ? "checkpoint" : "memory image", kernel_uid, fname.c_str());
+    fflush(stdout);
+    return true;
+}
+
+void gpgpu_sim::restore_kernel( kernel_info_t &kernel )
+{
+    unsigned uid = kernel.get_uid();
+    bool full = (uid == m_config.restore_kernel());
+    if( !load_checkpoint(uid,full) ) {
+        if( full ) {
+            printf("GPGPU-Sim uArch: ERROR ** no checkpoint \"%s\" to restore\n", checkpoint_file(uid).c_str());
+            abort();
+        }
+        gpgpu_cuda_ptx_sim_main_func(kernel); // registers the kernel as finished
+        return;
+    }
+    extern stream_manager *g_stream_manager;
+    g_stream_manager->register_finished_kernel(uid);
+}
@@ -28,11 +28,31 @@
 #include "gpu-cache.h"
 #include "stat-tool.h"
 #include <assert.h>
+#include <math.h>
 #include "gpu-sim.h"
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #define MAX_DEFAULT_CACHE_SIZE_MULTIBLIER 4
 // used to allocate memory that is large enough to adapt the changes in cache size across kernels
 
+// number of accesses to the detailed sets of an L2 bank before its miss-rate
+// model is trusted; until then every access is simulated in detail
+#define L2_SET_SAMPLING_CALIBRATION 256
+
+// L2 banks of different sub partitions evict concurrently under
+// -gpgpu_sim_threads; their writebacks have no uid until the step is
+// committed, which records them then (memory_sub_partition::cache_commit)
+static void record_l2_writeback( const mem_fetch *wb )
+{
+    if (wb->setup_pending())
+        return;
+    l2_wb_map[wb->get_request_uid()] = wb->get_addr();
+}
+
 const char * cache_request_status_str(enum cache_request_status status) 
 {
    static const char * static_cache_request_status_str[] = {
@@ -51,6 +71,14 @@ const char * cache_request_status_str(enum cache_request_status status)
 void l2_cache_config::init(linear_to_raw_address_translation *address_mapping){
 	cache_config::init(m_config_string,FuncCachePreferNone);
 	m_address_mapping = address_mapping;
+	if (m_set_sampling > 1) {
+		if (m_set_sampling > m_nset) {
+			printf("GPGPU-Sim uArch: ERROR ** L2 set sampling ratio %u exceeds the number of L2 sets %u\n", m_set_sampling, m_nset);
+			exit(EXIT_FAILURE);
+		}
+		printf("GPGPU-Sim uArch: WARNING ** L2 set sampling enabled: 1 in %u L2 sets simulated in detail, "
+		       "L2 hit/miss statistics are ESTIMATES\n", m_set_sampling);
+	}
 }
 
 unsigned l2_cache_config::set_index(new_addr_type addr) const{
@@ -66,6 +94,9 @@ unsigned l2_cache_config::set_index(new_addr_type addr) const{
 tag_array::~tag_array() 
 {
     delete[] m_lines;
+    delete[] m_way_tags;
+    delete[] m_line_state;
+    delete m_replacement;
 }
 
 tag_array::tag_array( cache_config &config,
@@ -81,6 +112,11 @@ tag_array::tag_array( cache_config &config,
 void tag_array::update_cache_parameters(cache_config &config)
 {
 	m_config=config;
+	// the set geometry may have changed: rebuild the tag lookup arrays
+	delete[] m_way_tags;
+	delete[] m_line_state;
+	delete m_replacement;
+	init_way_tags();
 }
 
 tag_array::tag_array( cache_config &config,
@@ -105,65 +141,135 @@ void tag_array::init( int core_id, int type_id )
     m_prev_snapshot_pending_hit = 0;
     m_core_id = core_id; 
     m_type_id = type_id;
+    init_way_tags();
+}
+
+void tag_array::init_way_tags()
+{
+    // match_ways() returns one bit per way
+    assert( m_config.m_assoc <= 64 );
+    // pad each set to a whole number of 256-bit vectors
+    m_way_stride = (m_config.m_assoc + 3) & ~3U;
+    m_way_tags = new new_addr_type[m_config.m_nset*m_way_stride];
+    m_line_state = new unsigned char[m_config.get_num_lines()];
+    for (unsigned i=0; i < m_config.m_nset*m_way_stride; i++)
+        m_way_tags[i] = 0;
+    for (unsigned i=0; i < m_config.get_num_lines(); i++)
+        sync_way_tag(i);
+    m_replacement = replacement_policy::create( m_config.m_replacement_policy,
+                                                m_config.m_nset, m_config.m_assoc,
+                                                m_lines, m_line_state );
+}
+
+void tag_array::sync_way_tag( unsigned idx )
+{
+    unsigned set_index = idx / m_config.m_assoc;
+    unsigned way = idx - set_index*m_config.m_assoc;
+    m_way_tags[set_index*m_way_stride+way] = m_lines[idx].m_tag;
+    m_line_state[idx] = m_lines[idx].m_status;
+}
+
+void tag_array::allocate_line( unsigned idx, new_addr_type addr, unsigned time )
+{
+    // probe() only returns unreserved lines: anything not invalid is a victim
+    bool replaced = m_line_state[idx] != INVALID;
+    if ( replaced )
+        m_replacement->on_evict(idx);
+    m_lines[idx].allocate( m_config.tag(addr), m_config.block_addr(addr), time );
+    sync_way_tag(idx);
+    m_replacement->on_insert(idx, m_config.block_addr(addr), replaced);
+}
+
+void tag_array::set_block_status( unsigned idx, enum cache_block_state status )
+{
+    // invalidations (flushes, migration) end a line's lifetime like a replacement
+    if ( status == INVALID && (m_line_state[idx] == VALID || m_line_state[idx] == MODIFIED) )
+        m_replacement->on_evict(idx);
+    m_lines[idx].m_status = status;
+    m_line_state[idx] = status;
+}
+
+// Returns a bitmask of the ways in the set whose tag equals 'tag' (regardless
+// of the line state). Compares 4 ways per step with AVX2 and 2 with SSE2.
+unsigned long long tag_array::match_ways( unsigned set_index, new_addr_type tag ) const
+{
+    const unsigned assoc = m_config.m_assoc;
+    const new_addr_type *tags = &m_way_tags[set_index*m_way_stride];
+    unsigned long long match = 0;
+#if defined(__AVX2__)
+    const __m256i key = _mm256_set1_epi64x((long long)tag);
+    for (unsigned way=0; way<assoc; way+=4) {
+        __m256i eq = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i*)(tags+way)), key);
+        unsigned m = _mm256_movemask_pd(_mm256_castsi256_pd(eq));
+        match |= (unsigned long long)m << way;
+    }
+#elif defined(__SSE2__)
+    const __m128i key = _mm_set1_epi64x((long long)tag);
+    for (unsigned way=0; way<assoc; way+=2) {
+        // SSE2 has no 64-bit compare: both 32-bit halves must match
+        __m128i eq = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(tags+way)), key);
+        eq = _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2,3,0,1)));
+        unsigned m = _mm_movemask_pd(_mm_castsi128_pd(eq));
+        match |= (unsigned long long)m << way;
+    }
+#else
+    for (unsigned way=0; way<assoc; way++) {
+        if (tags[way] == tag)
+            match |= 1ULL << way;
+    }
+#endif
+    if (assoc < 64)
+        match &= (1ULL << assoc) - 1; // drop the padding ways
+    return match;
 }
 
 enum cache_request_status tag_array::probe( new_addr_type addr, unsigned &idx ) const {
     //assert( m_config.m_write_policy == READ_ONLY );
     unsigned set_index = m_config.set_index(addr);
     new_addr_type tag = m_config.tag(addr);
+    unsigned base = set_index*m_config.m_assoc;
+
+    // check for hit or pending hit (lowest matching way first)
+    unsigned long long match = match_ways(set_index,tag);
+    while (match) {
+        unsigned index = base + __builtin_ctzll(match);
+        match &= match - 1;
+        if ( m_line_state[index] == RESERVED ) {
+            idx = index;
+            return HIT_RESERVED;
+        } else if ( m_line_state[index] == VALID ) {
+            idx = index;
+            return HIT;
+        } else if ( m_line_state[index] == MODIFIED ) {
+            idx = index;
+            return HIT;
+        } else {
+            assert( m_line_state[index] == INVALID );
+        }
+    }
 
     unsigned invalid_line = (unsigned)-1;
-    unsigned valid_line = (unsigned)-1;
-    unsigned valid_timestamp = (unsigned)-1;
-
     bool all_reserved = true;
-
-    // check for hit or pending hit
     for (unsigned way=0; way<m_config.m_assoc; way++) {
-        unsigned index = set_index*m_config.m_assoc+way;
-        cache_block_t *line = &m_lines[index];
-        if (line->m_tag == tag) {
-            if ( line->m_status == RESERVED ) {
-                idx = index;
-                return HIT_RESERVED;
-            } else if ( line->m_status == VALID ) {
-                idx = index;
-                return HIT;
-            } else if ( line->m_status == MODIFIED ) {
-                idx = index;
-                return HIT;
-            } else {
-                assert( line->m_status == INVALID );
-            }
-        }
-        if (line->m_status != RESERVED) {
+        unsigned index = base+way;
+        if (m_line_state[index] != RESERVED) {
             all_reserved = false;
-            if (line->m_status == INVALID) {
+            if (m_line_state[index] == INVALID)
                 invalid_line = index;
-            } else {
-                // valid line : keep track of most appropriate replacement candidate
-                if ( m_config.m_replacement_policy == LRU ) {
-                    if ( line->m_last_access_time < valid_timestamp ) {
-                        valid_timestamp = line->m_last_access_time;
-                        valid_line = index;
-                    }
-                } else if ( m_config.m_replacement_policy == FIFO ) {
-                    if ( line->m_alloc_time < valid_timestamp ) {
-                        valid_timestamp = line->m_alloc_time;
-                        valid_line = index;
-                    }
-                }
-            }
         }
     }
     if ( all_reserved ) {
         assert( m_config.m_alloc_policy == ON_MISS ); 
         return RESERVATION_FAIL; // miss and not enough space in cache to allocate on miss
     }
-
     if ( invalid_line != (unsigned)-1 ) {
         idx = invalid_line;
-    } else if ( valid_line != (unsigned)-1) {
+        return MISS;
+    }
+
+    // no invalid line: let the replacement policy pick a valid line
+    unsigned valid_line = m_replacement->victim(set_index);
+    if ( valid_line != (unsigned)-1) {
         idx = valid_line;
     } else abort(); // if an unreserved block exists, it is either invalid or replaceable 
 
@@ -189,6 +295,7 @@ enum cache_request_status tag_array::access( new_addr_type addr, unsigned time,
         m_pending_hit++;
     case HIT: 
         m_lines[idx].m_last_access_time=time; 
+        m_replacement->on_hit(idx);
         break;
     case MISS:
         m_miss++;
@@ -198,7 +305,7 @@ enum cache_request_status tag_array::access( new_addr_type addr, unsigned time,
                 wb = true;
                 evicted = m_lines[idx];
             }
-            m_lines[idx].allocate( m_config.tag(addr), m_config.block_addr(addr), time );
+            allocate_line(idx, addr, time);
         }
         break;
     case RESERVATION_FAIL:
@@ -219,20 +326,41 @@ void tag_array::fill( new_addr_type addr, unsigned time )
     unsigned idx;
     enum cache_request_status status = probe(addr,idx);
     assert(status==MISS); // MSHR should have prevented redundant memory request
-    m_lines[idx].allocate( m_config.tag(addr), m_config.block_addr(addr), time );
+    allocate_line(idx, addr, time);
     m_lines[idx].fill(time);
+    m_line_state[idx] = VALID;
 }
 
 void tag_array::fill( unsigned index, unsigned time ) 
 {
     assert( m_config.m_alloc_policy == ON_MISS );
     m_lines[index].fill(time);
+    m_line_state[index] = VALID;
+}
+
+bool tag_array::warm( new_addr_type addr, unsigned time, bool write )
+{
+    unsigned idx;
+    enum cache_request_status status = probe(addr,idx);
+    if ( status == RESERVATION_FAIL ) 
+        return false;
+    if ( status == HIT || status == HIT_RESERVED ) {
+        m_lines[idx].m_last_access_time=time;
+        m_replacement->on_hit(idx);
+    } else {
+        allocate_line(idx, addr, time);
+        m_lines[idx].fill(time);
+        m_line_state[idx] = VALID;
+    }
+    if ( write ) 
+        set_block_status(idx, MODIFIED);
+    return status == HIT;
 }
 
 void tag_array::flush() 
 {
     for (unsigned i=0; i < m_config.get_num_lines(); i++)
-        m_lines[i].m_status = INVALID;
+        set_block_status(i, INVALID);
 }
 
 float tag_array::windowed_miss_rate( ) const
@@ -427,6 +555,12 @@ cache_stats::cache_stats(){
     m_cache_port_available_cycles = 0; 
     m_cache_data_port_busy_cycles = 0; 
     m_cache_fill_port_busy_cycles = 0; 
+    for(unsigned wr=0; wr<2; ++wr){
+        m_sampled_access[wr] = 0;
+        m_sampled_miss[wr] = 0;
+        m_estimated_access[wr] = 0;
+        m_estimated_miss[wr] = 0;
+    }
 }
 
 void cache_stats::clear(){
@@ -439,6 +573,12 @@ void cache_stats::clear(){
     m_cache_port_available_cycles = 0; 
     m_cache_data_port_busy_cycles = 0; 
     m_cache_fill_port_busy_cycles = 0; 
+    for(unsigned wr=0; wr<2; ++wr){
+        m_sampled_access[wr] = 0;
+        m_sampled_miss[wr] = 0;
+        m_estimated_access[wr] = 0;
+        m_estimated_miss[wr] = 0;
+    }
 }
 
 void cache_stats::inc_stats(int access_type, int access_outcome){
@@ -496,6 +636,12 @@ cache_stats cache_stats::operator+(const cache_stats &cs){
     ret.m_cache_port_available_cycles = m_cache_port_available_cycles + cs.m_cache_port_available_cycles; 
     ret.m_cache_data_port_busy_cycles = m_cache_data_port_busy_cycles + cs.m_cache_data_port_busy_cycles; 
     ret.m_cache_fill_port_busy_cycles = m_cache_fill_port_busy_cycles + cs.m_cache_fill_port_busy_cycles; 
+    for(unsigned wr=0; wr<2; ++wr){
+        ret.m_sampled_access[wr] = m_sampled_access[wr] + cs.m_sampled_access[wr];
+        ret.m_sampled_miss[wr] = m_sampled_miss[wr] + cs.m_sampled_miss[wr];
+        ret.m_estimated_access[wr] = m_estimated_access[wr] + cs.m_estimated_access[wr];
+        ret.m_estimated_miss[wr] = m_estimated_miss[wr] + cs.m_estimated_miss[wr];
+    }
     return ret;
 }
 
@@ -511,6 +657,12 @@ cache_stats &cache_stats::operator+=(const cache_stats &cs){
     m_cache_port_available_cycles += cs.m_cache_port_available_cycles; 
     m_cache_data_port_busy_cycles += cs.m_cache_data_port_busy_cycles; 
     m_cache_fill_port_busy_cycles += cs.m_cache_fill_port_busy_cycles; 
+    for(unsigned wr=0; wr<2; ++wr){
+        m_sampled_access[wr] += cs.m_sampled_access[wr];
+        m_sampled_miss[wr] += cs.m_sampled_miss[wr];
+        m_estimated_access[wr] += cs.m_estimated_access[wr];
+        m_estimated_miss[wr] += cs.m_estimated_miss[wr];
+    }
     return *this;
 }
 
@@ -535,6 +687,46 @@ void cache_stats::print_stats(FILE *fout, const char *cache_name) const{
     }
 }
 
+void cache_stats::inc_set_sampling_stats(bool estimated, bool wr, bool miss){
+    if(estimated){
+        m_estimated_access[wr]++;
+        if(miss) m_estimated_miss[wr]++;
+    }else{
+        m_sampled_access[wr]++;
+        if(miss) m_sampled_miss[wr]++;
+    }
+}
+
+double cache_stats::sampled_miss_rate(bool wr) const{
+    if(m_sampled_access[wr] == 0)
+        return 0.0;
+    return (double)m_sampled_miss[wr] / (double)m_sampled_access[wr];
+}
+
+void cache_stats::print_set_sampling_stats(FILE *fout, const char *cache_name) const{
+    ///
+    /// Reports how much of the cache was estimated rather than simulated.
+    /// The 95% bound only covers the binomial error of the sampled miss rate;
+    /// it assumes the sampled sets are representative of the others.
+    ///
+    if(m_estimated_access[0] + m_estimated_access[1] == 0 &&
+       m_sampled_access[0] + m_sampled_access[1] == 0)
+        return;
+    fprintf(fout, "%s_set_sampling = ENABLED (hit/miss counts above include estimated accesses)\n", cache_name);
+    for(unsigned wr=0; wr<2; ++wr){
+        const char *dir = wr? "WRITE" : "READ";
+        double p = sampled_miss_rate(wr);
+        double bound = 0.0;
+        if(m_sampled_access[wr] > 0)
+            bound = 1.96 * sqrt(p * (1.0 - p) / (double)m_sampled_access[wr]);
+        fprintf(fout, "%s_sampled_sets[%s]: Access = %llu, Miss = %llu, Miss_rate = %.4lf +/- %.4lf (95%%)\n",
+                cache_name, dir, m_sampled_access[wr], m_sampled_miss[wr], p, bound);
+        fprintf(fout, "%s_estimated_sets[%s]: Access = %llu, Miss = %llu (expected %.0lf +/- %.0lf)\n",
+                cache_name, dir, m_estimated_access[wr], m_estimated_miss[wr],
+                p * m_estimated_access[wr], bound * m_estimated_access[wr]);
+    }
+}
+
 void cache_sub_stats::print_port_stats(FILE *fout, const char *cache_name) const
 {
     float data_port_util = 0.0f; 
@@ -616,6 +808,11 @@ void cache_stats::sample_cache_port_utility(bool data_port_busy, bool fill_port_
     } 
 }
 
+void cache_stats::sample_idle_port_cycles(unsigned long long n)
+{
+    m_cache_port_available_cycles += n;
+}
+
 baseline_cache::bandwidth_management::bandwidth_management(cache_config &config) 
 : m_config(config)
 {
@@ -735,8 +932,7 @@ void baseline_cache::fill(mem_fetch *mf, unsigned time){
         else abort();
         if (has_atomic) {
             assert(m_config.m_alloc_policy == ON_MISS);
-            cache_block_t &block = m_tag_array->get_block(e->second.m_cache_index);
-            block.m_status = MODIFIED; // mark line as dirty for atomic operation
+            m_tag_array->set_block_status(e->second.m_cache_index, MODIFIED); // mark line as dirty for atomic operation
         }
         m_bandwidth_management.use_fill_port(mf); 
     m_extra_mf_fields.erase(mf);
@@ -794,12 +990,14 @@ void baseline_cache::send_read_request(new_addr_type addr, new_addr_type block_a
         m_miss_queue.push_back(mf);
 
         //TODO: for debugging: delete this
-        unsigned global_spid = mf->get_sub_partition_id(); 
-        const class memory_config* config = mf->get_mem_config();
-        if (config->type == 2 && (global_spid < config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition))
-            printf("global_spid: %d\n", global_spid);
-        if (config->type == 2) assert(global_spid >= config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition);
-        if (config->type == 1) assert(global_spid < config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition);
+        if (!mf->setup_pending()) { // decoded when the L2 step is committed
+            unsigned global_spid = mf->get_sub_partition_id(); 
+            const class memory_config* config = mf->get_mem_config();
+            if (config->type == 2 && (global_spid < config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition))
+                printf("global_spid: %d\n", global_spid);
+            if (config->type == 2) assert(global_spid >= config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition);
+            if (config->type == 1) assert(global_spid < config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition);
+        }
 
         mf->set_status(m_miss_queue_status,time);
         if(!wa)
@@ -826,12 +1024,14 @@ void baseline_cache::send_read_request(new_addr_type addr, new_addr_type block_a
         m_miss_queue.push_back(mf);
 
         //TODO: for debugging: delete this
-        unsigned global_spid = mf->get_sub_partition_id(); 
-        const class memory_config* config = mf->get_mem_config();
-        if (config->type == 2 && (global_spid < config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition))
-            printf("global_spid: %d\n", global_spid);
-        if (config->type == 2) assert(global_spid >= config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition);
-        if (config->type == 1) assert(global_spid < config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition);
+        if (!mf->setup_pending()) { // decoded when the L2 step is committed
+            unsigned global_spid = mf->get_sub_partition_id(); 
+            const class memory_config* config = mf->get_mem_config();
+            if (config->type == 2 && (global_spid < config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition))
+                printf("global_spid: %d\n", global_spid);
+            if (config->type == 2) assert(global_spid >= config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition);
+            if (config->type == 1) assert(global_spid < config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition);
+        }
 
         mf->set_status(m_miss_queue_status,time);
         if(!wa)
@@ -847,12 +1047,14 @@ void data_cache::send_write_request(mem_fetch *mf, cache_event request, unsigned
     m_miss_queue.push_back(mf);
 
         //TODO: for debugging: delete this
-        unsigned global_spid = mf->get_sub_partition_id(); 
-        const class memory_config* config = mf->get_mem_config();
-        if (config->type == 2 && (global_spid < config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition))
-            printf("global_spid: %d\n", global_spid);
-        if (config->type == 2) assert(global_spid >= config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition);
-        if (config->type == 1) assert(global_spid < config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition);
+        if (!mf->setup_pending()) { // decoded when the L2 step is committed
+            unsigned global_spid = mf->get_sub_partition_id(); 
+            const class memory_config* config = mf->get_mem_config();
+            if (config->type == 2 && (global_spid < config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition))
+                printf("global_spid: %d\n", global_spid);
+            if (config->type == 2) assert(global_spid >= config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition);
+            if (config->type == 1) assert(global_spid < config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition);
+        }
 
     mf->set_status(m_miss_queue_status,time);
 }
@@ -864,8 +1066,7 @@ void data_cache::send_write_request(mem_fetch *mf, cache_event request, unsigned
 cache_request_status data_cache::wr_hit_wb(new_addr_type addr, unsigned cache_index, mem_fetch *mf, unsigned time, std::list<cache_event> &events, enum cache_request_status status ){
 	new_addr_type block_addr = m_config.block_addr(addr);
 	m_tag_array->access(block_addr,time,cache_index); // update LRU state
-	cache_block_t &block = m_tag_array->get_block(cache_index);
-	block.m_status = MODIFIED;
+	m_tag_array->set_block_status(cache_index, MODIFIED);
 
 	return HIT;
 }
@@ -877,8 +1078,7 @@ cache_request_status data_cache::wr_hit_wt(new_addr_type addr, unsigned cache_in
 
 	new_addr_type block_addr = m_config.block_addr(addr);
 	m_tag_array->access(block_addr,time,cache_index); // update LRU state
-	cache_block_t &block = m_tag_array->get_block(cache_index);
-	block.m_status = MODIFIED;
+	m_tag_array->set_block_status(cache_index, MODIFIED);
 
 	// generate a write-through
 	send_write_request(mf, WRITE_REQUEST_SENT, time, events);
@@ -900,7 +1100,6 @@ cache_request_status data_cache::wr_hit_we(new_addr_type addr, unsigned cache_in
 		return RESERVATION_FAIL; // cannot handle request this cycle
 
 	// generate a write-through/evict
-	cache_block_t &block = m_tag_array->get_block(cache_index);
 	send_write_request(mf, WRITE_REQUEST_SENT, time, events);
 
     // add this write request to the map 
@@ -913,7 +1112,7 @@ cache_request_status data_cache::wr_hit_we(new_addr_type addr, unsigned cache_in
 
 
 	// Invalidate block
-	block.m_status = INVALID;
+	m_tag_array->set_block_status(cache_index, INVALID);
 
 	return HIT;
 }
@@ -971,12 +1170,14 @@ data_cache::wr_miss_wa( new_addr_type addr,
 //    mem_fetch *n_mf = new mem_fetch( mf, *ma);
 
         //TODO: for debugging: delete this
-        unsigned global_spid = n_mf->get_sub_partition_id(); 
-        const class memory_config* config = n_mf->get_mem_config();
-        if (config->type == 2 && (global_spid < config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition))
-            printf("global_spid: %d\n", global_spid);
-        if (config->type == 2) assert(global_spid >= config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition);
-        if (config->type == 1) assert(global_spid < config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition);
+        if (!n_mf->setup_pending()) { // decoded when the L2 step is committed
+            unsigned global_spid = n_mf->get_sub_partition_id(); 
+            const class memory_config* config = n_mf->get_mem_config();
+            if (config->type == 2 && (global_spid < config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition))
+                printf("global_spid: %d\n", global_spid);
+            if (config->type == 2) assert(global_spid >= config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition);
+            if (config->type == 1) assert(global_spid < config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition);
+        }
 
 
     bool do_miss = false;
@@ -999,7 +1200,7 @@ data_cache::wr_miss_wa( new_addr_type addr,
             if (m_wrbk_type == L1_WRBK_ACC) {
                 l1_wb_map[wb->get_request_uid()] =  wb->get_addr();
             } else if (m_wrbk_type == L2_WRBK_ACC) {
-                l2_wb_map[wb->get_request_uid()] =  wb->get_addr();
+                record_l2_writeback(wb);
             } else {
                 printf("unknown writeback request generated\n");
                 exit(EXIT_FAILURE);
@@ -1007,12 +1208,14 @@ data_cache::wr_miss_wa( new_addr_type addr,
 
 
             //TODO: for debugging: delete this
-            unsigned global_spid = wb->get_sub_partition_id(); 
-            const class memory_config* config = wb->get_mem_config();
-            if (config->type == 2 && (global_spid < config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition))
-                printf("global_spid: %d\n", global_spid);
-            if (config->type == 2) assert(global_spid >= config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition);
-            if (config->type == 1) assert(global_spid < config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition);
+            if (!wb->setup_pending()) { // decoded when the L2 step is committed
+                unsigned global_spid = wb->get_sub_partition_id(); 
+                const class memory_config* config = wb->get_mem_config();
+                if (config->type == 2 && (global_spid < config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition))
+                    printf("global_spid: %d\n", global_spid);
+                if (config->type == 2) assert(global_spid >= config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition);
+                if (config->type == 1) assert(global_spid < config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition);
+            }
 
             wb->set_status(m_miss_queue_status,time);
         }
@@ -1091,12 +1294,14 @@ data_cache::wr_miss_wa_no_insert( new_addr_type addr,
                     mf->get_mem_config());
 
         //TODO: for debugging: delete this
-        unsigned global_spid = n_mf->get_sub_partition_id(); 
-        const class memory_config* config = n_mf->get_mem_config();
-        if (config->type == 2 && (global_spid < config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition))
-            printf("global_spid: %d\n", global_spid);
-        if (config->type == 2) assert(global_spid >= config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition);
-        if (config->type == 1) assert(global_spid < config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition);
+        if (!n_mf->setup_pending()) { // decoded when the L2 step is committed
+            unsigned global_spid = n_mf->get_sub_partition_id(); 
+            const class memory_config* config = n_mf->get_mem_config();
+            if (config->type == 2 && (global_spid < config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition))
+                printf("global_spid: %d\n", global_spid);
+            if (config->type == 2) assert(global_spid >= config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition);
+            if (config->type == 1) assert(global_spid < config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition);
+        }
 
 
     bool do_miss = false;
@@ -1129,8 +1334,7 @@ data_cache::rd_hit_base( new_addr_type addr,
     // MODIFIED
     if(mf->isatomic()){ 
         assert(mf->get_access_type() == GLOBAL_ACC_R);
-        cache_block_t &block = m_tag_array->get_block(cache_index);
-        block.m_status = MODIFIED;  // mark line as dirty
+        m_tag_array->set_block_status(cache_index, MODIFIED);  // mark line as dirty
     }
     return HIT;
 }
@@ -1171,19 +1375,21 @@ data_cache::rd_miss_base( new_addr_type addr,
             if (m_wrbk_type == L1_WRBK_ACC) {
                 l1_wb_map[wb->get_request_uid()] =  wb->get_addr();
             } else if (m_wrbk_type == L2_WRBK_ACC) {
-                l2_wb_map[wb->get_request_uid()] =  wb->get_addr();
+                record_l2_writeback(wb);
             } else {
                 printf("unknown writeback request generated\n");
                 exit(EXIT_FAILURE);
             }
 
             //TODO: for debugging: delete this
-            unsigned global_spid = wb->get_sub_partition_id(); 
-            const class memory_config* config = wb->get_mem_config();
-            if (config->type == 2 && (global_spid < config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition))
-                printf("global_spid: %d\n", global_spid);
-            if (config->type == 2) assert(global_spid >= config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition);
-            if (config->type == 1) assert(global_spid < config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition);
+            if (!wb->setup_pending()) { // decoded when the L2 step is committed
+                unsigned global_spid = wb->get_sub_partition_id(); 
+                const class memory_config* config = wb->get_mem_config();
+                if (config->type == 2 && (global_spid < config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition))
+                    printf("global_spid: %d\n", global_spid);
+                if (config->type == 2) assert(global_spid >= config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition);
+                if (config->type == 1) assert(global_spid < config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition);
+            }
 
             send_write_request(wb, WRITE_BACK_REQUEST_SENT, time, events);
     }
@@ -1281,16 +1487,8 @@ data_cache::access( new_addr_type addr,
                     unsigned time,
                     std::list<cache_event> &events )
 {
-    new_addr_type page_addr = mf->get_addr() & ~(4095ULL);
-    for (auto &it_pid : sendForMigrationPid) {
-        if (enableMigration 
-                && !pauseMigration
-                && !(it_pid.second).empty() 
-                && (page_addr == it_pid.second.front())
-                && !block_on_migration) {
-            return HIT;
-        }
-    }
+    if (migration_bypass(mf))
+        return HIT;
     assert( mf->get_data_size() <= m_config.get_line_sz());
     bool wr = mf->get_is_write();
     new_addr_type block_addr = m_config.block_addr(addr);
@@ -1304,6 +1502,22 @@ data_cache::access( new_addr_type addr,
     return access_status;
 }
 
+bool
+baseline_cache::migration_bypass(mem_fetch *mf) const
+{
+    new_addr_type page_addr = mf->get_addr() & ~(4095ULL);
+    for (auto &it_pid : sendForMigrationPid) {
+        if (enableMigration 
+                && !pauseMigration
+                && !(it_pid.second).empty() 
+                && (page_addr == it_pid.second.front())
+                && !block_on_migration) {
+            return true;
+        }
+    }
+    return false;
+}
+
 /* Returns true if this data cache is flushed and corresponding page address is
  * ready to migrate
  */
@@ -1389,11 +1603,11 @@ data_cache::flushOnMigrate(new_addr_type page_addr)
                             exit(EXIT_FAILURE);
                         }
                         wb->set_status(m_miss_queue_status,gpu_sim_cycle+gpu_tot_sim_cycle);
-                        m_tag_array->get_block(i).m_status = INVALID; 
+                        m_tag_array->set_block_status(i, INVALID); 
                         flag &= false;
                     }
                     else
-                        m_tag_array->get_block(i).m_status = INVALID; 
+                        m_tag_array->set_block_status(i, INVALID); 
                 } else {
                     printf("no new MSHR hits should be there for this page, as we have already cleared it\n");
                     exit(EXIT_FAILURE);
@@ -1483,7 +1697,104 @@ l2_cache::access( new_addr_type addr,
                   unsigned time,
                   std::list<cache_event> &events )
 {
-    return data_cache::access( addr, mf, time, events );
+    if (m_set_sampling <= 1)
+        return data_cache::access( addr, mf, time, events );
+
+    bool wr = mf->get_is_write();
+    unsigned set_index = m_config.set_index(m_config.block_addr(addr));
+    if (set_index % m_set_sampling != 0) {
+        // the estimated path never writes through, so only write-back L2s
+        // may resolve writes from the model
+        bool can_estimate = !wr || m_config.m_write_policy == WRITE_BACK;
+        if (can_estimate && m_stats.sampled_accesses(wr) >= L2_SET_SAMPLING_CALIBRATION
+            && !migration_bypass(mf)) {
+            // lines left in these sets by the calibration phase would never be
+            // evicted, and dirty ones never written back
+            if (!m_sampling_started[wr]) {
+                m_sampling_started[wr] = true;
+                m_flushing = true;
+                m_flush_line = 0;
+                flush_unsampled_sets(time);
+            }
+            return access_estimated( mf, time, events );
+        }
+        return data_cache::access( addr, mf, time, events );
+    }
+
+    enum cache_request_status status = data_cache::access( addr, mf, time, events );
+    if (status != RESERVATION_FAIL)
+        m_stats.inc_set_sampling_stats(false, wr, status == MISS); // HIT_RESERVED sends no request
+    return status;
+}
+
+enum cache_request_status
+l2_cache::access_estimated( mem_fetch *mf,
+                            unsigned time,
+                            std::list<cache_event> &events )
+{
+    bool wr = mf->get_is_write();
+
+    // draw the outcome from the miss rate of the detailed sets
+    m_sampling_rng ^= m_sampling_rng << 13;
+    m_sampling_rng ^= m_sampling_rng >> 7;
+    m_sampling_rng ^= m_sampling_rng << 17;
+    double u = (double)(m_sampling_rng >> 11) * (1.0 / 9007199254740992.0);
+    bool miss = u < m_stats.sampled_miss_rate(wr);
+
+    enum cache_request_status status = HIT;
+    if (miss) {
+        // forward the request to DRAM without allocating a line; the response
+        // bypasses the cache since it is not waiting_for_fill()
+        if (miss_queue_full(0)) {
+            m_stats.inc_stats(mf->get_access_type(), RESERVATION_FAIL);
+            return RESERVATION_FAIL;
+        }
+        if (wr) {
+            send_write_request(mf, WRITE_REQUEST_SENT, time, events);
+        } else {
+            m_miss_queue.push_back(mf);
+            mf->set_status(m_miss_queue_status,time);
+            events.push_back(READ_REQUEST_SENT);
+        }
+        status = MISS;
+    }
+    m_bandwidth_management.use_data_port(mf, status, events);
+    m_stats.inc_stats(mf->get_access_type(), status);
+    m_stats.inc_set_sampling_stats(true, wr, miss);
+    return status;
+}
+
+void
+l2_cache::flush_unsampled_sets( unsigned time )
+{
+    unsigned num_line = m_config.get_num_lines();
+    for (; m_flush_line < num_line; m_flush_line++) {
+        const cache_block_t &line = m_tag_array->get_block(m_flush_line);
+        // reserved lines are still waiting for their fill
+        if (line.m_status != VALID && line.m_status != MODIFIED)
+            continue;
+        if (m_config.set_index(line.m_block_addr) % m_set_sampling == 0)
+            continue;
+        if (line.m_status == MODIFIED && m_config.m_write_policy != WRITE_THROUGH) {
+            if (miss_queue_full(0))
+                return;
+            mem_fetch *wb = m_memfetch_creator->alloc(line.m_block_addr,
+                m_wrbk_type,m_config.get_line_sz(),true);
+            m_miss_queue.push_back(wb);
+            record_l2_writeback(wb);
+            wb->set_status(m_miss_queue_status,time);
+        }
+        m_tag_array->set_block_status(m_flush_line, INVALID);
+    }
+    m_flushing = false;
+}
+
+void
+l2_cache::cycle(bool level2)
+{
+    data_cache::cycle(level2);
+    if (m_flushing)
+        flush_unsampled_sets(gpu_sim_cycle+gpu_tot_sim_cycle);
 }
 
 /// Access function for tex_cache
@@ -36,6 +36,7 @@
 #include "../tr1_hash_map.h"
 
 #include "addrdec.h"
+#include "replacement_policy.h"
 
 enum cache_block_state {
     INVALID,
@@ -94,11 +95,6 @@ struct cache_block_t {
     cache_block_state    m_status;
 };
 
-enum replacement_policy_t {
-    LRU,
-    FIFO
-};
-
 enum write_policy_t {
     READ_ONLY,
     WRITE_BACK,
@@ -158,6 +154,10 @@ public:
         switch (rp) {
         case 'L': m_replacement_policy = LRU; break;
         case 'F': m_replacement_policy = FIFO; break;
+        case 'S': m_replacement_policy = SRRIP; break;
+        case 'B': m_replacement_policy = BRRIP; break;
+        case 'D': m_replacement_policy = DRRIP; break;
+        case 'H': m_replacement_policy = SHIP; break;
         default: exit_parse_error();
         }
         switch (wp) {
@@ -292,7 +292,7 @@ protected:
     unsigned m_nset_log2;
     unsigned m_assoc;
 
-    enum replacement_policy_t m_replacement_policy; // 'L' = LRU, 'F' = FIFO
+    enum replacement_policy_t m_replacement_policy; // 'L' = LRU, 'F' = FIFO, 'S' = SRRIP, 'B' = BRRIP, 'D' = DRRIP, 'H' = SHiP
     enum write_policy_t m_write_policy;             // 'T' = write through, 'B' = write back, 'R' = read only
     enum allocation_policy_t m_alloc_policy;        // 'm' = allocate on miss, 'f' = allocate on fill
     enum mshr_config_t m_mshr_type;
@@ -331,6 +331,11 @@ public:
 	void init(linear_to_raw_address_translation *address_mapping);
 	virtual unsigned set_index(new_addr_type addr) const;
 
+	// set sampling: only one of every m_set_sampling sets is simulated in
+	// detail, accesses to the other sets are resolved by a miss-rate model
+	// calibrated on the detailed sets (0 or 1 = off)
+	unsigned m_set_sampling;
+
 private:
 	linear_to_raw_address_translation *m_address_mapping;
 };
@@ -347,9 +352,13 @@ public:
 
     void fill( new_addr_type addr, unsigned time );
     void fill( unsigned idx, unsigned time );
+    // functional warm-up: installs the line as if by a completed access,
+    // without counting it; returns true if it was already present
+    bool warm( new_addr_type addr, unsigned time, bool write );
 
     unsigned size() const { return m_config.get_num_lines();}
-    cache_block_t &get_block(unsigned idx) { return m_lines[idx];}
+    const cache_block_t &get_block(unsigned idx) const { return m_lines[idx];}
+    void set_block_status( unsigned idx, enum cache_block_state status );
 
     void flush(); // flash invalidate all entries
     void new_window();
@@ -368,6 +377,10 @@ protected:
                int type_id,
                cache_block_t* new_lines );
     void init( int core_id, int type_id );
+    void init_way_tags();
+    void sync_way_tag( unsigned idx );
+    void allocate_line( unsigned idx, new_addr_type addr, unsigned time );
+    unsigned long long match_ways( unsigned set_index, new_addr_type tag ) const;
 
 protected:
 
@@ -375,6 +388,15 @@ protected:
 
     cache_block_t *m_lines; /* nbanks x nset x assoc lines in total */
 
+    // Tags and states of m_lines laid out per set so that probe() can compare
+    // all ways of a set with a few vector instructions; kept in sync with
+    // m_lines by every tag_array method that changes a line's tag or state.
+    new_addr_type *m_way_tags;   /* nset x m_way_stride (assoc padded to 4) */
+    unsigned char *m_line_state; /* cache_block_state of each line */
+    unsigned m_way_stride;
+
+    replacement_policy *m_replacement; // victim selection and its per-line metadata
+
     unsigned m_access;
     unsigned m_miss;
     unsigned m_pending_hit; // number of cache miss that hit a line that is allocated but not filled
@@ -537,11 +559,24 @@ public:
     void get_sub_stats(struct cache_sub_stats &css) const;
 
     void sample_cache_port_utility(bool data_port_busy, bool fill_port_busy); 
+    void sample_idle_port_cycles(unsigned long long n);
+
+    // L2 set sampling: outcomes of accesses to the detailed (sampled) sets and
+    // to the sets whose outcome was drawn from the sampled miss rate
+    void inc_set_sampling_stats(bool estimated, bool wr, bool miss);
+    unsigned long long sampled_accesses(bool wr) const { return m_sampled_access[wr]; }
+    double sampled_miss_rate(bool wr) const;
+    void print_set_sampling_stats(FILE *fout, const char *cache_name) const;
 private:
     bool check_valid(int type, int status) const;
 
     std::vector< std::vector<unsigned> > m_stats;
 
+    unsigned long long m_sampled_access[2]; // [is_write]
+    unsigned long long m_sampled_miss[2];
+    unsigned long long m_estimated_access[2];
+    unsigned long long m_estimated_miss[2];
+
     unsigned long long m_cache_port_available_cycles; 
     unsigned long long m_cache_data_port_busy_cycles; 
     unsigned long long m_cache_fill_port_busy_cycles; 
@@ -599,7 +634,11 @@ public:
 
     virtual enum cache_request_status access( new_addr_type addr, mem_fetch *mf, unsigned time, std::list<cache_event> &events ) =  0;
     /// Sends next request to lower level of memory
-    void cycle(bool level2);
+    virtual void cycle(bool level2);
+    /// True if cycle() would only sample two free ports (nothing to send)
+    virtual bool idle() const { return m_miss_queue.empty() && data_port_free() && fill_port_free(); }
+    /// Accounts for n calls to cycle() skipped while idle()
+    void skip_idle_cycles(unsigned long long n) { m_stats.sample_idle_port_cycles(n); }
     /// Interface for response from lower memory level (model bandwidth restictions in caller)
     void fill( mem_fetch *mf, unsigned time );
     /// Checks if mf is waiting to be filled by lower memory level
@@ -610,6 +649,8 @@ public:
     mem_fetch *next_access(){return m_mshrs.next_access();}
     // flash invalidate all entries in cache
     void flush(){m_tag_array->flush();}
+    /// Functional warm-up of the tags (no timing, no stats); true on a hit
+    bool warm( new_addr_type addr, unsigned time, bool write ) { return m_tag_array->warm(addr,time,write); }
     void print(FILE *fp, unsigned &accesses, unsigned &misses) const;
     void display_state( FILE *fp ) const;
 
@@ -683,6 +724,8 @@ protected:
     bool miss_queue_full(unsigned num_miss){
     	  return ( (m_miss_queue.size()+num_miss) >= m_config.m_miss_queue_size );
     }
+    /// True if the access targets a page that is being migrated and must not touch the cache
+    bool migration_bypass(mem_fetch *mf) const;
     /// Read miss handler without writeback
     void send_read_request(new_addr_type addr, new_addr_type block_addr, unsigned cache_index, mem_fetch *mf,
     		unsigned time, bool &do_miss, std::list<cache_event> &events, bool read_only, bool wa);
@@ -997,22 +1040,47 @@ protected:
 /// and write-allocate policies
 class l2_cache : public data_cache {
 public:
-    l2_cache(const char *name,  cache_config &config,
+    l2_cache(const char *name,  l2_cache_config &config,
             int core_id, int type_id, mem_fetch_interface *memport,
             mem_fetch_allocator *mfcreator, enum mem_fetch_status status )
             : data_cache(name,config,core_id,type_id,memport,mfcreator,status, L2_WR_ALLOC_R, L2_WRBK_ACC)
     {
         cache_id = core_id;
+        m_set_sampling = config.m_set_sampling;
+        m_sampling_rng = 0x9E3779B97F4A7C15ULL ^ (unsigned long long)(core_id + 1);
+        m_sampling_started[0] = m_sampling_started[1] = false;
+        m_flushing = false;
+        m_flush_line = 0;
     }
 
     virtual ~l2_cache() {}
 
+    virtual void cycle(bool level2);
+    virtual bool idle() const { return !m_flushing && data_cache::idle(); }
+
     virtual enum cache_request_status
         access( new_addr_type addr,
                 mem_fetch *mf,
                 unsigned time,
                 std::list<cache_event> &events );
     int cache_id;
+
+protected:
+    /// Resolves an access to a set that is not simulated in detail
+    enum cache_request_status
+        access_estimated( mem_fetch *mf,
+                          unsigned time,
+                          std::list<cache_event> &events );
+    /// Invalidates the lines of the sets that are no longer simulated in
+    /// detail, writing back the dirty ones; stops while the miss queue is
+    /// full and resumes from m_flush_line on a later cycle
+    void flush_unsampled_sets( unsigned time );
+
+    unsigned m_set_sampling;
+    bool m_sampling_started[2]; // [is_write]
+    bool m_flushing;            // flush_unsampled_sets() has lines left
+    unsigned m_flush_line;      // next line it looks at
+    unsigned long long m_sampling_rng; // xorshift state, seeded per bank for reproducibility
 };
 
 /*****************************************************************************/
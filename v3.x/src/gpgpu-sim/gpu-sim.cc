@@ -54,6 +54,7 @@
 #include "addrdec.h"
 #include "stat-tool.h"
 #include "l2cache.h"
+#include "thread_pool.h"
 
 #include "../cuda-sim/ptx-stats.h"
 #include "../statwrapper.h"
@@ -239,8 +240,13 @@ void memory_config::reg_options(class OptionParser * opp, unsigned num)
                            "0", num_str);
     option_parser_register_mem(opp, "-gpgpu_cache:dl2", OPT_CSTR, &m_L2_config.m_config_string, 
                    "unified banked L2 data cache config "
-                   " {<nsets>:<bsize>:<assoc>,<rep>:<wr>:<alloc>:<wr_alloc>,<mshr>:<N>:<merge>,<mq>}",
+                   " {<nsets>:<bsize>:<assoc>,<rep>:<wr>:<alloc>:<wr_alloc>,<mshr>:<N>:<merge>,<mq>}"
+                   " <rep> = L(RU), F(IFO), S(RRIP), B(RRIP), D(RRIP), H (SHiP)",
                    "64:128:8,L:B:m:N,A:16:4,4", num_str);
+    option_parser_register_mem(opp, "-gpgpu_l2_set_sampling", OPT_UINT32, &m_L2_config.m_set_sampling, 
+                   "simulate only 1 in N L2 sets in detail and estimate the rest from their miss rate "
+                   "(0 = off; statistics become estimates)",
+                   "0", num_str);
     option_parser_register_mem(opp, "-gpgpu_cache:dl2_texture_only", OPT_BOOL, &m_L2_texure_only, 
                            "L2 cache used for texture only",
                            "1", num_str);
@@ -491,6 +497,66 @@ void gpgpu_sim_config::reg_options(option_parser_t opp)
    option_parser_register(opp, "-gpgpu_deadlock_detect", OPT_BOOL, &gpu_deadlock_detect, 
                 "Stop the simulation at deadlock (1=on (default), 0=off)", 
                 "1");
+   option_parser_register(opp, "-gpgpu_sim_threads", OPT_UINT32, &gpgpu_sim_threads, 
+                "Number of threads stepping the L2 sub partitions of a cycle in parallel (1 = serial)", 
+                "1");
+   option_parser_register(opp, "-gpgpu_checkpoint_dir", OPT_CSTR, &gpgpu_checkpoint_dir, 
+                "Directory holding kernel boundary checkpoints", 
+                ".");
+   option_parser_register(opp, "-gpgpu_checkpoint_kernels", OPT_CSTR, &gpgpu_checkpoint_kernels, 
+                "Checkpoint the simulator after these kernels finish {all | <uid>,<uid>,...}", 
+                "");
+   option_parser_register(opp, "-gpgpu_restore_kernel", OPT_UINT32, &gpgpu_restore_kernel, 
+                "Resume from the checkpoint of this kernel uid; earlier kernels run functionally (0 = off)", 
+                "0");
+   option_parser_register(opp, "-gpgpu_fast_forward_kernels", OPT_UINT32, &gpgpu_fast_forward_kernels, 
+                "Run this many kernels functionally before switching to detailed simulation (0 = off)", 
+                "0");
+   option_parser_register(opp, "-gpgpu_fast_forward_insn", OPT_UINT64, &gpgpu_fast_forward_insn, 
+                "Run whole kernels functionally until this many instructions have executed (0 = off)", 
+                "0");
+   option_parser_register(opp, "-gpgpu_fast_forward_warmup", OPT_BOOL, &gpgpu_fast_forward_warmup, 
+                "Warm the L2 tags, page placement and page access counters from fast-forwarded kernels", 
+                "1");
+   option_parser_register(opp, "-gpgpu_sampling", OPT_INT32, &gpgpu_sampling, 
+                "Kernel launch sampling: 0 = off, 1 = profile basic block vectors functionally, 2 = simulate cluster representatives and extrapolate", 
+                "0");
+   option_parser_register(opp, "-gpgpu_sampling_profile", OPT_CSTR, &gpgpu_sampling_profile, 
+                "Basic block vector profile written by -gpgpu_sampling 1 and read by -gpgpu_sampling 2", 
+                "gpgpusim_bbv.txt");
+   option_parser_register(opp, "-gpgpu_sampling_clusters", OPT_UINT32, &gpgpu_sampling_clusters, 
+                "Maximum number of clusters of kernel launches", 
+                "10");
+   option_parser_register(opp, "-gpgpu_sampling_per_cluster", OPT_UINT32, &gpgpu_sampling_per_cluster, 
+                "Launches per cluster simulated in detail (2 or more give confidence intervals)", 
+                "2");
+   option_parser_register(opp, "-gpgpu_mem_trace_record", OPT_CSTR, &gpgpu_mem_trace_record, 
+                "Record the requests injected into the interconnect to <prefix>.<kernel uid>", 
+                NULL);
+   option_parser_register(opp, "-gpgpu_mem_trace_replay", OPT_CSTR, &gpgpu_mem_trace_replay, 
+                "Run kernels functionally and time only the memory system from the traces <prefix>.<kernel uid>", 
+                NULL);
+   option_parser_register(opp, "-gpgpu_mem_trace_window", OPT_UINT32, &gpgpu_mem_trace_window, 
+                "Maximum requests in flight per SM during memory trace replay", 
+                "32");
+   option_parser_register(opp, "-gpgpu_sweep", OPT_CSTR, &gpgpu_sweep, 
+                "File of option overrides, one sweep point per line, each simulated in a process forked at the first kernel launch", 
+                NULL);
+   option_parser_register(opp, "-gpgpu_sweep_jobs", OPT_UINT32, &gpgpu_sweep_jobs, 
+                "Sweep points simulated at the same time (0 = one per online CPU)", 
+                "0");
+   option_parser_register(opp, "-gpgpu_sweep_output", OPT_CSTR, &gpgpu_sweep_output, 
+                "Results of all sweep points, one JSON object per line (logs go to <output>.<point>.log)", 
+                "gpgpusim_sweep.jsonl");
+   option_parser_register(opp, "-gpgpu_sm_partition", OPT_INT32, &gpgpu_sm_partition, 
+                "Split the SMs among concurrent kernels: 0 = shared round-robin, 1 = evenly, 2 = by grid size, 3 = by CTAs left (dynamic)", 
+                "0");
+   option_parser_register(opp, "-gpgpu_sm_partition_interval", OPT_UINT32, &gpgpu_sm_partition_interval, 
+                "Core cycles between repartitions of -gpgpu_sm_partition 3 (0 = only at kernel launch and exhaustion)", 
+                "10000");
+   option_parser_register(opp, "-gpgpu_kernel_stats", OPT_CSTR, &gpgpu_kernel_stats, 
+                "Append per-kernel counters to this file at every kernel boundary (CSV if it ends in .csv, else JSON lines)", 
+                NULL);
    option_parser_register(opp, "-gpgpu_ptx_instruction_classification", OPT_INT32, 
                &gpgpu_ptx_instruction_classification, 
                "if enabled will classify ptx instruction types per kernel (Max 255 kernels now)", 
@@ -567,6 +633,8 @@ void gpgpu_sim::launch( kernel_info_t *kinfo )
        }
    }
    assert(n < m_running_kernels.size());
+   if( m_kernel_stats ) 
+       m_kernel_stats->kernel_launched(kinfo->get_uid(), kinfo->name());
 }
 
 bool gpgpu_sim::can_start_kernel()
@@ -591,11 +659,12 @@ bool gpgpu_sim::get_more_cta_left() const
    return false;
 }
 
-kernel_info_t *gpgpu_sim::select_kernel()
+kernel_info_t *gpgpu_sim::select_kernel( unsigned sid )
 {
     for(unsigned n=0; n < m_running_kernels.size(); n++ ) {
         unsigned idx = (n+m_last_issued_kernel+1)%m_config.max_concurrent_kernel;
-        if( m_running_kernels[idx] && !m_running_kernels[idx]->no_more_ctas_to_run() ) {
+        if( m_running_kernels[idx] && !m_running_kernels[idx]->no_more_ctas_to_run() 
+            && sm_may_run(sid, m_running_kernels[idx]) ) {
             m_last_issued_kernel=idx;
             // record this kernel for stat print if it is the first time this kernel is selected for execution  
             unsigned launch_uid = m_running_kernels[idx]->get_uid(); 
@@ -617,6 +686,8 @@ unsigned gpgpu_sim::finished_kernel()
     unsigned result = m_finished_kernel.front();
     m_finished_kernel.pop_front();
     if (result) epoch_number++;
+    if (result) m_last_finished_kernel = result;
+    if (result && m_kernel_stats) m_kernel_stats->kernel_finished(result);
     return result;
 }
 
@@ -634,6 +705,129 @@ void gpgpu_sim::set_kernel_done( kernel_info_t *kernel )
     assert( k != m_running_kernels.end() ); 
 }
 
+bool gpgpu_sim::in_fast_forward()
+{
+    if( m_ff_done ) 
+        return false;
+    bool by_kernels = m_config.fast_forward_kernels() && m_ff_kernels < m_config.fast_forward_kernels();
+    bool by_insn = m_config.fast_forward_insn() && m_ff_insn < m_config.fast_forward_insn();
+    if( by_kernels || by_insn ) 
+        return true;
+    if( m_ff_kernels ) {
+        printf("GPGPU-Sim uArch: fast-forwarded %u kernels (%llu instructions), starting detailed simulation\n",
+               m_ff_kernels, m_ff_insn);
+        fflush(stdout);
+    }
+    m_ff_done = true;
+    return false;
+}
+
+void gpgpu_sim::fast_forward_kernel( kernel_info_t &kernel )
+{
+    unsigned start_insn = g_ptx_sim_num_insn;
+    m_warming_up = m_config.fast_forward_warmup();
+    gpgpu_cuda_ptx_sim_main_func(kernel); // registers the kernel as finished
+    m_warming_up = false;
+    m_ff_kernels++;
+    m_ff_insn += (unsigned)(g_ptx_sim_num_insn - start_insn);
+    epoch_number++; // one epoch per kernel, as in finished_kernel()
+}
+
+bool gpgpu_sim::sampling_skips( unsigned kernel_uid ) const
+{
+    return m_sampler && !m_sampler->detailed(kernel_uid);
+}
+
+void gpgpu_sim::sample_kernel_functionally( kernel_info_t &kernel )
+{
+    unsigned uid = kernel.get_uid();
+    std::string name = kernel.name();
+    unsigned start_insn = g_ptx_sim_num_insn;
+    gpgpu_cuda_ptx_sim_main_func(kernel); // registers the kernel as finished
+    epoch_number++;
+    if( m_sampler->mode() == SAMPLING_PROFILE ) {
+        std::map<unsigned,unsigned long long> bbv;
+        ptx_bbv_take(bbv);
+        m_sampler->add_profile(uid, name, (unsigned)(g_ptx_sim_num_insn - start_insn), bbv);
+    }
+}
+
+// cumulative counters of the timing model at a kernel boundary
+kernel_sample_t gpgpu_sim::total_counters() const
+{
+    kernel_sample_t now;
+    now.insn = gpu_tot_sim_insn;
+    now.metric[SAMPLE_CYCLES] = gpu_tot_sim_cycle;
+    for( unsigned i=0; i < m_memory_config->m_n_mem; i++ ) {
+        unsigned type = (i >= m_memory_config->memory_config_array[0].m_n_mem)? 1 : 0;
+        now.metric[SAMPLE_DRAM_REQ_SDDR+type] += m_memory_partition_unit[i]->getTotDramReq();
+    }
+    std::map<unsigned long long, std::array<unsigned long long, 10> >::const_iterator p;
+    for( p=migrationFinished.begin(); p != migrationFinished.end(); ++p ) {
+        if( p->second[3] ) 
+            now.metric[SAMPLE_MIGRATIONS]++;
+    }
+    return now;
+}
+
+// what the partition units attributed to one kernel: its requests to each
+// DRAM tier and the pages its requests queued for migration
+kernel_sample_t gpgpu_sim::kernel_counters( unsigned kernel_uid ) const
+{
+    kernel_sample_t c;
+    for( unsigned i=0; i < m_memory_config->m_n_mem; i++ ) {
+        unsigned type = (i >= m_memory_config->memory_config_array[0].m_n_mem)? 1 : 0;
+        const memory_partition_unit *unit = m_memory_partition_unit[i];
+        std::map<unsigned,unsigned long long>::const_iterator r = unit->kernel_dram_req().find(kernel_uid);
+        if( r != unit->kernel_dram_req().end() ) 
+            c.metric[SAMPLE_DRAM_REQ_SDDR+type] += r->second;
+        r = unit->kernel_migrations().find(kernel_uid);
+        if( r != unit->kernel_migrations().end() ) 
+            c.metric[SAMPLE_MIGRATIONS] += r->second;
+    }
+    return c;
+}
+
+// called at a kernel boundary: charges what the timing model did since the
+// last call to the kernel that just finished and prints the updated estimate
+void gpgpu_sim::record_sample()
+{
+    if( !m_sampler || m_sampler->mode() != SAMPLING_SIMULATE || !m_last_finished_kernel ) 
+        return;
+    kernel_sample_t now = total_counters();
+    kernel_sample_t delta;
+    delta.insn = now.insn - m_sample_base.insn;
+    for( unsigned m=0; m < N_SAMPLE_METRICS; m++ ) 
+        delta.metric[m] = now.metric[m] - m_sample_base.metric[m];
+    m_sample_base = now;
+    m_sampler->add_sample(m_last_finished_kernel, delta);
+    m_sampler->print(stdout);
+}
+
+// Replays the global accesses of a functionally executed warp instruction on
+// the L2 tags, once per line; L2 misses are counted as DRAM page accesses.
+void gpgpu_sim::warm_access( const warp_inst_t &inst )
+{
+    const memory_config *config = &m_memory_config->memory_config_array[0];
+    new_addr_type line_mask = ~(new_addr_type)(config->m_L2_config.get_line_sz()-1);
+    new_addr_type last_line = (new_addr_type)-1;
+    for( unsigned t=0; t < inst.warp_size(); t++ ) {
+        if( !inst.active(t) ) 
+            continue;
+        new_addr_type line = inst.get_addr(t) & line_mask;
+        if( line == last_line ) 
+            continue;
+        last_line = line;
+        unsigned type = page_placement(line, config);
+        addrdec_t tlx;
+        m_memory_config->memory_config_array[type].m_address_mapping.addrdec_tlx_hetero(line, &tlx, type*config->m_n_mem_sub_partition);
+        if( !m_memory_sub_partition[tlx.sub_partition]->warm_L2(line, inst.is_store()) ) {
+            unsigned mpid = tlx.sub_partition / config->m_n_sub_partition_per_memory_channel;
+            m_memory_partition_unit[mpid]->count_page_access(line, tlx);
+        }
+    }
+}
+
 void set_ptx_warp_size(const struct core_config * warp_size);
 
 gpgpu_sim::gpgpu_sim( const gpgpu_sim_config &config ) 
@@ -670,6 +864,18 @@ gpgpu_sim::gpgpu_sim( const gpgpu_sim_config &config )
     gpu_tot_sim_insn = 0;
     gpu_tot_issued_cta = 0;
     gpu_deadlock = false;
+    m_last_finished_kernel = 0;
+    m_ff_kernels = 0;
+    m_ff_insn = 0;
+    m_ff_done = false;
+    m_warming_up = false;
+
+    m_sampler = NULL;
+    if (m_config.sampling() != SAMPLING_OFF) {
+        m_sampler = new kernel_sampler(m_config.sampling(), m_config.gpgpu_sampling_profile, 
+                                       m_config.gpgpu_sampling_clusters, m_config.gpgpu_sampling_per_cluster);
+        g_ptx_bbv_enabled = (m_config.sampling() == SAMPLING_PROFILE);
+    }
 
 
     m_cluster = new simt_core_cluster*[m_shader_config->n_simt_clusters];
@@ -678,6 +884,22 @@ gpgpu_sim::gpgpu_sim( const gpgpu_sim_config &config )
         m_cluster[i] = new simt_core_cluster(this,i,m_shader_config,&m_memory_config->memory_config_array[0],m_shader_stats,m_memory_stats);
     }
 
+    m_mem_trace_writer = NULL;
+    m_mem_trace_replay = NULL;
+    if (m_config.mem_trace_record() && m_config.mem_trace_replay()) {
+        printf("GPGPU-Sim uArch: ERROR ** -gpgpu_mem_trace_record and -gpgpu_mem_trace_replay are exclusive\n");
+        abort();
+    }
+    if (m_config.mem_trace_record())
+        m_mem_trace_writer = new mem_trace_writer(m_config.mem_trace_record());
+    if (m_config.mem_trace_replay())
+        m_mem_trace_replay = new mem_trace_replayer(m_config.mem_trace_replay(), m_config.gpgpu_mem_trace_window,
+                                                    m_shader_config, &m_memory_config->memory_config_array[0], m_cluster);
+
+    m_kernel_stats = NULL;
+    if (m_config.kernel_stats())
+        m_kernel_stats = new kernel_stats_writer(m_config.kernel_stats());
+
     //TODO: for now, assume all memories have same partition parameters except
     //dram timing
     m_memory_partition_unit = new memory_partition_unit*[m_memory_config->m_n_mem];
@@ -718,12 +940,22 @@ gpgpu_sim::gpgpu_sim( const gpgpu_sim_config &config )
 
     m_running_kernels.resize( config.max_concurrent_kernel, NULL );
     m_last_issued_kernel = 0;
+    if( m_config.sm_partition() < SM_PARTITION_OFF || m_config.sm_partition() > SM_PARTITION_DYNAMIC ) {
+        printf("GPGPU-Sim uArch: ERROR ** unknown -gpgpu_sm_partition %d\n", m_config.sm_partition());
+        abort();
+    }
+    m_sm_owner.resize( m_shader_config->num_shader(), NULL );
+    m_next_partition_cycle = 0;
     m_last_cluster_issue = 0;
     *average_pipeline_duty_cycle=0;
     *active_sms=0;
 
     last_liveness_message_time = 0;
 
+    m_sim_threads = NULL;
+    start_sim_threads();
+    m_l2_step_cycle = 0;
+
     epoch_number = 0;
 }
 
@@ -811,6 +1043,8 @@ bool gpgpu_sim::active()
         return true;
     if( get_more_cta_left() )
         return true;
+    if( m_mem_trace_replay && m_mem_trace_replay->busy() )
+        return true;
     return false;
 }
 
@@ -820,6 +1054,7 @@ void gpgpu_sim::init()
     gpu_sim_cycle = 0;
     gpu_sim_insn = 0;
     last_gpu_sim_insn = 0;
+    last_mem_trace_progress = 0;
     m_total_cta_launched=0;
 
     reinit_clock_domains();
@@ -897,6 +1132,8 @@ void gpgpu_sim::deadlock_check()
          }
       }
       printf("\n");
+      if (m_mem_trace_replay)
+         m_mem_trace_replay->print_deadlock(stdout);
       for (unsigned i=0;i<m_memory_config->m_n_mem;i++) {
          bool busy = m_memory_partition_unit[i]->busy();
          if( busy ) 
@@ -908,6 +1145,9 @@ void gpgpu_sim::deadlock_check()
       }
       printf("\nRe-run the simulator in gdb and use debug routines in .gdbinit to debug this\n");
       fflush(stdout);
+      // the replayed kernels would never finish and the host would wait on them
+      if (m_mem_trace_replay)
+         abort();
       //abort();
    }
 }
@@ -1036,6 +1276,18 @@ void gpgpu_sim::gpu_print_stat()
    // performance counter for stalls due to congestion.
    printf("gpu_stall_dramfull = %d\n", gpu_stall_dramfull);
    printf("gpu_stall_icnt2sh    = %d\n", gpu_stall_icnt2sh );
+   if (m_mem_trace_replay)
+      m_mem_trace_replay->print_stats(stdout);
+   for (unsigned k = 0; k <= m_executed_kernel_uids.size(); k++) {
+      // uid 0: requests of no kernel (L2 writebacks, migration traffic)
+      unsigned uid = (k < m_executed_kernel_uids.size())? m_executed_kernel_uids[k] : 0;
+      kernel_sample_t c = kernel_counters(uid);
+      if (!uid && !c.metric[SAMPLE_DRAM_REQ_SDDR] && !c.metric[SAMPLE_DRAM_REQ_HBM])
+         continue;
+      printf("kernel_dram_req[%u] = sddr %llu, hbm %llu\n", uid,
+             c.metric[SAMPLE_DRAM_REQ_SDDR], c.metric[SAMPLE_DRAM_REQ_HBM]);
+      printf("kernel_migrations_queued[%u] = %llu\n", uid, c.metric[SAMPLE_MIGRATIONS]);
+   }
 
    time_t curr_time;
    time(&curr_time);
@@ -1103,6 +1355,7 @@ void gpgpu_sim::gpu_print_stat()
                printf("L2_total_cache_reservation_fails = %u\n", total_l2_css.res_fails);
                printf("L2_total_cache_breakdown:\n");
                l2_stats.print_stats(stdout, "L2_cache_stats_breakdown");
+               l2_stats.print_set_sampling_stats(stdout, "L2_cache");
                total_l2_css.print_port_stats(stdout, "L2_cache");
             }
         }
@@ -1317,8 +1570,104 @@ int gpgpu_sim::next_clock_domain(void)
    return mask;
 }
 
+static unsigned long long ctas_left( const kernel_info_t *kernel )
+{
+    if( kernel->no_more_ctas_to_run() ) 
+        return 0;
+    dim3 grid = kernel->get_grid_dim();
+    dim3 next = kernel->get_next_cta_id();
+    return kernel->num_blocks() - (next.x + grid.x*(next.y + grid.y*next.z));
+}
+
+// -gpgpu_sm_partition: gives each kernel with CTAs left to issue a contiguous
+// range of SMs, at least one while there are enough SMs, the rest split by
+// largest remainder of the policy's weights. Recomputed whenever a kernel is
+// launched or issues its last CTA, and every -gpgpu_sm_partition_interval
+// cycles under the dynamic policy. SMs handed to another kernel drain first
+// (see sm_may_run()).
+void gpgpu_sim::update_sm_partition()
+{
+    unsigned long long now = gpu_sim_cycle + gpu_tot_sim_cycle;
+    bool changed = false;
+    unsigned nk = 0;
+    for( unsigned n=0; n < m_running_kernels.size(); n++ ) {
+        kernel_info_t *k = m_running_kernels[n];
+        if( !k || k->no_more_ctas_to_run() ) 
+            continue;
+        if( nk >= m_partition_kernels.size() ) 
+            m_partition_kernels.push_back(NULL);
+        if( m_partition_kernels[nk] != k ) {
+            m_partition_kernels[nk] = k;
+            changed = true;
+        }
+        nk++;
+    }
+    if( nk != m_partition_kernels.size() ) {
+        m_partition_kernels.resize(nk);
+        changed = true;
+    }
+    bool due = m_config.sm_partition() == SM_PARTITION_DYNAMIC && m_config.sm_partition_interval() 
+               && now >= m_next_partition_cycle;
+    if( !changed && !due ) 
+        return;
+    m_next_partition_cycle = now + m_config.sm_partition_interval();
+
+    unsigned n_sm = m_sm_owner.size();
+    std::vector<unsigned> share(nk, 0);
+    if( nk > n_sm ) {
+        // one SM each for the oldest slots, the others wait for a repartition
+        for( unsigned k=0; k < n_sm; k++ ) 
+            share[k] = 1;
+    } else if( nk ) {
+        std::vector<double> weight(nk, 1.0);
+        double total = 0;
+        for( unsigned k=0; k < nk; k++ ) {
+            if( m_config.sm_partition() == SM_PARTITION_PROPORTIONAL ) 
+                weight[k] = m_partition_kernels[k]->num_blocks();
+            else if( m_config.sm_partition() == SM_PARTITION_DYNAMIC ) 
+                weight[k] = ctas_left(m_partition_kernels[k]);
+            total += weight[k];
+        }
+        unsigned spare = n_sm - nk;
+        unsigned given = 0;
+        std::vector<double> rem(nk);
+        for( unsigned k=0; k < nk; k++ ) {
+            double exact = spare * weight[k] / total;
+            share[k] = 1 + (unsigned)exact;
+            rem[k] = exact - (unsigned)exact;
+            given += share[k];
+        }
+        while( given < n_sm ) {
+            unsigned best = 0;
+            for( unsigned k=1; k < nk; k++ ) 
+                if( rem[k] > rem[best] ) 
+                    best = k;
+            share[best]++;
+            rem[best] = -1;
+            given++;
+        }
+    }
+
+    std::vector<kernel_info_t*> owner(n_sm, (kernel_info_t*)NULL);
+    unsigned sid = 0;
+    for( unsigned k=0; k < nk; k++ ) 
+        for( unsigned i=0; i < share[k]; i++ ) 
+            owner[sid++] = m_partition_kernels[k];
+    if( owner == m_sm_owner ) 
+        return;
+    m_sm_owner = owner;
+    sid = 0;
+    for( unsigned k=0; k < nk && share[k]; k++ ) {
+        printf("GPGPU-Sim uArch: SM partition @ %llu: kernel %u \'%s\' on SMs %u-%u\n", now, 
+               m_partition_kernels[k]->get_uid(), m_partition_kernels[k]->name().c_str(), sid, sid+share[k]-1);
+        sid += share[k];
+    }
+}
+
 void gpgpu_sim::issue_block2core()
 {
+    if( m_config.sm_partition() != SM_PARTITION_OFF ) 
+        update_sm_partition();
     unsigned last_issued = m_last_cluster_issue; 
     for (unsigned i=0;i<m_shader_config->n_simt_clusters;i++) {
         unsigned idx = (i + last_issued + 1) % m_shader_config->n_simt_clusters;
@@ -1332,6 +1681,18 @@ void gpgpu_sim::issue_block2core()
 
 unsigned long long g_single_step=0; // set this in gdb to single step the pipeline
 
+// The per-cycle GPUWattch snapshots (DRAM, cache and icnt counters, active
+// SMs, pipeline duty cycle) are only read by mcpat_cycle(); gathering them
+// walks every cluster and sub partition, so it is skipped otherwise.
+bool gpgpu_sim::power_stats_enabled() const
+{
+#ifdef GPGPUSIM_POWER_MODEL
+    return m_config.g_power_simulation_enabled;
+#else
+    return false;
+#endif
+}
+
 void increaseMigrationThreshold() {
     migrationThreshold += 16;
 }
@@ -1355,6 +1716,28 @@ void gpgpu_sim::calculateMigrationThreshold() {
     }
 }
 
+void gpgpu_sim::start_sim_threads()
+{
+    assert( m_sim_threads == NULL );
+    if (m_config.sim_threads() > 1) {
+        m_sim_threads = new sim_thread_pool(m_config.sim_threads());
+        printf("GPGPU-Sim uArch: stepping L2 sub partitions on %u threads\n", m_config.sim_threads());
+    }
+}
+
+void gpgpu_sim::stop_sim_threads()
+{
+    delete m_sim_threads; // joins the workers
+    m_sim_threads = NULL;
+}
+
+void gpgpu_sim::cache_step_task( void *gpu, unsigned task )
+{
+    gpgpu_sim *sim = (gpgpu_sim*)gpu;
+    unsigned i = sim->m_busy_sub_partitions[task];
+    sim->m_memory_sub_partition[i]->parallel_cache_step(sim->m_l2_step_cycle);
+}
+
 void gpgpu_sim::cycle()
 {
     if (enableMigration 
@@ -1395,8 +1778,13 @@ void gpgpu_sim::cycle()
 
    if (clock_mask & CORE ) {
        // shader core loading (pop from ICNT into core) follows CORE clock
-      for (unsigned i=0;i<m_shader_config->n_simt_clusters;i++) 
-         m_cluster[i]->icnt_cycle(); 
+      if (m_mem_trace_replay) {
+         // the trace stands in for the cores, which stay idle
+         m_mem_trace_replay->cycle(gpu_sim_cycle+gpu_tot_sim_cycle, m_finished_kernel);
+      } else {
+         for (unsigned i=0;i<m_shader_config->n_simt_clusters;i++) 
+            m_cluster[i]->icnt_cycle(); 
+      }
    }
     unsigned tot_mem_sub_partitions=0; 
     for  (unsigned i=0; i<2; i++)
@@ -1405,6 +1793,9 @@ void gpgpu_sim::cycle()
         // pop from memory controller to interconnect
 //        for (unsigned i=0;i<m_memory_config->memory_config_array[0].m_n_mem_sub_partition;i++) {
         for (unsigned i=0;i<tot_mem_sub_partitions;i++) {
+            // top() and pop() do nothing on an empty L2-to-icnt queue
+            if (m_memory_sub_partition[i]->L2_icnt_queue_empty())
+                continue;
             mem_fetch* mf = m_memory_sub_partition[i]->top();
             if (mf) {
                 unsigned response_size = mf->get_is_write()?mf->get_ctrl_size():mf->size();
@@ -1536,11 +1927,14 @@ void gpgpu_sim::cycle()
         }
     }
 
+   bool power_stats = power_stats_enabled();
+
    if (clock_mask & DRAM) {
       for (unsigned i=0;i<m_memory_config->memory_config_array[0].m_n_mem;i++){
 //      for (unsigned i=0;i<m_memory_config->m_n_mem;i++){
          m_memory_partition_unit[i]->dram_cycle(); // Issue the dram command (scheduler + delay model)
          // Update performance counters for DRAM
+         if (power_stats)
          m_memory_partition_unit[i]->set_dram_power_stats(m_power_stats->pwr_mem_stat->n_cmd[CURRENT_STAT_IDX][i], m_power_stats->pwr_mem_stat->n_activity[CURRENT_STAT_IDX][i],
          m_power_stats->pwr_mem_stat->n_nop[CURRENT_STAT_IDX][i], m_power_stats->pwr_mem_stat->n_act[CURRENT_STAT_IDX][i], m_power_stats->pwr_mem_stat->n_pre[CURRENT_STAT_IDX][i],
          m_power_stats->pwr_mem_stat->n_rd[CURRENT_STAT_IDX][i], m_power_stats->pwr_mem_stat->n_wr[CURRENT_STAT_IDX][i], m_power_stats->pwr_mem_stat->n_req[CURRENT_STAT_IDX][i]);
@@ -1553,6 +1947,7 @@ void gpgpu_sim::cycle()
           i = j + m_memory_config->memory_config_array[0].m_n_mem;
          m_memory_partition_unit[i]->dram_cycle(); // Issue the dram command (scheduler + delay model)
 //          Update performance counters for DRAM
+         if (power_stats)
          m_memory_partition_unit[i]->set_dram_power_stats(
                  m_power_stats->pwr_mem_stat->n_cmd[CURRENT_STAT_IDX][i],
                  m_power_stats->pwr_mem_stat->n_activity[CURRENT_STAT_IDX][i],
@@ -1567,8 +1962,15 @@ void gpgpu_sim::cycle()
 
    // L2 operations follow L2 clock domain
    if (clock_mask & L2) {
-       m_power_stats->pwr_mem_stat->l2_cache_stats[CURRENT_STAT_IDX].clear();
+       if (power_stats)
+           m_power_stats->pwr_mem_stat->l2_cache_stats[CURRENT_STAT_IDX].clear();
 //      for (unsigned i=0;i<m_memory_config->memory_config_array[0].m_n_mem_sub_partition;i++) {
+      // With -gpgpu_sim_threads the cache_cycle() of busy sub partitions is
+      // split: their cache_step()s run on the thread pool after all requests
+      // have been taken from the icnt (push() and cache_cycle() of different
+      // sub partitions do not interact), then their cache_commit()s run here
+      // in sub partition order, which gives the serial result.
+      m_busy_sub_partitions.clear();
       for (unsigned i=0;i<tot_mem_sub_partitions;i++) {
           //move memory request from interconnect into memory partition (if not backed up)
           //Note:This needs to be called in DRAM clock domain if there is no L2 cache in the system
@@ -1585,8 +1987,26 @@ void gpgpu_sim::cycle()
                       printf("break me here \n");
               }
           }
-          m_memory_sub_partition[i]->cache_cycle(gpu_sim_cycle+gpu_tot_sim_cycle);
-          m_memory_sub_partition[i]->accumulate_L2cache_stats(m_power_stats->pwr_mem_stat->l2_cache_stats[CURRENT_STAT_IDX]);
+          if (m_memory_sub_partition[i]->idle()) {
+              m_memory_sub_partition[i]->skip_cycle();
+          } else if (m_sim_threads) {
+              m_busy_sub_partitions.push_back(i);
+              continue;
+          } else {
+              m_memory_sub_partition[i]->cache_cycle(gpu_sim_cycle+gpu_tot_sim_cycle);
+          }
+          if (power_stats)
+              m_memory_sub_partition[i]->accumulate_L2cache_stats(m_power_stats->pwr_mem_stat->l2_cache_stats[CURRENT_STAT_IDX]);
+       }
+       if (!m_busy_sub_partitions.empty()) {
+          m_l2_step_cycle = gpu_sim_cycle+gpu_tot_sim_cycle;
+          m_sim_threads->run(m_busy_sub_partitions.size(), cache_step_task, this);
+          for (unsigned b=0; b < m_busy_sub_partitions.size(); b++) {
+              memory_sub_partition *sub = m_memory_sub_partition[m_busy_sub_partitions[b]];
+              sub->cache_commit();
+              if (power_stats)
+                  sub->accumulate_L2cache_stats(m_power_stats->pwr_mem_stat->l2_cache_stats[CURRENT_STAT_IDX]);
+          }
        }
    }
 
@@ -1612,11 +2032,15 @@ void gpgpu_sim::cycle()
               }
           }
       }
-      m_power_stats->pwr_mem_stat->core_cache_stats[CURRENT_STAT_IDX].clear();
+      if (power_stats)
+          m_power_stats->pwr_mem_stat->core_cache_stats[CURRENT_STAT_IDX].clear();
+      // core_cycle() issues no CTAs, so this holds for the whole loop
+      bool more_cta_left = get_more_cta_left();
       for (unsigned i=0;i<m_shader_config->n_simt_clusters;i++) {
-         if (m_cluster[i]->get_not_completed() || get_more_cta_left() ) {
+         if (m_cluster[i]->get_not_completed() || more_cta_left ) {
                m_cluster[i]->core_cycle();
-               *active_sms+=m_cluster[i]->get_n_active_sms();
+               if (power_stats)
+                   *active_sms+=m_cluster[i]->get_n_active_sms();
          } else {
             // if shader is empty then clear the migrating bit of L1 pending in
             // the migrationQueue data structure
@@ -1630,15 +2054,19 @@ void gpgpu_sim::cycle()
 //             }
          }
          // Update core icnt/cache stats for GPUWattch
-         m_cluster[i]->get_icnt_stats(m_power_stats->pwr_mem_stat->n_simt_to_mem[CURRENT_STAT_IDX][i], m_power_stats->pwr_mem_stat->n_mem_to_simt[CURRENT_STAT_IDX][i]);
-         m_cluster[i]->get_cache_stats(m_power_stats->pwr_mem_stat->core_cache_stats[CURRENT_STAT_IDX]);
+         if (power_stats) {
+            m_cluster[i]->get_icnt_stats(m_power_stats->pwr_mem_stat->n_simt_to_mem[CURRENT_STAT_IDX][i], m_power_stats->pwr_mem_stat->n_mem_to_simt[CURRENT_STAT_IDX][i]);
+            m_cluster[i]->get_cache_stats(m_power_stats->pwr_mem_stat->core_cache_stats[CURRENT_STAT_IDX]);
+         }
       }
-      float temp=0;
-      for (unsigned i=0;i<m_shader_config->num_shader();i++){
-        temp+=m_shader_stats->m_pipeline_duty_cycle[i];
+      if (power_stats) {
+         float temp=0;
+         for (unsigned i=0;i<m_shader_config->num_shader();i++){
+           temp+=m_shader_stats->m_pipeline_duty_cycle[i];
+         }
+         temp=temp/m_shader_config->num_shader();
+         *average_pipeline_duty_cycle=((*average_pipeline_duty_cycle)+temp);
       }
-      temp=temp/m_shader_config->num_shader();
-      *average_pipeline_duty_cycle=((*average_pipeline_duty_cycle)+temp);
         //cout<<"Average pipeline duty cycle: "<<*average_pipeline_duty_cycle<<endl;
 
 
@@ -1737,8 +2165,16 @@ void gpgpu_sim::cycle()
       }
 
       if (!(gpu_sim_cycle % 20000)) {
-         // deadlock detection 
-         if (m_config.gpu_deadlock_detect && gpu_sim_insn == last_gpu_sim_insn) {
+         // deadlock detection; a replay commits no instructions, so it has
+         // to issue or retire trace requests instead
+         if (m_mem_trace_replay) {
+            unsigned long long progress = m_mem_trace_replay->progress();
+            if (m_config.gpu_deadlock_detect && progress == last_mem_trace_progress) {
+               gpu_deadlock = true;
+            } else {
+               last_mem_trace_progress = progress;
+            }
+         } else if (m_config.gpu_deadlock_detect && gpu_sim_insn == last_gpu_sim_insn) {
             gpu_deadlock = true;
          } else {
             last_gpu_sim_insn = gpu_sim_insn;
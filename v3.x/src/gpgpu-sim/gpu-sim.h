@@ -36,12 +36,16 @@
 #include <iostream>
 #include <fstream>
 #include <list>
+#include <set>
 #include <stdio.h>
 #include <deque>
 #include <bitset>
 #include <array>
 
 #include "migrate.h"
+#include "sampling.h"
+#include "mem_trace.h"
+#include "kernel_stats.h"
 
 
 // constants for statistics printouts
@@ -75,6 +79,14 @@ enum dram_ctrl_t {
    DRAM_FRFCFS=1
 };
 
+// -gpgpu_sm_partition: how the SMs are shared among concurrent kernels
+enum sm_partition_t {
+   SM_PARTITION_OFF=0,          // any idle SM takes the next kernel round-robin
+   SM_PARTITION_STATIC=1,       // equal contiguous ranges
+   SM_PARTITION_PROPORTIONAL=2, // ranges sized by grid size
+   SM_PARTITION_DYNAMIC=3       // sized by CTAs left, resized periodically
+};
+
 
 
 struct power_config {
@@ -308,6 +320,9 @@ struct memory_config_types {
         option_parser_register(opp, "-gpgpu_n_mem_types", OPT_UINT32, &m_n_mem_types, 
                  "number of different types memory modules (e.g. DRAM, HBM etc) in gpu",
                  "1");
+        option_parser_register(opp, "-gpgpu_mem_addr_fast_row_hash", OPT_BOOL, &g_addrdec_fast_row_hash, 
+                 "compute the DRAM row hash without reseeding rand() (faster, changes which pages are sampled for migration)",
+                 "0");
         option_parser_register(opp, "-enable_addr_limit", OPT_UINT32, &enable_addr_limit, 
                  "enable addr separation",
                  "0");
@@ -414,6 +429,23 @@ public:
         power_config::init();
         Trace::init();
 
+        // -gpgpu_checkpoint_kernels: "all" or a comma separated list of kernel uids
+        m_checkpoint_all = !strcmp(gpgpu_checkpoint_kernels,"all");
+        m_checkpoint_uids.clear();
+        if( !m_checkpoint_all ) {
+            const char *s = gpgpu_checkpoint_kernels;
+            while( *s ) {
+                char *end;
+                unsigned long uid = strtoul(s,&end,10);
+                if( end == s ) {
+                    printf("GPGPU-Sim uArch: ERROR ** bad -gpgpu_checkpoint_kernels \"%s\"\n", gpgpu_checkpoint_kernels);
+                    abort();
+                }
+                m_checkpoint_uids.insert(uid);
+                s = (*end == ',') ? end+1 : end;
+            }
+        }
+
 
         // initialize file name if it is not set 
         time_t curr_time;
@@ -435,6 +467,25 @@ public:
     unsigned num_shader() const { return m_shader_config.num_shader(); }
     unsigned num_cluster() const { return m_shader_config.n_simt_clusters; }
     unsigned get_max_concurrent_kernel() const { return max_concurrent_kernel; }
+    unsigned sim_threads() const { return gpgpu_sim_threads; }
+    const char *checkpoint_dir() const { return gpgpu_checkpoint_dir; }
+    bool checkpoint_kernel( unsigned uid ) const 
+    { 
+        return m_checkpoint_all || m_checkpoint_uids.count(uid); 
+    }
+    unsigned restore_kernel() const { return gpgpu_restore_kernel; }
+    unsigned fast_forward_kernels() const { return gpgpu_fast_forward_kernels; }
+    unsigned long long fast_forward_insn() const { return gpgpu_fast_forward_insn; }
+    bool fast_forward_warmup() const { return gpgpu_fast_forward_warmup; }
+    int sampling() const { return gpgpu_sampling; }
+    const char *mem_trace_record() const { return gpgpu_mem_trace_record; }
+    const char *mem_trace_replay() const { return gpgpu_mem_trace_replay; }
+    const char *sweep() const { return gpgpu_sweep; }
+    unsigned sweep_jobs() const { return gpgpu_sweep_jobs; }
+    const char *sweep_output() const { return gpgpu_sweep_output; }
+    int sm_partition() const { return gpgpu_sm_partition; }
+    const char *kernel_stats() const { return gpgpu_kernel_stats; }
+    unsigned sm_partition_interval() const { return gpgpu_sm_partition_interval; }
 
 private:
     void init_clock_domains(void ); 
@@ -463,6 +514,28 @@ private:
     bool  gpgpu_flush_l1_cache;
     bool  gpgpu_flush_l2_cache;
     bool  gpu_deadlock_detect;
+    unsigned gpgpu_sim_threads;
+    char *gpgpu_checkpoint_dir;
+    char *gpgpu_checkpoint_kernels;
+    bool m_checkpoint_all;
+    std::set<unsigned> m_checkpoint_uids;
+    unsigned gpgpu_restore_kernel;
+    unsigned gpgpu_fast_forward_kernels;
+    unsigned long long gpgpu_fast_forward_insn;
+    bool gpgpu_fast_forward_warmup;
+    int gpgpu_sampling;
+    char *gpgpu_sampling_profile;
+    unsigned gpgpu_sampling_clusters;
+    unsigned gpgpu_sampling_per_cluster;
+    char *gpgpu_mem_trace_record;
+    char *gpgpu_mem_trace_replay;
+    unsigned gpgpu_mem_trace_window;
+    char *gpgpu_sweep;
+    unsigned gpgpu_sweep_jobs;
+    char *gpgpu_sweep_output;
+    int gpgpu_sm_partition;
+    unsigned gpgpu_sm_partition_interval;
+    char *gpgpu_kernel_stats;
     int   gpgpu_frfcfs_dram_sched_queue_size; 
     int   gpgpu_cflog_interval;
     char * gpgpu_clock_domains;
@@ -503,6 +576,38 @@ public:
    void update_stats();
    void deadlock_check();
 
+   // kernel boundary checkpoints (checkpoint.cc)
+   void save_checkpoint();
+   bool restoring( unsigned kernel_uid ) const;
+   void restore_kernel( kernel_info_t &kernel );
+
+   // functional fast-forward of the first kernels (-gpgpu_fast_forward_*)
+   bool in_fast_forward();
+   void fast_forward_kernel( kernel_info_t &kernel );
+   bool warming_up() const { return m_warming_up; }
+   void warm_access( const warp_inst_t &inst );
+
+   // SimPoint-style sampling of kernel launches (-gpgpu_sampling)
+   bool sampling_skips( unsigned kernel_uid ) const;
+   void sample_kernel_functionally( kernel_info_t &kernel );
+   void record_sample();
+   kernel_sample_t total_counters() const;
+
+   // memory-system-only simulation from a request trace (mem_trace.cc)
+   void record_mem_trace( unsigned kernel_uid, const class mem_fetch *mf );
+   void close_mem_trace();
+   bool replaying_mem_trace() const { return m_mem_trace_replay != NULL; }
+   void replay_kernel( kernel_info_t &kernel );
+
+   // machine-readable per-kernel counters (kernel_stats.cc)
+   void export_kernel_stats();
+   void kernel_stats_point( unsigned n );
+
+   // -gpgpu_sim_threads workers do not survive fork(): -gpgpu_sweep stops
+   // them before forking and every sweep point starts its own
+   void start_sim_threads();
+   void stop_sim_threads();
+
    void get_pdom_stack_top_info( unsigned sid, unsigned tid, unsigned *pc, unsigned *rpc );
 
    int shared_mem_size() const;
@@ -514,7 +619,16 @@ public:
 
    unsigned threads_per_core() const;
    bool get_more_cta_left() const;
-   kernel_info_t *select_kernel();
+   kernel_info_t *select_kernel( unsigned sid );
+   // -gpgpu_sm_partition: an SM only takes new CTAs of the kernel that owns
+   // it; it drains the CTAs of any other kernel it still runs
+   bool sm_may_run( unsigned sid, const kernel_info_t *kernel ) const
+   {
+      return m_config.sm_partition() == SM_PARTITION_OFF || m_sm_owner[sid] == kernel;
+   }
+   // DRAM requests per tier and pages queued for migration by one kernel
+   // (SAMPLE_CYCLES is not set)
+   kernel_sample_t kernel_counters( unsigned kernel_uid ) const;
 
    const gpgpu_sim_config &get_config() const { return m_config; }
    void gpu_print_stat();
@@ -554,6 +668,9 @@ private:
    void reinit_clock_domains(void);
    int  next_clock_domain(void);
    void issue_block2core();
+   void update_sm_partition();
+   bool power_stats_enabled() const;
+   static void cache_step_task( void *gpu, unsigned task );
    void print_dram_stats(FILE *fout) const;
    void shader_print_runtime_stat( FILE *fout );
    void shader_print_l1_miss_stat( FILE *fout ) const;
@@ -564,6 +681,11 @@ private:
 
    void gpgpu_debug();
 
+   std::string checkpoint_file( unsigned kernel_uid ) const;
+   bool load_checkpoint( unsigned kernel_uid, bool full );
+
+   void take_stats_snapshot( struct kernel_stats_snapshot_t &s ) const;
+
 ///// data /////
 
    class simt_core_cluster **m_cluster;
@@ -577,8 +699,22 @@ private:
 
    std::vector<kernel_info_t*> m_running_kernels;
    unsigned m_last_issued_kernel;
+   std::vector<kernel_info_t*> m_sm_owner;         // by sid, -gpgpu_sm_partition
+   std::vector<kernel_info_t*> m_partition_kernels; // kernels with CTAs left, by slot
+   unsigned long long m_next_partition_cycle;
 
    std::list<unsigned> m_finished_kernel;
+   unsigned m_last_finished_kernel; // uid last returned by finished_kernel()
+   unsigned m_ff_kernels;               // kernels run functionally by fast_forward_kernel()
+   unsigned long long m_ff_insn;        // and their instructions
+   bool m_ff_done;                      // a kernel has been timed; no more fast-forward
+   bool m_warming_up;                   // functional accesses warm the memory system
+
+   class kernel_sampler *m_sampler;     // NULL unless -gpgpu_sampling
+   kernel_sample_t m_sample_base;       // cumulative counters at the last record_sample()
+   class mem_trace_writer *m_mem_trace_writer;   // NULL unless -gpgpu_mem_trace_record
+   class mem_trace_replayer *m_mem_trace_replay; // NULL unless -gpgpu_mem_trace_replay
+   class kernel_stats_writer *m_kernel_stats;    // NULL unless -gpgpu_kernel_stats
    unsigned m_total_cta_launched;
    unsigned m_last_cluster_issue;
    float * average_pipeline_duty_cycle;
@@ -593,6 +729,11 @@ private:
    // debug
    bool gpu_deadlock;
 
+   // -gpgpu_sim_threads: workers stepping the L2 sub partitions
+   class sim_thread_pool *m_sim_threads;
+   std::vector<unsigned> m_busy_sub_partitions; // stepped this L2 cycle
+   unsigned long long m_l2_step_cycle;
+
    //// configuration parameters ////
    const gpgpu_sim_config &m_config;
   
@@ -607,6 +748,7 @@ private:
    class gpgpu_sim_wrapper *m_gpgpusim_wrapper;
    unsigned long long  gpu_tot_issued_cta;
    unsigned long long  last_gpu_sim_insn;
+   unsigned long long  last_mem_trace_progress; // deadlock detection while replaying
 
    unsigned long long  last_liveness_message_time; 
 
@@ -0,0 +1,293 @@
+// Per-kernel counters in JSON lines or CSV (see kernel_stats.h).
+
+#include "kernel_stats.h"
+#include "gpu-sim.h"
+#include "l2cache.h"
+#include "shader.h"
+#include "mem_latency_stat.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+static const char *g_tier_name[KSTAT_TIERS] = { "sddr", "hbm" };
+static const char *g_lat_name[N_KSTAT_LAT] = { "mf", "mrq", "dq", "icnt2mem", "icnt2sh" };
+static const unsigned g_lat_buckets[N_KSTAT_LAT] = { 32, 32, 32, 24, 24 }; // as in memory_stats_t
+
+kernel_stats_snapshot_t::kernel_stats_snapshot_t()
+{
+   cycle = 0;
+   insn = 0;
+   memset(dram_rd,0,sizeof(dram_rd));
+   memset(dram_wr,0,sizeof(dram_wr));
+   memset(dram_act,0,sizeof(dram_act));
+   memset(dram_req,0,sizeof(dram_req));
+   memset(lat,0,sizeof(lat));
+   page_blocking_stall = 0;
+}
+
+kernel_stats_writer::kernel_stats_writer( const char *path )
+{
+   m_path = path;
+   size_t len = m_path.size();
+   m_csv = len >= 4 && !strcasecmp(m_path.c_str()+len-4, ".csv");
+   m_fp = NULL;
+   m_header_written = false;
+   m_interval = 0;
+}
+
+kernel_stats_writer::~kernel_stats_writer()
+{
+   if( m_fp )
+      fclose(m_fp);
+}
+
+void kernel_stats_writer::set_point( unsigned n )
+{
+   assert( !m_fp );
+   char buf[32];
+   snprintf(buf,sizeof(buf),".%u",n);
+   size_t dot = m_path.rfind('.');
+   size_t slash = m_path.rfind('/');
+   if( dot == std::string::npos || (slash != std::string::npos && dot < slash) )
+      dot = m_path.size();
+   m_path.insert(dot,buf);
+}
+
+// opened at the first record, so that sweep points forked before it get
+// their own file
+void kernel_stats_writer::open()
+{
+   m_fp = fopen(m_path.c_str(),"w");
+   if( !m_fp ) {
+      printf("GPGPU-Sim uArch: ERROR ** could not create kernel stats file \"%s\"\n", m_path.c_str());
+      abort();
+   }
+   printf("GPGPU-Sim uArch: writing per-kernel stats to \"%s\"\n", m_path.c_str());
+}
+
+void kernel_stats_writer::kernel_finished( unsigned uid )
+{
+   if( m_names.count(uid) )
+      m_finished.push_back(uid);
+}
+
+void kernel_stats_writer::take_finished( std::vector<std::pair<unsigned,std::string> > &kernels )
+{
+   kernels.clear();
+   for( unsigned k=0; k < m_finished.size(); k++ ) {
+      std::map<unsigned,std::string>::iterator n = m_names.find(m_finished[k]);
+      kernels.push_back(std::make_pair(n->first,n->second));
+      m_names.erase(n);
+   }
+   m_finished.clear();
+}
+
+void kernel_stats_writer::add( const char *key, const std::string &json, const std::string &csv )
+{
+   if( !m_header_written )
+      m_keys.push_back(key);
+   else
+      assert( m_values.size() < m_keys.size() && m_keys[m_values.size()] == key );
+   m_values.push_back(m_csv? csv : json);
+}
+
+void kernel_stats_writer::field( const char *key, unsigned long long value )
+{
+   char buf[32];
+   snprintf(buf,sizeof(buf),"%llu",value);
+   add(key,buf,buf);
+}
+
+void kernel_stats_writer::field( const char *key, double value )
+{
+   char buf[32];
+   snprintf(buf,sizeof(buf),"%.6g",value);
+   add(key,buf,buf);
+}
+
+void kernel_stats_writer::field( const char *key, const std::string &value )
+{
+   std::string json = "\"";
+   std::string csv = "\"";
+   for( unsigned i=0; i < value.size(); i++ ) {
+      char c = value[i];
+      if( c == '"' || c == '\\' )
+         json += '\\';
+      json += c;
+      if( c == '"' )
+         csv += '"';
+      csv += c;
+   }
+   add(key, json + "\"", csv + "\"");
+}
+
+void kernel_stats_writer::end()
+{
+   if( !m_fp )
+      open();
+   if( m_csv && !m_header_written ) {
+      for( unsigned i=0; i < m_keys.size(); i++ )
+         fprintf(m_fp, "%s%s", i? "," : "", m_keys[i].c_str());
+      fprintf(m_fp, "\n");
+   }
+   m_header_written = true;
+   assert( m_values.size() == m_keys.size() );
+   if( m_csv ) {
+      for( unsigned i=0; i < m_values.size(); i++ )
+         fprintf(m_fp, "%s%s", i? "," : "", m_values[i].c_str());
+      fprintf(m_fp, "\n");
+   } else {
+      fprintf(m_fp, "{");
+      for( unsigned i=0; i < m_values.size(); i++ )
+         fprintf(m_fp, "%s\"%s\":%s", i? "," : "", m_keys[i].c_str(), m_values[i].c_str());
+      fprintf(m_fp, "}\n");
+   }
+   m_values.clear();
+   if( fflush(m_fp) ) {
+      printf("GPGPU-Sim uArch: ERROR ** could not write kernel stats file \"%s\"\n", m_path.c_str());
+      abort();
+   }
+}
+
+void gpgpu_sim::kernel_stats_point( unsigned n )
+{
+   if( m_kernel_stats )
+      m_kernel_stats->set_point(n);
+}
+
+void gpgpu_sim::take_stats_snapshot( kernel_stats_snapshot_t &s ) const
+{
+   s.cycle = gpu_tot_sim_cycle;
+   s.insn = gpu_tot_sim_insn;
+   for( unsigned i=0; i < m_config.num_cluster(); i++ )
+      m_cluster[i]->get_cache_stats(s.l1);
+
+   const memory_config *config = &m_memory_config->memory_config_array[0];
+   unsigned per_channel = config->m_n_sub_partition_per_memory_channel;
+   for( unsigned i=0; i < m_memory_config->m_n_mem; i++ ) {
+      unsigned tier = (i >= config->m_n_mem)? 1 : 0;
+      unsigned cmd, activity, nop, act, pre, rd, wr, req;
+      m_memory_partition_unit[i]->set_dram_power_stats(cmd,activity,nop,act,pre,rd,wr,req);
+      s.dram_rd[tier] += rd;
+      s.dram_wr[tier] += wr;
+      s.dram_act[tier] += act;
+      s.dram_req[tier] += req;
+      for( unsigned p=0; p < per_channel; p++ )
+         m_memory_sub_partition[i*per_channel+p]->accumulate_L2cache_stats(s.l2[tier]);
+   }
+
+   for( unsigned t=0; t < m_memory_config->m_n_mem_types && t < KSTAT_TIERS; t++ ) {
+      const memory_stats_t *ms = m_memory_stats[t];
+      const unsigned *table[N_KSTAT_LAT] = { ms->mf_lat_table, ms->mrq_lat_table, ms->dq_lat_table,
+                                             ms->icnt2mem_lat_table, ms->icnt2sh_lat_table };
+      for( unsigned l=0; l < N_KSTAT_LAT; l++ )
+         for( unsigned b=0; b < g_lat_buckets[l]; b++ )
+            s.lat[t][l][b] = table[l][b];
+   }
+   s.page_blocking_stall = pageBlockingStall;
+}
+
+// called at a kernel boundary, after update_stats()
+void gpgpu_sim::export_kernel_stats()
+{
+   if( !m_kernel_stats )
+      return;
+   std::vector<std::pair<unsigned,std::string> > kernels;
+   m_kernel_stats->take_finished(kernels);
+   if( kernels.empty() )
+      return;
+
+   kernel_stats_snapshot_t now;
+   take_stats_snapshot(now);
+   const kernel_stats_snapshot_t &last = m_kernel_stats->last();
+   unsigned long long cycles = now.cycle - last.cycle;
+   unsigned long long insn = now.insn - last.insn;
+
+   // page migrations completed in the interval
+   unsigned long long n_migrations = 0, migration_lat = 0, migration_lat_max = 0;
+   std::map<unsigned long long, std::array<unsigned long long, 10> >::const_iterator p;
+   for( p=migrationFinished.begin(); p != migrationFinished.end(); ++p ) {
+      unsigned long long marked = p->second[0], done = p->second[3];
+      if( done <= last.cycle || done > now.cycle )
+         continue;
+      n_migrations++;
+      unsigned long long lat = (marked && done >= marked)? done - marked : 0;
+      migration_lat += lat;
+      if( lat > migration_lat_max )
+         migration_lat_max = lat;
+   }
+
+   unsigned interval = m_kernel_stats->next_interval();
+   char key[128];
+   for( unsigned k=0; k < kernels.size(); k++ ) {
+      kernel_stats_writer &w = *m_kernel_stats;
+      kernel_sample_t attributed = kernel_counters(kernels[k].first);
+      w.field("interval", (unsigned long long)interval);
+      w.field("kernel_uid", (unsigned long long)kernels[k].first);
+      w.field("kernel_name", kernels[k].second);
+      w.field("kernel_dram_req_sddr", attributed.metric[SAMPLE_DRAM_REQ_SDDR]);
+      w.field("kernel_dram_req_hbm", attributed.metric[SAMPLE_DRAM_REQ_HBM]);
+      w.field("kernel_migrations_queued", attributed.metric[SAMPLE_MIGRATIONS]);
+      w.field("concurrent_kernels", (unsigned long long)kernels.size());
+      w.field("cycle_start", last.cycle);
+      w.field("cycles", cycles);
+      w.field("instructions", insn);
+      w.field("ipc", cycles? (double)insn / cycles : 0.0);
+
+      for( unsigned c=0; c < 1+KSTAT_TIERS; c++ ) {
+         const cache_stats &cur = c? now.l2[c-1] : now.l1;
+         const cache_stats &prev = c? last.l2[c-1] : last.l1;
+         for( unsigned type=0; type < NUM_MEM_ACCESS_TYPE; type++ ) {
+            for( unsigned status=0; status < NUM_CACHE_REQUEST_STATUS; status++ ) {
+               snprintf(key, sizeof(key), "%s%s.%s.%s", c? "l2_" : "l1", c? g_tier_name[c-1] : "",
+                        mem_access_type_str((enum mem_access_type)type),
+                        cache_request_status_str((enum cache_request_status)status));
+               w.field(key, (unsigned long long)(cur(type,status) - prev(type,status)));
+            }
+         }
+      }
+
+      for( unsigned t=0; t < KSTAT_TIERS; t++ ) {
+         unsigned long long rd = now.dram_rd[t] - last.dram_rd[t];
+         unsigned long long wr = now.dram_wr[t] - last.dram_wr[t];
+         unsigned long long act = now.dram_act[t] - last.dram_act[t];
+         unsigned long long bytes = (rd + wr) * m_memory_config->memory_config_array[t].dram_atom_size;
+         // every column command that did not need an activate hit the open row
+         unsigned long long hits = (rd + wr > act)? rd + wr - act : 0;
+         const char *tier = g_tier_name[t];
+         snprintf(key, sizeof(key), "dram_%s.requests", tier);
+         w.field(key, now.dram_req[t] - last.dram_req[t]);
+         snprintf(key, sizeof(key), "dram_%s.reads", tier);
+         w.field(key, rd);
+         snprintf(key, sizeof(key), "dram_%s.writes", tier);
+         w.field(key, wr);
+         snprintf(key, sizeof(key), "dram_%s.activates", tier);
+         w.field(key, act);
+         snprintf(key, sizeof(key), "dram_%s.bytes", tier);
+         w.field(key, bytes);
+         snprintf(key, sizeof(key), "dram_%s.bytes_per_cycle", tier);
+         w.field(key, cycles? (double)bytes / cycles : 0.0);
+         snprintf(key, sizeof(key), "dram_%s.row_buffer_hit_rate", tier);
+         w.field(key, (rd + wr)? (double)hits / (rd + wr) : 0.0);
+      }
+
+      // only filled with -gpgpu_memlatency_stat
+      for( unsigned t=0; t < KSTAT_TIERS; t++ ) {
+         for( unsigned l=0; l < N_KSTAT_LAT; l++ ) {
+            for( unsigned b=0; b < g_lat_buckets[l]; b++ ) {
+               snprintf(key, sizeof(key), "lat_%s.%s.%u", g_tier_name[t], g_lat_name[l], b);
+               w.field(key, now.lat[t][l][b] - last.lat[t][l][b]);
+            }
+         }
+      }
+
+      w.field("migrations_completed", n_migrations);
+      w.field("migration_latency_avg", n_migrations? (double)migration_lat / n_migrations : 0.0);
+      w.field("migration_latency_max", migration_lat_max);
+      w.field("page_blocking_stall", now.page_blocking_stall - last.page_blocking_stall);
+      w.end();
+   }
+   m_kernel_stats->set_last(now);
+}
@@ -0,0 +1,98 @@
+#ifndef KERNEL_STATS_H
+#define KERNEL_STATS_H
+
+/*
+ * Machine-readable per-kernel counters (-gpgpu_kernel_stats <file>).
+ *
+ * At every kernel boundary (the GPU has drained) one record per kernel
+ * finished since the last boundary is appended to the file and flushed, so
+ * the file can be read while the simulation runs. Files ending in ".csv"
+ * get a header line and one comma separated row per record; any other name
+ * gets JSON lines, one flat object per record with the same keys in the
+ * same order.
+ *
+ * Except for the kernel_* fields, the counters are deltas over the interval
+ * since the previous boundary. Kernels that ran concurrently share their
+ * interval: their records repeat its counters and carry the same interval
+ * number, while kernel_dram_req_* and kernel_migrations_queued are
+ * attributed to each kernel by the memory partitions.
+ */
+
+#include <stdio.h>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gpu-cache.h"
+
+// latency histograms of memory_stats_t, log2 buckets
+enum kernel_stats_lat_t {
+   KSTAT_LAT_MF = 0,   // request issue to reply
+   KSTAT_LAT_MRQ,      // DRAM request queue
+   KSTAT_LAT_DQ,       // DRAM data queue
+   KSTAT_LAT_ICNT2MEM, // core to memory partition
+   KSTAT_LAT_ICNT2SH,  // memory partition to core
+   N_KSTAT_LAT
+};
+#define KSTAT_LAT_BUCKETS 32
+#define KSTAT_TIERS 2 // SDDR, HBM
+
+// cumulative counters at a kernel boundary
+struct kernel_stats_snapshot_t {
+   kernel_stats_snapshot_t();
+
+   unsigned long long cycle;
+   unsigned long long insn;
+   cache_stats l1;
+   cache_stats l2[KSTAT_TIERS];
+   unsigned long long dram_rd[KSTAT_TIERS];  // column commands, dram_atom_size bytes each
+   unsigned long long dram_wr[KSTAT_TIERS];
+   unsigned long long dram_act[KSTAT_TIERS];
+   unsigned long long dram_req[KSTAT_TIERS];
+   unsigned long long lat[KSTAT_TIERS][N_KSTAT_LAT][KSTAT_LAT_BUCKETS];
+   unsigned long long page_blocking_stall;
+};
+
+class kernel_stats_writer {
+public:
+   kernel_stats_writer( const char *path );
+   ~kernel_stats_writer();
+
+   // sweep point n writes <name>.<n><extension>
+   void set_point( unsigned n );
+
+   void kernel_launched( unsigned uid, const std::string &name ) { m_names[uid] = name; }
+   void kernel_finished( unsigned uid );
+   // the finished kernels since the last call, with their names; kernels
+   // that were never launched on the timing model are left out
+   void take_finished( std::vector<std::pair<unsigned,std::string> > &kernels );
+
+   const kernel_stats_snapshot_t &last() const { return m_last; }
+   void set_last( const kernel_stats_snapshot_t &s ) { m_last = s; }
+   unsigned next_interval() { return m_interval++; }
+
+   // one record: field() in the same order for every record, then end()
+   void field( const char *key, unsigned long long value );
+   void field( const char *key, double value );
+   void field( const char *key, const std::string &value );
+   void end();
+
+private:
+   void open();
+   void add( const char *key, const std::string &json, const std::string &csv );
+
+   std::string m_path;
+   bool m_csv;
+   FILE *m_fp;
+   bool m_header_written;
+   std::vector<std::string> m_keys;
+   std::vector<std::string> m_values;
+
+   std::map<unsigned,std::string> m_names;
+   std::vector<unsigned> m_finished;
+   kernel_stats_snapshot_t m_last;
+   unsigned m_interval;
+};
+
+#endif
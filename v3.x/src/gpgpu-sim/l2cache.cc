@@ -59,13 +59,15 @@ mem_fetch * partition_mf_allocator::alloc(new_addr_type addr, mem_access_type ty
                                    -1,
                                    m_memory_config );
         //TODO: for debugging: delete this
-        unsigned global_spid = mf->get_sub_partition_id(); 
-        const memory_config* config = mf->get_mem_config();
-//        assert(config == m_memory_config);
-        if (config->type == 2 && (global_spid < config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition))
-            printf("global_spid: %d, addr: %lld\n", global_spid, mf->get_addr());
-        if (config->type == 2) assert(global_spid >= config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition);
-        if (config->type == 1) assert(global_spid < config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition);
+        if (!mf->setup_pending()) { // decoded when the L2 step is committed
+            unsigned global_spid = mf->get_sub_partition_id(); 
+            const memory_config* config = mf->get_mem_config();
+//            assert(config == m_memory_config);
+            if (config->type == 2 && (global_spid < config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition))
+                printf("global_spid: %d, addr: %lld\n", global_spid, mf->get_addr());
+            if (config->type == 2) assert(global_spid >= config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition);
+            if (config->type == 1) assert(global_spid < config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition);
+        }
 
     return mf;
 }
@@ -211,6 +213,50 @@ int memory_partition_unit::global_sub_partition_id_to_local_id(int global_sub_pa
     return (global_sub_partition_id - m_id * m_config->m_n_sub_partition_per_memory_channel); 
 }
 
+// Per page access counters (per epoch and in total) that drive migration
+void memory_partition_unit::count_page_access( new_addr_type addr, const addrdec_t &tlx )
+{
+    // Add uniques addresses to the cacheline tracking data structure
+    // If address is not present then add 0 accesses for all
+    // previous epochs and also current
+    unsigned long long int cacheline = addr & ~(4095ULL);
+
+    // number of epochs this address was not accessed
+    int diff = 0;
+    // check if an element already exists
+    if (num_access_per_cacheline.count(cacheline))
+        diff = *m_epoch_number - (num_access_per_cacheline[cacheline].size() - 4);
+    else {
+        diff = *m_epoch_number;
+
+        // Store the address decoding at dram level in the map
+        num_access_per_cacheline[cacheline].push_back(tlx.bk);
+        num_access_per_cacheline[cacheline].push_back(tlx.row);
+        num_access_per_cacheline[cacheline].push_back(tlx.col);
+        // To store the sum of accesses in all epochs
+        num_access_per_cacheline[cacheline].push_back(0);
+    }
+
+
+    // push 0(s) for all the epochs till now
+    for (unsigned int i = 0; i < (diff+1); ++i) {
+        num_access_per_cacheline[cacheline].push_back(0);
+        // updated only once per epoch
+        //if (i == diff)
+        //    reuse_distance_across_epoch[cacheline].push_back(gpu_tot_sim_cycle + gpu_sim_cycle);
+    }
+    // Increment the acccesses per epoch
+    num_access_per_cacheline[cacheline][*m_epoch_number+4] += 1;
+    
+    // Total number of accesses, summing all the epochs
+    num_access_per_cacheline[cacheline][3] += 1;
+
+    // profile the cudaMalloc call
+    if(pageToMallocId.count(cacheline)) {
+        mallocAccesses[pageToMallocId[cacheline]] += 1;
+    }
+}
+
 void memory_partition_unit::dram_cycle() 
 { 
     // pop completed memory request from dram and push it to dram-to-L2 queue 
@@ -273,46 +319,9 @@ void memory_partition_unit::dram_cycle()
                 d.ready_cycle = gpu_sim_cycle+gpu_tot_sim_cycle + m_config->dram_latency;
                 m_dram_latency_queue.push_back(d);
 
-                // Add uniques addresses to the cacheline tracking data structure
-                // If address is not present then add 0 accesses for all
-                // previous epochs and also current
                 unsigned long long int cacheline = (mf->get_addr()) & ~(4095ULL);
-
-                // number of epochs this address was not accessed
-                int diff = 0;
-                // check if an element already exists
-                if (num_access_per_cacheline.count(cacheline))
-                    diff = *m_epoch_number - (num_access_per_cacheline[cacheline].size() - 4);
-                else {
-                    diff = *m_epoch_number;
-
-                    // Store the address decoding at dram level in the map
-                    const addrdec_t &tlx = mf->get_tlx_addr();
-                    num_access_per_cacheline[cacheline].push_back(tlx.bk);
-                    num_access_per_cacheline[cacheline].push_back(tlx.row);
-                    num_access_per_cacheline[cacheline].push_back(tlx.col);
-                    // To store the sum of accesses in all epochs
-                    num_access_per_cacheline[cacheline].push_back(0);
-                }
-
-
-                // push 0(s) for all the epochs till now
-                for (unsigned int i = 0; i < (diff+1); ++i) {
-                    num_access_per_cacheline[cacheline].push_back(0);
-                    // updated only once per epoch
-                    //if (i == diff)
-                    //    reuse_distance_across_epoch[cacheline].push_back(gpu_tot_sim_cycle + gpu_sim_cycle);
-                }
-                // Increment the acccesses per epoch
-                num_access_per_cacheline[cacheline][*m_epoch_number+4] += 1;
-                
-                // Total number of accesses, summing all the epochs
-                num_access_per_cacheline[cacheline][3] += 1;
-
-                // profile the cudaMalloc call
-                if(pageToMallocId.count(cacheline)) {
-                    mallocAccesses[pageToMallocId[cacheline]] += 1;
-                }
+                count_page_access(mf->get_addr(), mf->get_tlx_addr());
+                m_kernel_dram_req[mf->get_kernel_uid()]++;
 
                 if (num_access_per_cacheline[cacheline][3] == 1) {
                     if (mf->get_sub_partition_id() < 8)
@@ -390,6 +399,8 @@ void memory_partition_unit::dram_cycle()
                             count++;
                         }
                     }
+                    if (count)
+                        m_kernel_migrations[mf->get_kernel_uid()] += count;
                 }
 
                 // update last access re-use distance stats
@@ -590,6 +601,7 @@ memory_sub_partition::memory_sub_partition( unsigned sub_partition_id,
     m_dram_L2_queue = new fifo_pipeline<mem_fetch>("dram-to-L2",0,dram_L2);
     m_L2_icnt_queue = new fifo_pipeline<mem_fetch>("L2-to-icnt",0,L2_icnt);
     wb_addr=-1;
+    m_idle_cycles=0;
 }
 
 memory_sub_partition::~memory_sub_partition()
@@ -618,8 +630,43 @@ void print_latency_breakdown_stat(mem_fetch* mf) {
     }
 }
 
+// cache_cycle() would do nothing but sample the two free L2 ports: no request
+// is waiting anywhere it looks and no page flush for migration is in progress
+bool memory_sub_partition::idle() const
+{
+    if ( !m_icnt_L2_queue->empty() || !m_dram_L2_queue->empty() || !m_rop.empty() )
+        return false;
+    if ( enableMigration && !pauseMigration && !migrationQueue.empty() && flush_on_migration_enable )
+        return false;
+    if ( !m_config->m_L2_config.disabled() )
+        return !m_L2cache->access_ready() && m_L2cache->idle();
+    return true;
+}
+
+void memory_sub_partition::sync_idle_cycles() const
+{
+    if ( m_idle_cycles && !m_config->m_L2_config.disabled() )
+        m_L2cache->skip_idle_cycles(m_idle_cycles);
+    m_idle_cycles = 0;
+}
+
 void memory_sub_partition::cache_cycle( unsigned cycle )
 {
+    cache_step(cycle);
+    cache_commit();
+}
+
+void memory_sub_partition::parallel_cache_step( unsigned cycle )
+{
+    mem_fetch::set_deferred_setup(&m_deferred_fetches);
+    cache_step(cycle);
+    mem_fetch::set_deferred_setup(NULL);
+}
+
+void memory_sub_partition::cache_step( unsigned cycle )
+{
+    sync_idle_cycles();
+
     // L2 fill responses
     if( !m_config->m_L2_config.disabled()) {
        if ( m_L2cache->access_ready() && !m_L2_icnt_queue->full() ) {
@@ -717,8 +764,7 @@ void memory_sub_partition::cache_cycle( unsigned cycle )
     if( !m_rop.empty() && (cycle >= m_rop.front().ready_cycle) && !m_icnt_L2_queue->full() ) {
         mem_fetch* mf = m_rop.front().req;
         m_rop.pop();
-        l1_wb_map.erase(mf->get_request_uid());
-        l1_wr_miss_no_wa_map.erase(mf->get_request_uid());
+        m_rop_done_uids.push_back(mf->get_request_uid());
         m_icnt_L2_queue->push(mf);
         mf->set_status(IN_PARTITION_ICNT_TO_L2_QUEUE,gpu_sim_cycle+gpu_tot_sim_cycle);
 
@@ -727,6 +773,24 @@ void memory_sub_partition::cache_cycle( unsigned cycle )
         if (mf->get_mem_config()->type == 2) assert(global_spid >= mf->get_mem_config()->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition);
         if (mf->get_mem_config()->type == 1) assert(global_spid < mf->get_mem_config()->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition);
     }
+}
+
+void memory_sub_partition::cache_commit()
+{
+    for (unsigned i=0; i < m_deferred_fetches.size(); i++) {
+        mem_fetch *mf = m_deferred_fetches[i];
+        mf->finish_setup();
+        // every L2 writeback is tracked until it reaches DRAM; see record_l2_writeback()
+        if (mf->get_access_type() == L2_WRBK_ACC)
+            l2_wb_map[mf->get_request_uid()] = mf->get_addr();
+    }
+    m_deferred_fetches.clear();
+
+    for (unsigned i=0; i < m_rop_done_uids.size(); i++) {
+        l1_wb_map.erase(m_rop_done_uids[i]);
+        l1_wr_miss_no_wa_map.erase(m_rop_done_uids[i]);
+    }
+    m_rop_done_uids.clear();
 
     if (enableMigration 
             && !pauseMigration
@@ -803,6 +867,7 @@ void memory_sub_partition::dram_L2_queue_push( class mem_fetch* mf )
 
 void memory_sub_partition::print_cache_stat(unsigned &accesses, unsigned &misses) const
 {
+    sync_idle_cycles();
     FILE *fp = stdout;
     if( !m_config->m_L2_config.disabled() )
        m_L2cache->print(fp,accesses,misses);
@@ -879,6 +944,13 @@ unsigned memory_sub_partition::flushL2()
     return 0; // L2 is read only in this version
 }
 
+bool memory_sub_partition::warm_L2( new_addr_type addr, bool write )
+{
+    if (m_config->m_L2_config.disabled())
+        return false;
+    return m_L2cache->warm(addr, gpu_sim_cycle+gpu_tot_sim_cycle, write);
+}
+
 bool memory_sub_partition::busy() const 
 {
     return !m_request_tracker.empty();
@@ -932,6 +1004,11 @@ mem_fetch* memory_sub_partition::pop()
     return mf;
 }
 
+bool memory_sub_partition::L2_icnt_queue_empty() const
+{
+    return m_L2_icnt_queue->empty();
+}
+
 mem_fetch* memory_sub_partition::top() 
 {
     mem_fetch *mf = m_L2_icnt_queue->top();
@@ -950,12 +1027,14 @@ void memory_sub_partition::set_done( mem_fetch *mf )
 }
 
 void memory_sub_partition::accumulate_L2cache_stats(class cache_stats &l2_stats) const {
+    sync_idle_cycles();
     if (!m_config->m_L2_config.disabled()) {
         l2_stats += m_L2cache->get_stats();
     }
 }
 
 void memory_sub_partition::get_L2cache_sub_stats(struct cache_sub_stats &css) const{
+    sync_idle_cycles();
     if (!m_config->m_L2_config.disabled()) {
         m_L2cache->get_sub_stats(css);
     }
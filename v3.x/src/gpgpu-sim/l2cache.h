@@ -29,6 +29,7 @@
 #define MC_PARTITION_INCLUDED
 
 #include "dram.h"
+#include "mem_fetch.h"
 #include "gpu-sim.h"
 #include "../abstract_hardware_model.h"
 
@@ -69,6 +70,9 @@ public:
 
    void set_done( mem_fetch *mf );
 
+   // page access counters updated for every request issued to DRAM
+   void count_page_access( new_addr_type addr, const addrdec_t &tlx );
+
    void visualizer_print( gzFile visualizer_file ) const;
    void print_stat( FILE *fp ) { m_dram->print_stat(fp); }
    void visualize() const { m_dram->visualize(); }
@@ -107,6 +111,12 @@ public:
     void printNumAccessToPage();
 
     unsigned getTotDramReq();
+
+    // per-kernel attribution by launch uid (0: unattributed, e.g. L2
+    // writebacks): requests issued to this channel's DRAM and pages the
+    // kernel's requests queued for migration
+    const std::map<unsigned,unsigned long long> &kernel_dram_req() const { return m_kernel_dram_req; }
+    const std::map<unsigned,unsigned long long> &kernel_migrations() const { return m_kernel_migrations; }
    
 private: 
 
@@ -156,6 +166,9 @@ private:
       class mem_fetch* req;
    };
    std::list<dram_delay_t> m_dram_latency_queue;
+
+   std::map<unsigned,unsigned long long> m_kernel_dram_req;
+   std::map<unsigned,unsigned long long> m_kernel_migrations;
 };
 
 class memory_sub_partition
@@ -169,14 +182,31 @@ public:
    bool busy() const;
 
    void cache_cycle( unsigned cycle );
+   // cache_cycle() split for -gpgpu_sim_threads: cache_step() only touches
+   // this sub partition and may run in parallel with the others,
+   // cache_commit() applies its effects on global state (the writeback maps
+   // and the flush for page migration) and runs serially in sub partition
+   // order. parallel_cache_step() is cache_step() on a worker thread: the
+   // mem_fetches it creates get their uid, page placement and DRAM address
+   // in cache_commit(), in the order a serial run would assign them.
+   void cache_step( unsigned cycle );
+   void parallel_cache_step( unsigned cycle );
+   void cache_commit();
+   // idle sub partitions are skipped in the L2 clock domain; their port
+   // statistics are brought up to date in bulk
+   bool idle() const;
+   void skip_cycle() { m_idle_cycles++; }
 
    bool full() const;
    void push( class mem_fetch* mf, unsigned long long clock_cycle );
    class mem_fetch* pop(); 
    class mem_fetch* top();
+   bool L2_icnt_queue_empty() const;
    void set_done( mem_fetch *mf );
 
    unsigned flushL2();
+   // functional warm-up of the L2 tags; true on a hit
+   bool warm_L2( new_addr_type addr, bool write );
 
    // interface to L2_dram_queue
    bool L2_dram_queue_empty() const; 
@@ -226,6 +256,11 @@ private:
 
    std::set<mem_fetch*> m_request_tracker;
 
+   mutable unsigned long long m_idle_cycles; // cache_cycle() calls skipped, not yet credited to the L2
+   std::vector<mem_fetch*> m_deferred_fetches; // created by parallel_cache_step(), set up in cache_commit()
+   std::vector<unsigned> m_rop_done_uids; // left the ROP queue in cache_step(), erased from the L1 maps in cache_commit()
+   void sync_idle_cycles() const;
+
    friend class L2interface;
 };
 
@@ -36,20 +36,42 @@ uint64_t mem_fetch::sm_next_mf_request_uid=1;
 uint64_t mem_fetch::deallocated_tot=0;
 uint64_t mem_fetch::deallocated[NUM_MEM_ACCESS_TYPE] = {0,0,0,0,0,0,0,0,0,0,0,0,0};
 uint64_t mem_fetch::allocated[NUM_MEM_ACCESS_TYPE] = {0,0,0,0,0,0,0,0,0,0,0,0,0};
+__thread std::vector<mem_fetch*> *mem_fetch::sm_deferred_setup = NULL;
+
+unsigned mem_fetch::next_request_uid()
+{
+   assert( sm_deferred_setup == NULL );
+   return sm_next_mf_request_uid++;
+}
+
+void mem_fetch::set_deferred_setup( std::vector<mem_fetch*> *pending )
+{
+   sm_deferred_setup = pending;
+}
+
+void mem_fetch::finish_setup()
+{
+   assert( m_setup_pending );
+   m_setup_pending = false;
+   m_request_uid = next_request_uid();
+   place(m_mem_config);
+}
 
 mem_fetch::mem_fetch( mem_fetch *mf,
                       const mem_access_t &access)
 {
-   m_request_uid = sm_next_mf_request_uid++;
+   m_request_uid = next_request_uid();
+   m_setup_pending = false;
    m_access = access;
     if (m_access.get_type() < NUM_MEM_ACCESS_TYPE)
-        allocated[access.get_type()]++;
+        __sync_fetch_and_add(&allocated[access.get_type()],1);
 //   m_inst = NULL;
    m_data_size = access.get_size();
    m_ctrl_size = mf->get_ctrl_size();
    m_sid = mf->get_sid();
    m_tpc = mf->get_tpc();
    m_wid = mf->get_wid();
+   m_kernel_uid = mf->get_kernel_uid();
    m_mem_config = mf->get_mem_config();
    m_raw_addr = mf->get_tlx_addr(); 
    m_partition_addr = m_mem_config->m_address_mapping.partition_address(access.get_addr());
@@ -72,15 +94,17 @@ mem_fetch::mem_fetch( const mem_access_t &access, unsigned ctrl_size, const clas
     if (access.get_addr() == 2152209376) {
         printf("break here");
     }
-   m_request_uid = sm_next_mf_request_uid++;
+   m_request_uid = next_request_uid();
+   m_setup_pending = false;
    m_access = access;
     if (m_access.get_type() < NUM_MEM_ACCESS_TYPE)
-        allocated[access.get_type()]++;
+        __sync_fetch_and_add(&allocated[access.get_type()],1);
    m_data_size = access.get_size();
    m_ctrl_size = get_ctrl_size();
    m_sid = 0; // TODO: fake id
    m_tpc = -1;
    m_wid = -1;
+   m_kernel_uid = 0;
    m_mem_config = config;
    unsigned partition_offset = type * (config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition);
    config->m_address_mapping.addrdec_tlx_hetero(access.get_addr(), &m_raw_addr, partition_offset);
@@ -96,39 +120,17 @@ mem_fetch::mem_fetch( const mem_access_t &access, unsigned ctrl_size, const clas
    if (m_mem_config->type == 1) assert(m_raw_addr.sub_partition < m_mem_config->m_memory_config_types->memory_config_array[0].m_n_mem_sub_partition);
 }
 
-mem_fetch::mem_fetch( const mem_access_t &access, 
-                      const warp_inst_t *inst,
-                      unsigned ctrl_size, 
-                      unsigned wid,
-                      unsigned sid, 
-                      unsigned tpc, 
-                      const class memory_config *config ) : request_status_vector(28, 0) 
+// Tier (0 = SDDR, 1 = HBM) of the page holding addr under the
+// -enable_addr_limit placement policy; records first-touch decisions in
+// m_map_online. Also used to warm the placement map from a functional run.
+unsigned page_placement( new_addr_type addr, const class memory_config *config )
 {
-   m_request_uid = sm_next_mf_request_uid++;
-   m_access = access;
-    if (m_access.get_type() < NUM_MEM_ACCESS_TYPE)
-        allocated[access.get_type()]++;
-   if( inst ) { 
-       m_inst = *inst;
-       assert( wid == m_inst.warp_id() );
-   }
-   m_data_size = access.get_size();
-   m_ctrl_size = ctrl_size;
-   m_sid = sid;
-   m_tpc = tpc;
-   m_wid = wid;
-
-    if (access.get_addr() == 2152209376)
-        printf("break here");
-
-   const class memory_config* config_type = config;
-   unsigned type = 0;
-//   FOR 3-level address mapping
-    unsigned long long addr_temp = access.get_addr();
-    unsigned long long line_addr_temp = (access.get_addr() & (~4095UL));
+    unsigned long long addr_temp = addr;
+    unsigned long long line_addr_temp = (addr & (~4095UL));
     srand(line_addr_temp);
     unsigned int rand_num = (rand() % 100);
     //Lookup the address in the mem_map generated by the trace
+    unsigned type = 0;
     if (config->m_memory_config_types->enable_addr_limit > 0) {
         if (config->m_memory_config_types->enable_addr_limit == 1) {
             type = (m_map[line_addr_temp]-1);
@@ -202,6 +204,65 @@ mem_fetch::mem_fetch( const mem_access_t &access,
             }
         }
         assert(type == 1 || type ==0);
+    }
+    return type;
+}
+
+mem_fetch::mem_fetch( const mem_access_t &access, 
+                      const warp_inst_t *inst,
+                      unsigned ctrl_size, 
+                      unsigned wid,
+                      unsigned sid, 
+                      unsigned tpc, 
+                      const class memory_config *config ) : request_status_vector(28, 0) 
+{
+   m_access = access;
+    if (m_access.get_type() < NUM_MEM_ACCESS_TYPE)
+        __sync_fetch_and_add(&allocated[access.get_type()],1);
+   if( inst ) { 
+       m_inst = *inst;
+       assert( wid == m_inst.warp_id() );
+   }
+   m_data_size = access.get_size();
+   m_ctrl_size = ctrl_size;
+   m_sid = sid;
+   m_tpc = tpc;
+   m_wid = wid;
+   m_kernel_uid = 0;
+   m_type = m_access.is_write()?WRITE_REQUEST:READ_REQUEST;
+   m_timestamp = gpu_sim_cycle + gpu_tot_sim_cycle;
+   m_timestamp2 = 0;
+   m_status = MEM_FETCH_INITIALIZED;
+   m_status_change = gpu_sim_cycle + gpu_tot_sim_cycle;
+
+    if (access.get_addr() == 2152209376)
+        printf("break here");
+
+   if ( sm_deferred_setup ) {
+      m_request_uid = 0;
+      m_setup_pending = true;
+      m_mem_config = config;
+      icnt_flit_size = config->icnt_flit_size;
+      memset(&m_raw_addr, 0, sizeof(m_raw_addr));
+      m_partition_addr = 0;
+      sm_deferred_setup->push_back(this);
+   } else {
+      m_request_uid = next_request_uid();
+      m_setup_pending = false;
+      place(config);
+   }
+}
+
+// page placement and DRAM address decode of the fetch
+void mem_fetch::place( const class memory_config *config )
+{
+   const mem_access_t &access = m_access;
+   const class memory_config* config_type = config;
+   unsigned type = 0;
+//   FOR 3-level address mapping
+    unsigned long long addr_temp = access.get_addr();
+    type = page_placement(addr_temp, config);
+    if (config->m_memory_config_types->enable_addr_limit > 0) {
         if (type == 0)
            config_type = &(config->m_memory_config_types->memory_config_array[0]);
         else
@@ -280,11 +341,6 @@ mem_fetch::mem_fetch( const mem_access_t &access,
 
    m_partition_addr = config_type->m_address_mapping.partition_address(addr_temp);
 //   m_partition_addr = config_type->m_address_mapping.partition_address(access.get_addr());
-   m_type = m_access.is_write()?WRITE_REQUEST:READ_REQUEST;
-   m_timestamp = gpu_sim_cycle + gpu_tot_sim_cycle;
-   m_timestamp2 = 0;
-   m_status = MEM_FETCH_INITIALIZED;
-   m_status_change = gpu_sim_cycle + gpu_tot_sim_cycle;
    m_mem_config = config_type;
    if (access.get_addr() == 2187299968) {
        printf("addr: %lld, addr_limit: %lld, config_type: %d\n", access.get_addr(), config->addr_limit, m_mem_config->type);
@@ -299,8 +355,8 @@ mem_fetch::mem_fetch( const mem_access_t &access,
 mem_fetch::~mem_fetch()
 {
     if (m_access.get_type() < NUM_MEM_ACCESS_TYPE)
-        deallocated[m_access.get_type()]++;
-    deallocated_tot++;
+        __sync_fetch_and_add(&deallocated[m_access.get_type()],1);
+    __sync_fetch_and_add(&deallocated_tot,1);
     m_status = MEM_FETCH_DELETED;
 }
 
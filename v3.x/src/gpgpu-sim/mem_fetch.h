@@ -97,6 +97,9 @@ public:
    unsigned get_sid() const { return m_sid; }
    unsigned get_tpc() const { return m_tpc; }
    unsigned get_wid() const { return m_wid; }
+   // launch uid of the kernel that issued the request, 0 if unattributed
+   unsigned get_kernel_uid() const { return m_kernel_uid; }
+   void set_kernel_uid( unsigned uid ) { m_kernel_uid = uid; }
    bool istexture() const;
    bool isconst() const;
    enum mf_type get_type() const { return m_type; }
@@ -128,12 +131,22 @@ public:
 
    static void printAllocated();
 
+   // While units are stepped in parallel (-gpgpu_sim_threads), the fetches a
+   // unit creates are only queued on its pending list (set per thread): uid,
+   // page placement and DRAM address touch global state (the uid counter,
+   // m_map_online, the C library generator). finish_setup() assigns them
+   // later in a serial pass, in creation order, as a serial run would.
+   static void set_deferred_setup( std::vector<mem_fetch*> *pending );
+   bool setup_pending() const { return m_setup_pending; }
+   void finish_setup();
+
 private:
    // request source information
    unsigned m_request_uid;
    unsigned m_sid;
    unsigned m_tpc;
    unsigned m_wid;
+   unsigned m_kernel_uid;
 
    // where is this request now?
    enum mem_fetch_status m_status;
@@ -159,6 +172,10 @@ private:
    static uint64_t deallocated_tot;
    static uint64_t allocated[NUM_MEM_ACCESS_TYPE];
    static uint64_t deallocated[NUM_MEM_ACCESS_TYPE];
+   static __thread std::vector<mem_fetch*> *sm_deferred_setup;
+   static unsigned next_request_uid();
+   void place( const class memory_config *config );
+   bool m_setup_pending;
 
    const class memory_config *m_mem_config;
    unsigned icnt_flit_size;
@@ -167,4 +184,6 @@ private:
    bool wa;
 };
 
+unsigned page_placement( new_addr_type addr, const class memory_config *config );
+
 #endif
@@ -0,0 +1,287 @@
+// Memory request trace record and replay (see mem_trace.h).
+
+#include "mem_trace.h"
+#include "mem_fetch.h"
+#include "shader.h"
+#include "gpu-sim.h"
+#include "../cuda-sim/cuda-sim.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char g_mem_trace_magic[8] = {'G','P','G','P','U','M','T','R'};
+static const unsigned g_mem_trace_version = 1;
+
+// requests read ahead of the replay, over all SMs of a kernel
+static const unsigned long long g_mem_trace_read_ahead = 65536;
+
+static std::string mem_trace_file( const std::string &prefix, unsigned kernel_uid )
+{
+   char buf[32];
+   snprintf(buf,sizeof(buf),".%u",kernel_uid);
+   return prefix + buf;
+}
+
+mem_trace_writer::mem_trace_writer( const char *prefix )
+{
+   m_prefix = prefix;
+   m_last_uid = 0;
+}
+
+mem_trace_writer::~mem_trace_writer()
+{
+   close();
+}
+
+void mem_trace_writer::record( unsigned kernel_uid, const mem_fetch *mf, unsigned long long cycle )
+{
+   if( kernel_uid )
+      m_last_uid = kernel_uid;
+   else
+      kernel_uid = m_last_uid;
+   if( !kernel_uid )
+      return;
+
+   FILE *&fp = m_files[kernel_uid];
+   if( !fp ) {
+      std::string fname = mem_trace_file(m_prefix,kernel_uid);
+      fp = fopen(fname.c_str(),"wb");
+      if( !fp ) {
+         printf("GPGPU-Sim uArch: ERROR ** could not create memory trace \"%s\"\n", fname.c_str());
+         abort();
+      }
+      fwrite(g_mem_trace_magic,sizeof(g_mem_trace_magic),1,fp);
+      fwrite(&g_mem_trace_version,sizeof(g_mem_trace_version),1,fp);
+   }
+
+   mem_trace_record_t r;
+   memset(&r,0,sizeof(r));
+   r.cycle = cycle;
+   r.addr = mf->get_addr();
+   mem_access_byte_mask_t mask = mf->get_access_byte_mask();
+   for( unsigned b=0; b < MAX_MEMORY_ACCESS_SIZE; b++ )
+      if( mask.test(b) )
+         r.byte_mask[b/64] |= 1ULL << (b%64);
+   r.sid = mf->get_sid();
+   r.type = mf->get_access_type();
+   r.write = mf->get_is_write();
+   r.size = mf->get_data_size();
+   fwrite(&r,sizeof(r),1,fp);
+}
+
+void mem_trace_writer::close()
+{
+   for( std::map<unsigned,FILE*>::iterator f=m_files.begin(); f != m_files.end(); ++f ) {
+      if( ferror(f->second) | fclose(f->second) ) {
+         printf("GPGPU-Sim uArch: ERROR ** could not write memory trace of kernel %u\n", f->first);
+         abort();
+      }
+      printf("GPGPU-Sim uArch: memory trace of kernel %u written to \"%s\"\n",
+             f->first, mem_trace_file(m_prefix,f->first).c_str());
+   }
+   m_files.clear();
+}
+
+mem_trace_replayer::mem_trace_replayer( const char *prefix, unsigned window,
+                                        const shader_core_config *shader_config,
+                                        const memory_config *mem_config,
+                                        simt_core_cluster **clusters )
+{
+   m_prefix = prefix;
+   m_window = window? window : 1;
+   m_shader_config = shader_config;
+   m_mem_config = mem_config;
+   m_cluster = clusters;
+   m_n_issued = 0;
+   m_n_replies = 0;
+   m_n_window_stalls = 0;
+   m_n_icnt_stalls = 0;
+}
+
+mem_trace_replayer::~mem_trace_replayer()
+{
+   for( std::list<kernel_state_t>::iterator k=m_kernels.begin(); k != m_kernels.end(); ++k )
+      if( k->fp )
+         fclose(k->fp);
+}
+
+void mem_trace_replayer::start( unsigned kernel_uid, unsigned long long now )
+{
+   std::string fname = mem_trace_file(m_prefix,kernel_uid);
+   FILE *fp = fopen(fname.c_str(),"rb");
+   if( !fp ) {
+      printf("GPGPU-Sim uArch: ERROR ** no memory trace \"%s\" to replay\n", fname.c_str());
+      abort();
+   }
+   char magic[sizeof(g_mem_trace_magic)];
+   unsigned version;
+   if( fread(magic,sizeof(magic),1,fp) != 1 || fread(&version,sizeof(version),1,fp) != 1
+       || memcmp(magic,g_mem_trace_magic,sizeof(magic)) || version != g_mem_trace_version ) {
+      printf("GPGPU-Sim uArch: ERROR ** \"%s\" is not a memory trace\n", fname.c_str());
+      abort();
+   }
+   m_kernels.push_back(kernel_state_t());
+   kernel_state_t &k = m_kernels.back();
+   k.uid = kernel_uid;
+   k.fp = fp;
+   k.buffered = 0;
+   k.sm.resize(m_shader_config->num_shader());
+   refill(k);
+   // each SM starts as far into the replay as it started into the recording
+   unsigned long long first = 0;
+   for( unsigned sid=0; sid < k.sm.size(); sid++ )
+      if( !k.sm[sid].pending.empty() && (!first || k.sm[sid].pending.front().cycle < first) )
+         first = k.sm[sid].pending.front().cycle;
+   for( unsigned sid=0; sid < k.sm.size(); sid++ ) {
+      k.sm[sid].last_issue = now;
+      k.sm[sid].last_trace_cycle = first;
+   }
+   printf("GPGPU-Sim uArch: replaying memory trace \"%s\"\n", fname.c_str());
+}
+
+void mem_trace_replayer::refill( kernel_state_t &k )
+{
+   if( !k.fp || k.buffered >= g_mem_trace_read_ahead/2 )
+      return;
+   mem_trace_record_t r;
+   while( k.buffered < g_mem_trace_read_ahead ) {
+      if( fread(&r,sizeof(r),1,k.fp) != 1 ) {
+         fclose(k.fp);
+         k.fp = NULL;
+         return;
+      }
+      if( r.sid >= k.sm.size() ) {
+         printf("GPGPU-Sim uArch: ERROR ** memory trace of kernel %u was recorded with more SMs (%u) than configured\n",
+                k.uid, r.sid+1);
+         abort();
+      }
+      k.sm[r.sid].pending.push_back(r);
+      k.buffered++;
+   }
+}
+
+mem_trace_replayer::kernel_state_t *mem_trace_replayer::find( unsigned uid )
+{
+   for( std::list<kernel_state_t>::iterator k=m_kernels.begin(); k != m_kernels.end(); ++k )
+      if( k->uid == uid )
+         return &*k;
+   return NULL;
+}
+
+void mem_trace_replayer::cycle( unsigned long long now, std::list<unsigned> &finished )
+{
+   // responses: one per cluster per cycle, the ejection rate of icnt_cycle()
+   for( unsigned c=0; c < m_shader_config->n_simt_clusters; c++ ) {
+      mem_fetch *mf = m_cluster[c]->replay_icnt_cycle();
+      if( !mf )
+         continue;
+      std::map<unsigned,unsigned>::iterator r = m_request_kernel.find(mf->get_request_uid());
+      assert( r != m_request_kernel.end() );
+      kernel_state_t *k = find(r->second);
+      assert( k && k->sm[mf->get_sid()].outstanding );
+      k->sm[mf->get_sid()].outstanding--;
+      m_n_replies++;
+      m_request_kernel.erase(r);
+      delete mf;
+   }
+
+   for( std::list<kernel_state_t>::iterator k=m_kernels.begin(); k != m_kernels.end(); ) {
+      refill(*k);
+      bool done = !k->fp;
+      for( unsigned sid=0; sid < k->sm.size(); sid++ ) {
+         sm_state_t &sm = k->sm[sid];
+         if( sm.outstanding )
+            done = false;
+         if( sm.pending.empty() )
+            continue;
+         done = false;
+         const mem_trace_record_t &r = sm.pending.front();
+         // the recorded think time between this SM's requests
+         if( now < sm.last_issue + (r.cycle - sm.last_trace_cycle) )
+            continue;
+         if( sm.outstanding >= m_window ) {
+            m_n_window_stalls++;
+            continue;
+         }
+         unsigned cluster = m_shader_config->sid_to_cluster(sid);
+         unsigned ctrl_size = r.write? WRITE_PACKET_SIZE : READ_PACKET_SIZE;
+         if( m_cluster[cluster]->icnt_injection_buffer_full(r.size+ctrl_size,r.write) ) {
+            m_n_icnt_stalls++;
+            continue;
+         }
+
+         mem_access_byte_mask_t mask;
+         for( unsigned b=0; b < MAX_MEMORY_ACCESS_SIZE; b++ )
+            if( r.byte_mask[b/64] & (1ULL << (b%64)) )
+               mask.set(b);
+         mem_access_t access( (mem_access_type)r.type, r.addr, r.size, r.write, active_mask_t(), mask );
+         mem_fetch *mf = new mem_fetch( access, NULL, ctrl_size, -1, sid, cluster, m_mem_config );
+         mf->set_kernel_uid(k->uid);
+         m_cluster[cluster]->icnt_inject_request_packet(mf);
+         m_n_issued++;
+
+         // writebacks are never acknowledged
+         if( r.type != L1_WRBK_ACC && r.type != L2_WRBK_ACC ) {
+            sm.outstanding++;
+            m_request_kernel[mf->get_request_uid()] = k->uid;
+         }
+         sm.last_issue = now;
+         sm.last_trace_cycle = r.cycle;
+         sm.pending.pop_front();
+         k->buffered--;
+      }
+      if( done ) {
+         printf("GPGPU-Sim uArch: memory trace of kernel %u replayed\n", k->uid);
+         finished.push_back(k->uid);
+         k = m_kernels.erase(k);
+      } else {
+         ++k;
+      }
+   }
+}
+
+void mem_trace_replayer::print_stats( FILE *fout ) const
+{
+   fprintf(fout, "mem_trace_replay_requests = %llu\n", m_n_issued);
+   fprintf(fout, "mem_trace_replay_replies = %llu\n", m_n_replies);
+   fprintf(fout, "mem_trace_replay_window_stalls = %llu\n", m_n_window_stalls);
+   fprintf(fout, "mem_trace_replay_icnt_stalls = %llu\n", m_n_icnt_stalls);
+}
+
+void mem_trace_replayer::print_deadlock( FILE *fout ) const
+{
+   fprintf(fout, "GPGPU-Sim uArch DEADLOCK:  memory trace replay: %llu requests issued, %llu replies\n",
+           m_n_issued, m_n_replies);
+   for( std::list<kernel_state_t>::const_iterator k=m_kernels.begin(); k != m_kernels.end(); ++k ) {
+      for( unsigned sid=0; sid < k->sm.size(); sid++ ) {
+         const sm_state_t &sm = k->sm[sid];
+         if( sm.outstanding || !sm.pending.empty() )
+            fprintf(fout, "GPGPU-Sim uArch DEADLOCK:  kernel %u SM %u waits for %u replies, %zu requests pending\n",
+                    k->uid, sid, sm.outstanding, sm.pending.size());
+      }
+   }
+}
+
+void gpgpu_sim::record_mem_trace( unsigned kernel_uid, const mem_fetch *mf )
+{
+   if( m_mem_trace_writer )
+      m_mem_trace_writer->record(kernel_uid, mf, gpu_sim_cycle+gpu_tot_sim_cycle);
+}
+
+void gpgpu_sim::close_mem_trace()
+{
+   if( m_mem_trace_writer && !active() )
+      m_mem_trace_writer->close();
+}
+
+void gpgpu_sim::replay_kernel( kernel_info_t &kernel )
+{
+   // data first, so host readbacks and later kernels see the results
+   gpgpu_cuda_ptx_sim_main_func(kernel, true); // does not register the kernel as finished
+   m_executed_kernel_uids.push_back(kernel.get_uid());
+   m_executed_kernel_names.push_back(kernel.name());
+   if( m_kernel_stats )
+      m_kernel_stats->kernel_launched(kernel.get_uid(), kernel.name());
+   m_mem_trace_replay->start(kernel.get_uid(), gpu_sim_cycle+gpu_tot_sim_cycle);
+}
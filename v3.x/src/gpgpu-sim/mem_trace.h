@@ -0,0 +1,111 @@
+#ifndef MEM_TRACE_H
+#define MEM_TRACE_H
+
+/*
+ * Memory-system-only simulation from a recorded request stream.
+ *
+ * -gpgpu_mem_trace_record <prefix> writes every request a cluster injects
+ * into the interconnect (the post-L1 stream: address, access type, size,
+ * byte mask, SM and issue cycle) to <prefix>.<kernel uid>.
+ *
+ * -gpgpu_mem_trace_replay <prefix> runs each kernel functionally, so memory
+ * contents stay correct for the host, and then times it from its trace
+ * instead of the SM pipelines: the requests are injected into the
+ * interconnect and go through the L2, the DRAM tiers and page migration as
+ * usual. Each SM keeps at most -gpgpu_mem_trace_window requests in flight
+ * and waits the recorded gap between its consecutive requests, so a faster
+ * memory system shortens the replay while a slower one stalls it.
+ */
+
+#include <stdio.h>
+#include <deque>
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+class mem_fetch;
+class simt_core_cluster;
+struct shader_core_config;
+struct memory_config;
+
+struct mem_trace_record_t {
+   unsigned long long cycle; // gpu_tot_sim_cycle + gpu_sim_cycle at injection
+   unsigned long long addr;
+   unsigned long long byte_mask[2];
+   unsigned sid;
+   unsigned char type;       // mem_access_type
+   unsigned char write;
+   unsigned short size;
+};
+
+class mem_trace_writer {
+public:
+   mem_trace_writer( const char *prefix );
+   ~mem_trace_writer();
+
+   void record( unsigned kernel_uid, const mem_fetch *mf, unsigned long long cycle );
+   // at a kernel boundary: every request of the finished kernels has been sent
+   void close();
+
+private:
+   std::string m_prefix;
+   std::map<unsigned,FILE*> m_files;
+   unsigned m_last_uid; // for requests injected after their core went idle
+};
+
+class mem_trace_replayer {
+public:
+   mem_trace_replayer( const char *prefix, unsigned window,
+                       const shader_core_config *shader_config,
+                       const memory_config *mem_config,
+                       simt_core_cluster **clusters );
+   ~mem_trace_replayer();
+
+   void start( unsigned kernel_uid, unsigned long long now );
+   bool busy() const { return !m_kernels.empty(); }
+   // one core clock: collects responses and injects the requests that are due;
+   // appends the uids of kernels whose trace has completed
+   void cycle( unsigned long long now, std::list<unsigned> &finished );
+
+   void print_stats( FILE *fout ) const;
+   // requests issued plus replies retired; the deadlock check watches it
+   unsigned long long progress() const { return m_n_issued + m_n_replies; }
+   // the SMs still waiting, for the deadlock report
+   void print_deadlock( FILE *fout ) const;
+
+private:
+   struct sm_state_t {
+      sm_state_t() { outstanding = 0; last_issue = 0; last_trace_cycle = 0; }
+      std::deque<mem_trace_record_t> pending;
+      unsigned outstanding;
+      unsigned long long last_issue;       // replay cycle of the last request issued
+      unsigned long long last_trace_cycle; // and its recorded cycle
+   };
+   struct kernel_state_t {
+      unsigned uid;
+      FILE *fp;
+      unsigned long long buffered;
+      std::vector<sm_state_t> sm;
+   };
+
+   void refill( kernel_state_t &k );
+   kernel_state_t *find( unsigned uid );
+
+   std::string m_prefix;
+   unsigned m_window;
+   const shader_core_config *m_shader_config;
+   const memory_config *m_mem_config;
+   simt_core_cluster **m_cluster;
+
+   std::list<kernel_state_t> m_kernels;
+   // replies are matched to the kernel that issued them by request id
+   std::map<unsigned,unsigned> m_request_kernel;
+
+   unsigned long long m_n_issued;
+   unsigned long long m_n_replies;
+   unsigned long long m_n_window_stalls;
+   unsigned long long m_n_icnt_stalls;
+};
+
+#endif
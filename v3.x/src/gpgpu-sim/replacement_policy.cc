@@ -0,0 +1,214 @@
+#include "replacement_policy.h"
+#include "gpu-cache.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+replacement_policy *replacement_policy::create( enum replacement_policy_t type,
+                                                unsigned nset, unsigned assoc,
+                                                const cache_block_t *lines,
+                                                const unsigned char *line_state )
+{
+    switch (type) {
+    case LRU:   return new lru_policy(nset,assoc,lines,line_state);
+    case FIFO:  return new fifo_policy(nset,assoc,lines,line_state);
+    case SRRIP:
+    case BRRIP:
+    case DRRIP: return new rrip_policy(type,nset,assoc,lines,line_state);
+    case SHIP:  return new ship_policy(nset,assoc,lines,line_state);
+    default:
+        printf("GPGPU-Sim uArch: ERROR ** unknown cache replacement policy %d\n", type);
+        abort();
+    }
+    return NULL;
+}
+
+bool replacement_policy::reserved( unsigned idx ) const
+{
+    return m_line_state[idx] == RESERVED;
+}
+
+/****************************************************************************/
+
+unsigned lru_policy::victim( unsigned set_index ) const
+{
+    unsigned valid_line = (unsigned)-1;
+    unsigned valid_timestamp = (unsigned)-1;
+    for (unsigned way=0; way<m_assoc; way++) {
+        unsigned index = set_index*m_assoc+way;
+        if ( reserved(index) )
+            continue;
+        if ( m_lines[index].m_last_access_time < valid_timestamp ) {
+            valid_timestamp = m_lines[index].m_last_access_time;
+            valid_line = index;
+        }
+    }
+    return valid_line;
+}
+
+unsigned fifo_policy::victim( unsigned set_index ) const
+{
+    unsigned valid_line = (unsigned)-1;
+    unsigned valid_timestamp = (unsigned)-1;
+    for (unsigned way=0; way<m_assoc; way++) {
+        unsigned index = set_index*m_assoc+way;
+        if ( reserved(index) )
+            continue;
+        if ( m_lines[index].m_alloc_time < valid_timestamp ) {
+            valid_timestamp = m_lines[index].m_alloc_time;
+            valid_line = index;
+        }
+    }
+    return valid_line;
+}
+
+/****************************************************************************/
+
+rrip_policy::rrip_policy( enum replacement_policy_t type, unsigned nset, unsigned assoc,
+                          const cache_block_t *lines, const unsigned char *line_state )
+    : replacement_policy(nset,assoc,lines,line_state)
+{
+    m_type = type;
+    m_rrpv = new unsigned char[nset*assoc];
+    for (unsigned i=0; i < nset*assoc; i++)
+        m_rrpv[i] = RRPV_MAX;
+    m_brrip_count = 0;
+    m_psel = (PSEL_MAX+1)/2;
+}
+
+rrip_policy::~rrip_policy()
+{
+    delete[] m_rrpv;
+}
+
+// Equivalent to the RRIP search loop (find an RRPV_MAX line, else age the set
+// and retry) without ageing: the first line with the largest RRPV is the one
+// that loop would find. on_insert() applies the ageing afterwards.
+unsigned rrip_policy::victim( unsigned set_index ) const
+{
+    unsigned valid_line = (unsigned)-1;
+    int max_rrpv = -1;
+    for (unsigned way=0; way<m_assoc; way++) {
+        unsigned index = set_index*m_assoc+way;
+        if ( reserved(index) )
+            continue;
+        if ( m_rrpv[index] > max_rrpv ) {
+            max_rrpv = m_rrpv[index];
+            valid_line = index;
+            if ( max_rrpv == RRPV_MAX )
+                break;
+        }
+    }
+    return valid_line;
+}
+
+void rrip_policy::on_hit( unsigned idx )
+{
+    m_rrpv[idx] = 0;
+}
+
+void rrip_policy::on_insert( unsigned idx, new_addr_type block_addr, bool replaced )
+{
+    unsigned set_index = idx / m_assoc;
+    if ( replaced ) {
+        // age the rest of the set as the search loop would have
+        unsigned char age = RRPV_MAX - m_rrpv[idx];
+        if ( age ) {
+            for (unsigned way=0; way<m_assoc; way++) {
+                unsigned index = set_index*m_assoc+way;
+                m_rrpv[index] = (m_rrpv[index] + age > RRPV_MAX)? RRPV_MAX : m_rrpv[index] + age;
+            }
+        }
+    }
+    m_rrpv[idx] = insertion_rrpv(set_index, block_addr);
+}
+
+unsigned char rrip_policy::brrip_rrpv()
+{
+    m_brrip_count = (m_brrip_count + 1) % BRRIP_LONG_INTERVAL;
+    return (m_brrip_count == 0)? RRPV_MAX - 1 : RRPV_MAX;
+}
+
+unsigned char rrip_policy::insertion_rrpv( unsigned set_index, new_addr_type block_addr )
+{
+    switch (m_type) {
+    case SRRIP:
+        return RRPV_MAX - 1;
+    case BRRIP:
+        return brrip_rrpv();
+    case DRRIP: {
+        // every insertion is a miss: leader sets vote against their own policy
+        unsigned leader = set_index % DUEL_CONSTITUENCY;
+        if ( leader == 0 ) {
+            if ( m_psel < PSEL_MAX ) m_psel++;
+            return RRPV_MAX - 1;
+        }
+        if ( leader == DUEL_CONSTITUENCY - 1 ) {
+            if ( m_psel > 0 ) m_psel--;
+            return brrip_rrpv();
+        }
+        return (m_psel > PSEL_MAX/2)? brrip_rrpv() : RRPV_MAX - 1;
+    }
+    default:
+        abort();
+    }
+    return RRPV_MAX;
+}
+
+/****************************************************************************/
+
+ship_policy::ship_policy( unsigned nset, unsigned assoc,
+                          const cache_block_t *lines, const unsigned char *line_state )
+    : rrip_policy(SRRIP,nset,assoc,lines,line_state)
+{
+    m_signature = new unsigned short[nset*assoc];
+    m_reused = new unsigned char[nset*assoc];
+    for (unsigned i=0; i < nset*assoc; i++) {
+        m_signature[i] = 0;
+        m_reused[i] = 0;
+    }
+    m_shct = new unsigned char[1U << SHCT_BITS];
+    for (unsigned i=0; i < (1U << SHCT_BITS); i++)
+        m_shct[i] = 1;
+}
+
+ship_policy::~ship_policy()
+{
+    delete[] m_signature;
+    delete[] m_reused;
+    delete[] m_shct;
+}
+
+unsigned ship_policy::signature( new_addr_type block_addr )
+{
+    new_addr_type region = block_addr >> 12;
+    return (unsigned)(region ^ (region >> SHCT_BITS) ^ (region >> (2*SHCT_BITS))) & ((1U << SHCT_BITS) - 1);
+}
+
+void ship_policy::on_hit( unsigned idx )
+{
+    rrip_policy::on_hit(idx);
+    m_reused[idx] = 1;
+    if ( m_shct[m_signature[idx]] < SHCT_MAX )
+        m_shct[m_signature[idx]]++;
+}
+
+void ship_policy::on_evict( unsigned idx )
+{
+    if ( !m_reused[idx] && m_shct[m_signature[idx]] > 0 )
+        m_shct[m_signature[idx]]--;
+}
+
+void ship_policy::on_insert( unsigned idx, new_addr_type block_addr, bool replaced )
+{
+    rrip_policy::on_insert(idx, block_addr, replaced);
+    m_signature[idx] = signature(block_addr);
+    m_reused[idx] = 0;
+}
+
+unsigned char ship_policy::insertion_rrpv( unsigned set_index, new_addr_type block_addr )
+{
+    // blocks from regions that were never re-referenced are predicted dead
+    return (m_shct[signature(block_addr)] == 0)? RRPV_MAX : RRPV_MAX - 1;
+}
@@ -0,0 +1,133 @@
+#ifndef REPLACEMENT_POLICY_H
+#define REPLACEMENT_POLICY_H
+
+/*
+ * Cache replacement policies used by tag_array.
+ *
+ * tag_array picks an INVALID way itself when one exists; the policy is only
+ * asked for a victim among the valid lines of a set. The policy sees the
+ * lines of the tag array read-only and keeps its own per-line metadata in
+ * flat arrays indexed like m_lines (set*assoc+way).
+ *
+ * Selected by the <rep> field of the cache config string:
+ *   L = LRU, F = FIFO, S = SRRIP, B = BRRIP, D = DRRIP (set dueling),
+ *   H = SHiP (signature-based hit predictor over SRRIP)
+ */
+
+#include "../abstract_hardware_model.h"
+
+struct cache_block_t;
+
+enum replacement_policy_t {
+    LRU,
+    FIFO,
+    SRRIP,
+    BRRIP,
+    DRRIP,
+    SHIP
+};
+
+class replacement_policy {
+public:
+    static replacement_policy *create( enum replacement_policy_t type,
+                                       unsigned nset, unsigned assoc,
+                                       const cache_block_t *lines,
+                                       const unsigned char *line_state );
+    virtual ~replacement_policy() {}
+
+    /// Returns the line to evict among the unreserved lines of the set,
+    /// (unsigned)-1 if none qualifies. Must not change any state.
+    virtual unsigned victim( unsigned set_index ) const = 0;
+
+    /// Line idx was accessed and hit (including hits on reserved lines)
+    virtual void on_hit( unsigned idx ) {}
+    /// Line idx holds valid data that is about to be replaced
+    virtual void on_evict( unsigned idx ) {}
+    /// Line idx was allocated for block_addr; replaced is true if it was
+    /// chosen by victim(), false if it was an invalid line
+    virtual void on_insert( unsigned idx, new_addr_type block_addr, bool replaced ) {}
+
+protected:
+    replacement_policy( unsigned nset, unsigned assoc,
+                        const cache_block_t *lines,
+                        const unsigned char *line_state )
+    : m_nset(nset), m_assoc(assoc), m_lines(lines), m_line_state(line_state) {}
+
+    bool reserved( unsigned idx ) const;
+
+    unsigned m_nset;
+    unsigned m_assoc;
+    const cache_block_t *m_lines;
+    const unsigned char *m_line_state;
+};
+
+/// Evicts the least recently accessed line (cache_block_t::m_last_access_time)
+class lru_policy : public replacement_policy {
+public:
+    lru_policy( unsigned nset, unsigned assoc, const cache_block_t *lines, const unsigned char *line_state )
+    : replacement_policy(nset,assoc,lines,line_state) {}
+    virtual unsigned victim( unsigned set_index ) const;
+};
+
+/// Evicts the oldest allocated line (cache_block_t::m_alloc_time)
+class fifo_policy : public replacement_policy {
+public:
+    fifo_policy( unsigned nset, unsigned assoc, const cache_block_t *lines, const unsigned char *line_state )
+    : replacement_policy(nset,assoc,lines,line_state) {}
+    virtual unsigned victim( unsigned set_index ) const;
+};
+
+/// Re-Reference Interval Prediction (Jaleel et al., ISCA 2010) with 2-bit
+/// re-reference prediction values (RRPV) and hit-priority promotion.
+/// SRRIP inserts with a long interval, BRRIP mostly with a distant one and
+/// DRRIP picks between the two with set dueling.
+class rrip_policy : public replacement_policy {
+public:
+    rrip_policy( enum replacement_policy_t type, unsigned nset, unsigned assoc,
+                 const cache_block_t *lines, const unsigned char *line_state );
+    virtual ~rrip_policy();
+
+    virtual unsigned victim( unsigned set_index ) const;
+    virtual void on_hit( unsigned idx );
+    virtual void on_insert( unsigned idx, new_addr_type block_addr, bool replaced );
+
+protected:
+    static const unsigned char RRPV_MAX = 3;
+    static const unsigned BRRIP_LONG_INTERVAL = 32; // 1 in 32 BRRIP insertions is long
+    static const unsigned DUEL_CONSTITUENCY = 32;   // 1 SRRIP and 1 BRRIP leader set per 32 sets
+    static const unsigned PSEL_MAX = 1023;          // 10-bit policy selector
+
+    virtual unsigned char insertion_rrpv( unsigned set_index, new_addr_type block_addr );
+    unsigned char brrip_rrpv();
+
+    enum replacement_policy_t m_type;
+    unsigned char *m_rrpv; // per line
+    unsigned m_brrip_count;
+    unsigned m_psel;
+};
+
+/// Signature-based Hit Predictor (Wu et al., MICRO 2011) on top of SRRIP.
+/// The signature is the 4KB memory region of the block (SHiP-Mem), which
+/// needs no PC and follows page migration granularity.
+class ship_policy : public rrip_policy {
+public:
+    ship_policy( unsigned nset, unsigned assoc, const cache_block_t *lines, const unsigned char *line_state );
+    virtual ~ship_policy();
+
+    virtual void on_hit( unsigned idx );
+    virtual void on_evict( unsigned idx );
+    virtual void on_insert( unsigned idx, new_addr_type block_addr, bool replaced );
+
+protected:
+    static const unsigned SHCT_BITS = 14;
+    static const unsigned char SHCT_MAX = 7; // 3-bit saturating counters
+
+    virtual unsigned char insertion_rrpv( unsigned set_index, new_addr_type block_addr );
+    static unsigned signature( new_addr_type block_addr );
+
+    unsigned short *m_signature; // per line
+    unsigned char *m_reused;     // per line
+    unsigned char *m_shct;       // signature history counter table
+};
+
+#endif
@@ -0,0 +1,316 @@
+#include "sampling.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <algorithm>
+
+// dimensions basic block vectors are projected onto before clustering (as in SimPoint)
+#define SAMPLING_DIMS 15
+#define SAMPLING_KMEANS_ITERATIONS 100
+
+static const char *g_sample_metric_name[N_SAMPLE_METRICS] = {
+   "sampled_tot_sim_cycle",
+   "sampled_dram_req_sddr",
+   "sampled_dram_req_hbm",
+   "sampled_migrations"
+};
+
+// fixed pseudo random value in [-1,1] for a (basic block, dimension) pair
+static double projection( unsigned pc, unsigned dim )
+{
+   unsigned long long x = (((unsigned long long)pc << 4) | dim) + 0x9e3779b97f4a7c15ULL;
+   x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+   x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+   x ^= x >> 31;
+   return (double)(x >> 11) / (double)(1ULL << 53) * 2.0 - 1.0;
+}
+
+static double distance2( const std::vector<double> &a, const std::vector<double> &b )
+{
+   double d = 0;
+   for (unsigned i=0; i < a.size(); i++)
+      d += (a[i]-b[i]) * (a[i]-b[i]);
+   return d;
+}
+
+kernel_sampler::kernel_sampler( int mode, const char *profile, unsigned max_clusters, unsigned per_cluster )
+{
+   m_mode = mode;
+   m_profile_name = profile;
+   m_profile = NULL;
+   m_max_clusters = max_clusters ? max_clusters : 1;
+   m_per_cluster = per_cluster ? per_cluster : 1;
+   m_n_clusters = 0;
+   if (m_mode == SAMPLING_PROFILE) {
+      m_profile = fopen(profile,"w");
+      if (!m_profile) {
+         printf("GPGPU-Sim uArch: ERROR ** could not create sampling profile \"%s\"\n", profile);
+         abort();
+      }
+      printf("GPGPU-Sim uArch: sampling profile pass, writing \"%s\"\n", profile);
+   } else if (m_mode == SAMPLING_SIMULATE) {
+      load_profile();
+      cluster();
+   } else {
+      printf("GPGPU-Sim uArch: ERROR ** unknown -gpgpu_sampling mode %d\n", mode);
+      abort();
+   }
+}
+
+kernel_sampler::~kernel_sampler()
+{
+   if (m_profile)
+      fclose(m_profile);
+}
+
+bool kernel_sampler::detailed( unsigned uid ) const
+{
+   if (m_mode != SAMPLING_SIMULATE)
+      return false;
+   return m_detailed.count(uid) || !m_uid_to_launch.count(uid);
+}
+
+// one line per launch: <uid> <kernel> <insn> <n> <pc>:<count> ... (n pairs)
+void kernel_sampler::add_profile( unsigned uid, const std::string &name, unsigned long long insn,
+                                  const std::map<unsigned,unsigned long long> &bbv )
+{
+   assert(m_profile);
+   fprintf(m_profile, "%u %s %llu %zu", uid, name.c_str(), insn, bbv.size());
+   for (std::map<unsigned,unsigned long long>::const_iterator b=bbv.begin(); b != bbv.end(); ++b)
+      fprintf(m_profile, " %u:%llu", b->first, b->second);
+   fprintf(m_profile, "\n");
+   fflush(m_profile);
+}
+
+void kernel_sampler::load_profile()
+{
+   FILE *fp = fopen(m_profile_name.c_str(),"r");
+   if (!fp) {
+      printf("GPGPU-Sim uArch: ERROR ** could not open sampling profile \"%s\" (run with -gpgpu_sampling 1 first)\n",
+             m_profile_name.c_str());
+      abort();
+   }
+   static char name[4096];
+   launch_t l;
+   size_t nbb;
+   while (fscanf(fp, "%u %4095s %llu %zu", &l.uid, name, &l.insn, &nbb) == 4) {
+      l.name = name;
+      l.point.assign(SAMPLING_DIMS,0.0);
+      l.cluster = 0;
+      std::vector<std::pair<unsigned,unsigned long long> > bbv(nbb);
+      unsigned long long total = 0;
+      for (size_t b=0; b < nbb; b++) {
+         if (fscanf(fp, " %u:%llu", &bbv[b].first, &bbv[b].second) != 2) {
+            printf("GPGPU-Sim uArch: ERROR ** malformed sampling profile \"%s\" at kernel %u\n",
+                   m_profile_name.c_str(), l.uid);
+            abort();
+         }
+         total += bbv[b].second;
+      }
+      for (size_t b=0; total && b < nbb; b++) {
+         double w = (double)bbv[b].second / total;
+         for (unsigned d=0; d < SAMPLING_DIMS; d++)
+            l.point[d] += w * projection(bbv[b].first, d);
+      }
+      m_uid_to_launch[l.uid] = m_launches.size();
+      m_launches.push_back(l);
+   }
+   fclose(fp);
+}
+
+// Lloyd's algorithm from a k-means++ seeding; returns the sum of squared
+// distances to the centroids
+double kernel_sampler::kmeans( unsigned k, std::vector<unsigned> &assign, std::vector<std::vector<double> > &centroids ) const
+{
+   const unsigned n = m_launches.size();
+   unsigned long long lcg = 1; // fixed seed: the same profile always gives the same clusters
+   centroids.assign(1, m_launches[0].point);
+   std::vector<double> d2(n);
+   while (centroids.size() < k) {
+      double sum = 0;
+      for (unsigned i=0; i < n; i++) {
+         d2[i] = distance2(m_launches[i].point, centroids[0]);
+         for (unsigned c=1; c < centroids.size(); c++)
+            d2[i] = std::min(d2[i], distance2(m_launches[i].point, centroids[c]));
+         sum += d2[i];
+      }
+      if (sum == 0)
+         break; // fewer distinct points than k
+      lcg = lcg * 6364136223846793005ULL + 1442695040888963407ULL;
+      double pick = (double)(lcg >> 11) / (double)(1ULL << 53) * sum;
+      unsigned i = 0;
+      for (; i < n-1 && pick >= d2[i]; i++)
+         pick -= d2[i];
+      centroids.push_back(m_launches[i].point);
+   }
+
+   assign.assign(n,0);
+   double sse = 0;
+   for (unsigned iter=0; iter < SAMPLING_KMEANS_ITERATIONS; iter++) {
+      bool changed = false;
+      sse = 0;
+      for (unsigned i=0; i < n; i++) {
+         unsigned best = 0;
+         double best_d = distance2(m_launches[i].point, centroids[0]);
+         for (unsigned c=1; c < centroids.size(); c++) {
+            double d = distance2(m_launches[i].point, centroids[c]);
+            if (d < best_d) { best = c; best_d = d; }
+         }
+         if (iter == 0 || assign[i] != best) changed = true;
+         assign[i] = best;
+         sse += best_d;
+      }
+      if (!changed)
+         break;
+      std::vector<unsigned> count(centroids.size(),0);
+      for (unsigned c=0; c < centroids.size(); c++)
+         centroids[c].assign(SAMPLING_DIMS,0.0);
+      for (unsigned i=0; i < n; i++) {
+         count[assign[i]]++;
+         for (unsigned d=0; d < SAMPLING_DIMS; d++)
+            centroids[assign[i]][d] += m_launches[i].point[d];
+      }
+      for (unsigned c=0; c < centroids.size(); c++)
+         for (unsigned d=0; count[c] && d < SAMPLING_DIMS; d++)
+            centroids[c][d] /= count[c];
+   }
+   return sse;
+}
+
+// Tries k = 1..max and keeps the smallest k that gets 90% of the way from the
+// spread of a single cluster to that of the largest k (SimPoint applies the
+// same rule to the BIC score).
+void kernel_sampler::cluster()
+{
+   const unsigned n = m_launches.size();
+   if (n == 0) {
+      printf("GPGPU-Sim uArch: WARNING ** sampling profile \"%s\" is empty, simulating every kernel\n",
+             m_profile_name.c_str());
+      return;
+   }
+   const unsigned max_k = std::min(m_max_clusters, n);
+   std::vector<double> sse(max_k+1);
+   std::vector<std::vector<unsigned> > assign(max_k+1);
+   std::vector<std::vector<std::vector<double> > > centroids(max_k+1);
+   for (unsigned k=1; k <= max_k; k++)
+      sse[k] = kmeans(k, assign[k], centroids[k]);
+   unsigned k = 1;
+   while (k < max_k && sse[k] - sse[max_k] > 0.1 * (sse[1] - sse[max_k]))
+      k++;
+
+   m_n_clusters = centroids[k].size();
+   std::vector<std::vector<std::pair<double,unsigned> > > members(m_n_clusters);
+   for (unsigned i=0; i < n; i++) {
+      m_launches[i].cluster = assign[k][i];
+      double d = distance2(m_launches[i].point, centroids[k][assign[k][i]]);
+      members[assign[k][i]].push_back(std::make_pair(d,i));
+   }
+   for (unsigned c=0; c < m_n_clusters; c++) {
+      std::sort(members[c].begin(), members[c].end());
+      for (unsigned j=0; j < members[c].size() && j < m_per_cluster; j++)
+         m_detailed.insert(m_launches[members[c][j].second].uid);
+   }
+   printf("GPGPU-Sim uArch: sampling %u kernel launches in %u clusters, %zu simulated in detail\n",
+          n, m_n_clusters, m_detailed.size());
+   for (unsigned c=0; c < m_n_clusters; c++) {
+      printf("GPGPU-Sim uArch:   cluster %u: %zu launches, detailed:", c, members[c].size());
+      for (unsigned j=0; j < members[c].size() && j < m_per_cluster; j++)
+         printf(" %u", m_launches[members[c][j].second].uid);
+      printf("\n");
+   }
+   fflush(stdout);
+}
+
+void kernel_sampler::add_sample( unsigned uid, const kernel_sample_t &sample )
+{
+   if (m_uid_to_launch.count(uid))
+      m_samples[uid] = sample;
+   else
+      m_unprofiled[uid] = sample;
+}
+
+// Each cluster contributes its instruction count times the mean
+// per-instruction rate of its detailed launches. The confidence interval
+// treats those launches as a sample of the cluster (stratified sampling) and
+// can only account for clusters with two or more of them.
+void kernel_sampler::print( FILE *fout ) const
+{
+   if (m_mode != SAMPLING_SIMULATE)
+      return;
+   struct cluster_stat_t {
+      unsigned launches, samples;
+      unsigned long long insn;
+      double sum[N_SAMPLE_METRICS], sumsq[N_SAMPLE_METRICS];
+   };
+   std::vector<cluster_stat_t> cs(m_n_clusters);
+   for (unsigned c=0; c < m_n_clusters; c++) {
+      cs[c].launches = cs[c].samples = 0;
+      cs[c].insn = 0;
+      for (unsigned m=0; m < N_SAMPLE_METRICS; m++)
+         cs[c].sum[m] = cs[c].sumsq[m] = 0;
+   }
+   for (unsigned i=0; i < m_launches.size(); i++) {
+      const launch_t &l = m_launches[i];
+      cluster_stat_t &c = cs[l.cluster];
+      c.launches++;
+      c.insn += l.insn;
+      std::map<unsigned,kernel_sample_t>::const_iterator s = m_samples.find(l.uid);
+      if (s == m_samples.end() || l.insn == 0)
+         continue;
+      c.samples++;
+      for (unsigned m=0; m < N_SAMPLE_METRICS; m++) {
+         double r = (double)s->second.metric[m] / l.insn;
+         c.sum[m] += r;
+         c.sumsq[m] += r*r;
+      }
+   }
+
+   double est[N_SAMPLE_METRICS], var[N_SAMPLE_METRICS];
+   unsigned long long tot_insn = 0;
+   unsigned no_ci = 0, unsampled = 0;
+   for (unsigned m=0; m < N_SAMPLE_METRICS; m++)
+      est[m] = var[m] = 0;
+   fprintf(fout, "\n========== sampled simulation ==========\n");
+   for (unsigned c=0; c < m_n_clusters; c++) {
+      const cluster_stat_t &s = cs[c];
+      tot_insn += s.insn;
+      fprintf(fout, "sampling_cluster %u: launches = %u, insn = %llu, detailed = %u",
+              c, s.launches, s.insn, s.samples);
+      if (s.samples == 0) {
+         unsampled++;
+         fprintf(fout, " (not simulated)\n");
+         continue;
+      }
+      fprintf(fout, ", cpi = %.4f\n", s.sum[SAMPLE_CYCLES] / s.samples);
+      if (s.samples == 1 && s.launches > 1)
+         no_ci++;
+      for (unsigned m=0; m < N_SAMPLE_METRICS; m++) {
+         double mean = s.sum[m] / s.samples;
+         est[m] += mean * s.insn;
+         if (s.samples > 1 && s.samples < s.launches) {
+            double s2 = (s.sumsq[m] - s.samples*mean*mean) / (s.samples-1);
+            if (s2 < 0) s2 = 0;
+            var[m] += (double)s.insn * s.insn * s2 / s.samples * (1.0 - (double)s.samples / s.launches);
+         }
+      }
+   }
+   for (std::map<unsigned,kernel_sample_t>::const_iterator u=m_unprofiled.begin(); u != m_unprofiled.end(); ++u) {
+      tot_insn += u->second.insn;
+      for (unsigned m=0; m < N_SAMPLE_METRICS; m++)
+         est[m] += u->second.metric[m];
+   }
+   fprintf(fout, "sampling_profiled_launches = %zu\n", m_launches.size());
+   fprintf(fout, "sampling_detailed_launches = %zu\n", m_samples.size());
+   fprintf(fout, "sampling_unprofiled_launches = %zu\n", m_unprofiled.size());
+   fprintf(fout, "sampled_tot_sim_insn = %llu\n", tot_insn);
+   for (unsigned m=0; m < N_SAMPLE_METRICS; m++)
+      fprintf(fout, "%s = %.0f (+- %.0f, 95%%)\n", g_sample_metric_name[m], est[m], 1.96 * sqrt(var[m]));
+   if (est[SAMPLE_CYCLES] > 0)
+      fprintf(fout, "sampled_tot_ipc = %12.4f\n", tot_insn / est[SAMPLE_CYCLES]);
+   if (no_ci)
+      fprintf(fout, "sampling_clusters_without_ci = %u (one detailed launch; use -gpgpu_sampling_per_cluster > 1)\n", no_ci);
+   if (unsampled)
+      fprintf(fout, "sampling_clusters_not_simulated = %u (excluded from the estimates)\n", unsampled);
+   fflush(fout);
+}
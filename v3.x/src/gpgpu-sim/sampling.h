@@ -0,0 +1,92 @@
+#ifndef SAMPLING_H
+#define SAMPLING_H
+
+/*
+ * SimPoint-style sampling of kernel launches (-gpgpu_sampling).
+ *
+ * The profile pass (1) runs every launch functionally and appends its basic
+ * block vector (thread instructions executed per basic block) to the profile
+ * file. The sampled pass (2) reads that profile, projects each vector onto
+ * a few random dimensions and clusters the launches with k-means. The
+ * launches closest to each centroid are simulated in detail and every
+ * other launch runs functionally. After every detailed launch (at the
+ * kernel boundary, see gpgpu_sim::record_sample()) the estimate is printed
+ * again: cycles, DRAM requests per tier and page migrations extrapolated per
+ * cluster from the per-instruction rates of its detailed launches so far.
+ * The last estimate printed covers the whole run.
+ *
+ * Both passes must run the same program on the same input, so that kernel
+ * uids name the same launches.
+ */
+
+#include <stdio.h>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+enum sampling_mode_t {
+   SAMPLING_OFF = 0,
+   SAMPLING_PROFILE,
+   SAMPLING_SIMULATE
+};
+
+enum sample_metric_t {
+   SAMPLE_CYCLES = 0,
+   SAMPLE_DRAM_REQ_SDDR,
+   SAMPLE_DRAM_REQ_HBM,
+   SAMPLE_MIGRATIONS,
+   N_SAMPLE_METRICS
+};
+
+// what one detailed launch cost
+struct kernel_sample_t {
+   kernel_sample_t() { insn = 0; for (unsigned m=0; m < N_SAMPLE_METRICS; m++) metric[m] = 0; }
+   unsigned long long insn; // as counted by the timing model
+   unsigned long long metric[N_SAMPLE_METRICS];
+};
+
+class kernel_sampler {
+public:
+   kernel_sampler( int mode, const char *profile, unsigned max_clusters, unsigned per_cluster );
+   ~kernel_sampler();
+
+   int mode() const { return m_mode; }
+   // sampled pass: simulate this launch in detail (launches missing from the
+   // profile always are)
+   bool detailed( unsigned uid ) const;
+
+   void add_profile( unsigned uid, const std::string &name, unsigned long long insn,
+                     const std::map<unsigned,unsigned long long> &bbv );
+   void add_sample( unsigned uid, const kernel_sample_t &sample );
+
+   void print( FILE *fout ) const;
+
+private:
+   struct launch_t {
+      unsigned uid;
+      std::string name;
+      unsigned long long insn;
+      std::vector<double> point; // projected, normalized basic block vector
+      unsigned cluster;
+   };
+
+   void load_profile();
+   double kmeans( unsigned k, std::vector<unsigned> &assign, std::vector<std::vector<double> > &centroids ) const;
+   void cluster();
+
+   int m_mode;
+   std::string m_profile_name;
+   FILE *m_profile;
+   unsigned m_max_clusters;
+   unsigned m_per_cluster;
+
+   std::vector<launch_t> m_launches;
+   std::map<unsigned,unsigned> m_uid_to_launch;
+   unsigned m_n_clusters;
+   std::set<unsigned> m_detailed;                     // uids picked for detailed simulation
+   std::map<unsigned,kernel_sample_t> m_samples;      // by uid, profiled launches
+   std::map<unsigned,kernel_sample_t> m_unprofiled;   // by uid, launches not in the profile
+};
+
+#endif
@@ -31,14 +31,20 @@
 #include "shader_trace.h"
 
 
+extern unsigned g_max_regs_per_thread;
+
 //Constructor
 Scoreboard::Scoreboard( unsigned sid, unsigned n_warps )
 : longopregs()
 {
 	m_sid = sid;
+	// size the bitsets from the largest register number seen by the PTX
+	// parser so far; set_reg() widens them if a later kernel needs more
+	m_n_words = g_max_regs_per_thread / 64 + 1;
 	//Initialize size of table
-	reg_table.resize(n_warps);
-	longopregs.resize(n_warps);
+	reg_table.resize(n_warps, reg_bitset(m_n_words, 0));
+	m_pending_writes.resize(n_warps, 0);
+	longopregs.resize(n_warps, reg_bitset(m_n_words, 0));
 }
 
 // Print scoreboard contents
@@ -46,38 +52,57 @@ void Scoreboard::printContents() const
 {
 	printf("scoreboard contents (sid=%d): \n", m_sid);
 	for(unsigned i=0; i<reg_table.size(); i++) {
-		if(reg_table[i].size() == 0 ) continue;
+		if(m_pending_writes[i] == 0 ) continue;
 		printf("  wid = %2d: ", i);
-		std::set<unsigned>::const_iterator it;
-		for( it=reg_table[i].begin() ; it != reg_table[i].end(); it++ )
-			printf("%u ", *it);
+		for( unsigned w=0; w < reg_table[i].size(); w++ ) {
+			unsigned long long bits = reg_table[i][w];
+			while( bits ) {
+				printf("%u ", w*64 + __builtin_ctzll(bits));
+				bits &= bits - 1;
+			}
+		}
 		printf("\n");
 	}
 }
 
+void Scoreboard::set_reg(reg_bitset &regs, unsigned regnum)
+{
+	unsigned word = regnum / 64;
+	if( word >= m_n_words ) {
+		m_n_words = word + 1;
+		for( unsigned i=0; i < reg_table.size(); i++ ) {
+			reg_table[i].resize(m_n_words, 0);
+			longopregs[i].resize(m_n_words, 0);
+		}
+	}
+	regs[word] |= 1ULL << (regnum % 64);
+}
+
 void Scoreboard::reserveRegister(unsigned wid, unsigned regnum) 
 {
-	if( !(reg_table[wid].find(regnum) == reg_table[wid].end()) ){
+	if( test_reg(reg_table[wid], regnum) ){
 		printf("Error: trying to reserve an already reserved register (sid=%d, wid=%d, regnum=%d).", m_sid, wid, regnum);
         abort();
 	}
     SHADER_DPRINTF( SCOREBOARD,
                     "Reserved Register - warp:%d, reg: %d\n", wid, regnum );
-	reg_table[wid].insert(regnum);
+	set_reg(reg_table[wid], regnum);
+	m_pending_writes[wid]++;
 }
 
 // Unmark register as write-pending
 void Scoreboard::releaseRegister(unsigned wid, unsigned regnum) 
 {
-	if( !(reg_table[wid].find(regnum) != reg_table[wid].end()) ) 
+	if( !test_reg(reg_table[wid], regnum) ) 
         return;
     SHADER_DPRINTF( SCOREBOARD,
                     "Release register - warp:%d, reg: %d\n", wid, regnum );
-	reg_table[wid].erase(regnum);
+	clear_reg(reg_table[wid], regnum);
+	m_pending_writes[wid]--;
 }
 
 const bool Scoreboard::islongop (unsigned warp_id,unsigned regnum) {
-	return longopregs[warp_id].find(regnum) != longopregs[warp_id].end();
+	return test_reg(longopregs[warp_id], regnum);
 }
 
 void Scoreboard::reserveRegisters(const class warp_inst_t* inst) 
@@ -106,7 +131,7 @@ void Scoreboard::reserveRegisters(const class warp_inst_t* inst)
                                 "New longopreg marked - warp:%d, reg: %d\n",
                                 inst->warp_id(),
                                 inst->out[r] );
-                longopregs[inst->warp_id()].insert(inst->out[r]);
+                set_reg(longopregs[inst->warp_id()], inst->out[r]);
             }
     	}
     }
@@ -122,7 +147,7 @@ void Scoreboard::releaseRegisters(const class warp_inst_t *inst)
                             inst->warp_id(),
                             inst->out[r] );
             releaseRegister(inst->warp_id(), inst->out[r]);
-            longopregs[inst->warp_id()].erase(inst->out[r]);
+            clear_reg(longopregs[inst->warp_id()], inst->out[r]);
         }
     }
 }
@@ -135,31 +160,30 @@ void Scoreboard::releaseRegisters(const class warp_inst_t *inst)
  **/ 
 bool Scoreboard::checkCollision( unsigned wid, const class inst_t *inst ) const
 {
-	// Get list of all input and output registers
-	std::set<int> inst_regs;
-
-	if(inst->out[0] > 0) inst_regs.insert(inst->out[0]);
-	if(inst->out[1] > 0) inst_regs.insert(inst->out[1]);
-	if(inst->out[2] > 0) inst_regs.insert(inst->out[2]);
-	if(inst->out[3] > 0) inst_regs.insert(inst->out[3]);
-	if(inst->in[0] > 0) inst_regs.insert(inst->in[0]);
-	if(inst->in[1] > 0) inst_regs.insert(inst->in[1]);
-	if(inst->in[2] > 0) inst_regs.insert(inst->in[2]);
-	if(inst->in[3] > 0) inst_regs.insert(inst->in[3]);
-	if(inst->pred > 0) inst_regs.insert(inst->pred);
-	if(inst->ar1 > 0) inst_regs.insert(inst->ar1);
-	if(inst->ar2 > 0) inst_regs.insert(inst->ar2);
-
-	// Check for collision, get the intersection of reserved registers and instruction registers
-	std::set<int>::const_iterator it2;
-	for ( it2=inst_regs.begin() ; it2 != inst_regs.end(); it2++ )
-		if(reg_table[wid].find(*it2) != reg_table[wid].end()) {
+	if( m_pending_writes[wid] == 0 )
+		return false;
+
+	// registers of the instruction, precomputed at decode time
+	const inst_t::reg_mask_word *mask = inst->reg_mask;
+	unsigned n_mask = inst->n_reg_mask;
+	inst_t tmp;
+	if( !inst->reg_mask_valid ) {
+		tmp = *inst;
+		tmp.compute_reg_mask();
+		mask = tmp.reg_mask;
+		n_mask = tmp.n_reg_mask;
+	}
+
+	// Check for collision: intersect reserved registers with instruction registers
+	const reg_bitset &reserved = reg_table[wid];
+	for( unsigned w=0; w < n_mask; w++ ) {
+		if( mask[w].word < reserved.size() && (reserved[mask[w].word] & mask[w].bits) )
 			return true;
-		}
+	}
 	return false;
 }
 
 bool Scoreboard::pendingWrites(unsigned wid) const
 {
-	return !reg_table[wid].empty();
+	return m_pending_writes[wid] != 0;
 }
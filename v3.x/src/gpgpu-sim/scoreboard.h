@@ -28,7 +28,6 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <vector>
-#include <set>
 #include "assert.h"
 
 #ifndef SCOREBOARD_H_
@@ -49,16 +48,33 @@ public:
     void printContents() const;
     const bool islongop(unsigned warp_id, unsigned regnum);
 private:
+    typedef std::vector<unsigned long long> reg_bitset;
+
     void reserveRegister(unsigned wid, unsigned regnum);
     int get_sid() const { return m_sid; }
 
+    static bool test_reg(const reg_bitset &regs, unsigned regnum)
+    {
+        unsigned word = regnum / 64;
+        return word < regs.size() && ((regs[word] >> (regnum % 64)) & 1);
+    }
+    void set_reg(reg_bitset &regs, unsigned regnum);
+    static void clear_reg(reg_bitset &regs, unsigned regnum)
+    {
+        unsigned word = regnum / 64;
+        if (word < regs.size()) 
+            regs[word] &= ~(1ULL << (regnum % 64));
+    }
+
     unsigned m_sid;
 
     // keeps track of pending writes to registers
-    // indexed by warp id, reg_id => pending write count
-    std::vector< std::set<unsigned> > reg_table;
+    // indexed by warp id, one bit per register number
+    std::vector<reg_bitset> reg_table;
+    std::vector<unsigned> m_pending_writes; // number of bits set in reg_table[wid]
     //Register that depend on a long operation (global, local or tex memory)
-    std::vector< std::set<unsigned> > longopregs;
+    std::vector<reg_bitset> longopregs;
+    unsigned m_n_words; // current width of every bitset, grown on demand
 };
 
 
@@ -950,17 +950,10 @@ void scheduler_unit::cycle()
             checked++;
         }
         if ( issued ) {
-            // This might be a bit inefficient, but we need to maintain
-            // two ordered list for proper scheduler execution.
-            // We could remove the need for this loop by associating a
-            // supervised_is index with each entry in the m_next_cycle_prioritized_warps
-            // vector. For now, just run through until you find the right warp_id
-            for ( std::vector< shd_warp_t* >::const_iterator supervised_iter = m_supervised_warps.begin();
-                  supervised_iter != m_supervised_warps.end();
-                  ++supervised_iter ) {
-                if ( *iter == *supervised_iter ) {
-                    m_last_supervised_issued = supervised_iter;
-                }
+            // We need to maintain two ordered list for proper scheduler execution:
+            // find the issuing warp in m_supervised_warps through its index
+            if ( warp_id < m_supervised_index.size() && m_supervised_index[warp_id] >= 0 ) {
+                m_last_supervised_issued = m_supervised_warps.begin() + m_supervised_index[warp_id];
             }
             break;
         } 
@@ -1001,6 +994,69 @@ bool scheduler_unit::sort_warps_by_oldest_dynamic_id(shd_warp_t* lhs, shd_warp_t
     }
 }
 
+bool scheduler_unit::sort_warps_by_dynamic_id(shd_warp_t* lhs, shd_warp_t* rhs)
+{
+    if ( lhs->get_dynamic_warp_id() != rhs->get_dynamic_warp_id() ) {
+        return lhs->get_dynamic_warp_id() < rhs->get_dynamic_warp_id();
+    }
+    return lhs->get_warp_id() < rhs->get_warp_id();
+}
+
+// Dynamic warp ids only change when the core launches new warps, which also
+// advances its dynamic warp id counter: re-sort only then.
+bool scheduler_unit::update_age_order()
+{
+    unsigned stamp = m_shader->get_dynamic_warp_id_counter();
+    if ( stamp == m_age_order_stamp && m_warps_by_age.size() == m_supervised_warps.size() ) {
+        return false;
+    }
+    m_warps_by_age = m_supervised_warps;
+    std::sort( m_warps_by_age.begin(), m_warps_by_age.end(), sort_warps_by_dynamic_id );
+    m_age_order_stamp = stamp;
+    return true;
+}
+
+void scheduler_unit::order_greedy_then_oldest( unsigned num_warps_to_add )
+{
+    assert( num_warps_to_add <= m_supervised_warps.size() );
+    shd_warp_t* greedy = *m_last_supervised_issued;
+    bool resorted = update_age_order();
+
+    if ( num_warps_to_add == m_supervised_warps.size() ) {
+        // every warp is listed, so the list only changes with the greedy warp
+        // or the age order
+        if ( !resorted && greedy == m_ordered_greedy && !m_next_cycle_prioritized_warps.empty() ) {
+            return;
+        }
+        m_next_cycle_prioritized_warps.clear();
+        m_next_cycle_prioritized_warps.push_back( greedy );
+        for ( std::vector< shd_warp_t* >::const_iterator iter = m_warps_by_age.begin();
+              iter != m_warps_by_age.end(); ++iter ) {
+            if ( *iter != greedy ) {
+                m_next_cycle_prioritized_warps.push_back( *iter );
+            }
+        }
+        m_ordered_greedy = greedy;
+        return;
+    }
+
+    // limited list: the oldest num_warps_to_add warps that are able to issue
+    m_next_cycle_prioritized_warps.clear();
+    m_next_cycle_prioritized_warps.push_back( greedy );
+    m_ordered_greedy = NULL;
+    unsigned count = 0;
+    for ( std::vector< shd_warp_t* >::const_iterator iter = m_warps_by_age.begin();
+          iter != m_warps_by_age.end() && count < num_warps_to_add; ++iter ) {
+        if ( (*iter)->done_exit() || (*iter)->waiting() ) {
+            continue;
+        }
+        ++count;
+        if ( *iter != greedy ) {
+            m_next_cycle_prioritized_warps.push_back( *iter );
+        }
+    }
+}
+
 void lrr_scheduler::order_warps()
 {
     order_lrr( m_next_cycle_prioritized_warps,
@@ -1011,12 +1067,7 @@ void lrr_scheduler::order_warps()
 
 void gto_scheduler::order_warps()
 {
-    order_by_priority( m_next_cycle_prioritized_warps,
-                       m_supervised_warps,
-                       m_last_supervised_issued,
-                       m_supervised_warps.size(),
-                       ORDERING_GREEDY_THEN_PRIORITY_FUNC,
-                       scheduler_unit::sort_warps_by_oldest_dynamic_id );
+    order_greedy_then_oldest( m_supervised_warps.size() );
 }
 
 void
@@ -1026,12 +1077,10 @@ two_level_active_scheduler::do_on_warp_issued( unsigned warp_id,
 {
     scheduler_unit::do_on_warp_issued( warp_id, num_issued, prioritized_iter );
     if ( SCHEDULER_PRIORITIZATION_LRR == m_inner_level_prioritization ) {
-        std::vector< shd_warp_t* > new_active; 
-        order_lrr( new_active,
-                   m_next_cycle_prioritized_warps,
-                   prioritized_iter,
-                   m_next_cycle_prioritized_warps.size() );
-        m_next_cycle_prioritized_warps = new_active;
+        // same order as order_lrr() starting after prioritized_iter, done in place
+        std::vector< shd_warp_t* >::iterator next = m_next_cycle_prioritized_warps.begin()
+            + (prioritized_iter - m_next_cycle_prioritized_warps.begin()) + 1;
+        std::rotate( m_next_cycle_prioritized_warps.begin(), next, m_next_cycle_prioritized_warps.end() );
     } else {
         fprintf( stderr,
                  "Unimplemented m_inner_level_prioritization: %d\n",
@@ -1113,12 +1162,7 @@ swl_scheduler::swl_scheduler ( shader_core_stats* stats, shader_core_ctx* shader
 void swl_scheduler::order_warps()
 {
     if ( SCHEDULER_PRIORITIZATION_GTO == m_prioritization ) {
-        order_by_priority( m_next_cycle_prioritized_warps,
-                           m_supervised_warps,
-                           m_last_supervised_issued,
-                           MIN( m_num_warps_to_limit, m_supervised_warps.size() ),
-                           ORDERING_GREEDY_THEN_PRIORITY_FUNC,
-                           scheduler_unit::sort_warps_by_oldest_dynamic_id );
+        order_greedy_then_oldest( MIN( m_num_warps_to_limit, m_supervised_warps.size() ) );
     } else {
         fprintf(stderr, "swl_scheduler m_prioritization = %d\n", m_prioritization);
         abort();
@@ -3387,13 +3431,14 @@ unsigned simt_core_cluster::issue_block2core()
         unsigned core = (i+m_cta_issue_next_core+1)%m_config->n_simt_cores_per_cluster;
         if( m_core[core]->get_not_completed() == 0 ) {
             if( m_core[core]->get_kernel() == NULL ) {
-                kernel_info_t *k = m_gpu->select_kernel();
+                kernel_info_t *k = m_gpu->select_kernel(m_core[core]->get_sid());
                 if( k ) 
                     m_core[core]->set_kernel(k);
             }
         }
         kernel_info_t *kernel = m_core[core]->get_kernel();
-        if( kernel && !kernel->no_more_ctas_to_run() && (m_core[core]->get_n_active_cta() < m_config->max_cta(*kernel)) ) {
+        if( kernel && !kernel->no_more_ctas_to_run() && m_gpu->sm_may_run(m_core[core]->get_sid(), kernel) 
+            && (m_core[core]->get_n_active_cta() < m_config->max_cta(*kernel)) ) {
             m_core[core]->issue_block2core(*kernel);
             num_blocks_issued++;
             m_cta_issue_next_core=core; 
@@ -3452,6 +3497,10 @@ void simt_core_cluster::icnt_inject_request_packet(class mem_fetch *mf)
       packet_size = mf->get_ctrl_size(); 
    }
    m_stats->m_outgoing_traffic_stats->record_traffic(mf, packet_size); 
+   kernel_info_t *kernel = m_core[m_config->sid_to_cid(mf->get_sid())]->get_kernel();
+   m_gpu->record_mem_trace(kernel? kernel->get_uid() : 0, mf);
+   if( kernel && !mf->get_kernel_uid() ) 
+      mf->set_kernel_uid(kernel->get_uid()); // replayed requests come tagged
    unsigned destination = mf->get_sub_partition_id();
    mf->set_status(IN_ICNT_TO_MEM,gpu_sim_cycle+gpu_tot_sim_cycle);
    if (!mf->get_is_write() && !mf->isatomic())
@@ -3478,34 +3527,55 @@ void simt_core_cluster::icnt_cycle()
             // data response
             if( !m_core[cid]->ldst_unit_response_buffer_full() ) {
                 m_response_fifo.pop_front();
-                unsigned i = 0;
-                //assume only 2 different types of memory for now
-                if (mf->get_tlx_addr().sub_partition >= m_core[0]->get_mem_config()->m_n_mem_sub_partition)
-                    i = 1;
-                m_memory_stats[i]->memlatstat_read_done(mf);
+                memlatstat_read_done(mf);
                 m_core[cid]->accept_ldst_unit_response(mf);
             }
         }
     }
     if( m_response_fifo.size() < m_config->n_simt_ejection_buffer_size ) {
-        mem_fetch *mf = (mem_fetch*) ::icnt_pop(m_cluster_id);
-        if (!mf) 
-            return;
-        assert(mf->get_tpc() == m_cluster_id);
-        assert(mf->get_type() == READ_REPLY || mf->get_type() == WRITE_ACK );
-
-        // The packet size varies depending on the type of request: 
-        // - For read request and atomic request, the packet contains the data 
-        // - For write-ack, the packet only has control metadata
-        unsigned int packet_size = (mf->get_is_write())? mf->get_ctrl_size() : mf->size(); 
-        m_stats->m_incoming_traffic_stats->record_traffic(mf, packet_size); 
-        mf->set_status(IN_CLUSTER_TO_SHADER_QUEUE,gpu_sim_cycle+gpu_tot_sim_cycle);
-        //m_memory_stats->memlatstat_read_done(mf,m_shader_config->max_warps_per_shader);
-        m_response_fifo.push_back(mf);
-        m_stats->n_mem_to_simt[m_cluster_id] += mf->get_num_flits(false);
+        mem_fetch *mf = icnt_pop_response();
+        if (mf)
+            m_response_fifo.push_back(mf);
     }
 }
 
+// memory trace replay: the response is retired here instead of in a core
+mem_fetch *simt_core_cluster::replay_icnt_cycle()
+{
+    mem_fetch *mf = icnt_pop_response();
+    if( mf && mf->get_access_type() != INST_ACC_R )
+        memlatstat_read_done(mf);
+    return mf;
+}
+
+void simt_core_cluster::memlatstat_read_done( mem_fetch *mf )
+{
+    unsigned i = 0;
+    //assume only 2 different types of memory for now
+    if (mf->get_tlx_addr().sub_partition >= m_core[0]->get_mem_config()->m_n_mem_sub_partition)
+        i = 1;
+    m_memory_stats[i]->memlatstat_read_done(mf);
+}
+
+mem_fetch *simt_core_cluster::icnt_pop_response()
+{
+    mem_fetch *mf = (mem_fetch*) ::icnt_pop(m_cluster_id);
+    if (!mf) 
+        return NULL;
+    assert(mf->get_tpc() == m_cluster_id);
+    assert(mf->get_type() == READ_REPLY || mf->get_type() == WRITE_ACK );
+
+    // The packet size varies depending on the type of request: 
+    // - For read request and atomic request, the packet contains the data 
+    // - For write-ack, the packet only has control metadata
+    unsigned int packet_size = (mf->get_is_write())? mf->get_ctrl_size() : mf->size(); 
+    m_stats->m_incoming_traffic_stats->record_traffic(mf, packet_size); 
+    mf->set_status(IN_CLUSTER_TO_SHADER_QUEUE,gpu_sim_cycle+gpu_tot_sim_cycle);
+    //m_memory_stats->memlatstat_read_done(mf,m_shader_config->max_warps_per_shader);
+    m_stats->n_mem_to_simt[m_cluster_id] += mf->get_num_flits(false);
+    return mf;
+}
+
 void simt_core_cluster::get_pdom_stack_top_info( unsigned sid, unsigned tid, unsigned *pc, unsigned *rpc ) const
 {
     unsigned cid = m_config->sid_to_cid(sid);
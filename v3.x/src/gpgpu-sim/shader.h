@@ -295,9 +295,13 @@ public:
                    int id) 
         : m_supervised_warps(), m_stats(stats), m_shader(shader),
         m_scoreboard(scoreboard), m_simt_stack(simt), /*m_pipeline_reg(pipe_regs),*/ m_warp(warp),
-        m_sp_out(sp_out),m_sfu_out(sfu_out),m_mem_out(mem_out), m_id(id){}
+        m_sp_out(sp_out),m_sfu_out(sfu_out),m_mem_out(mem_out), m_id(id),
+        m_age_order_stamp((unsigned)-1), m_ordered_greedy(NULL){}
     virtual ~scheduler_unit(){}
     virtual void add_supervised_warp_id(int i) {
+        if ( m_supervised_index.size() <= (unsigned)i ) 
+            m_supervised_index.resize(i+1, -1);
+        m_supervised_index[i] = m_supervised_warps.size();
         m_supervised_warps.push_back(&warp(i));
     }
     virtual void done_adding_supervised_warps() {
@@ -337,6 +341,12 @@ public:
                             bool (*priority_func)(U lhs, U rhs) );
     static bool sort_warps_by_oldest_dynamic_id(shd_warp_t* lhs, shd_warp_t* rhs);
 
+    // Same result as order_by_priority( ..., ORDERING_GREEDY_THEN_PRIORITY_FUNC,
+    // sort_warps_by_oldest_dynamic_id ) on m_supervised_warps, without sorting
+    // every cycle: warps are kept sorted by dynamic warp id and only re-sorted
+    // when new warps are launched on the core. Warps that are waiting or done
+    // are left in place since cycle() skips them anyway.
+    void order_greedy_then_oldest( unsigned num_warps_to_add );
     // Derived classes can override this function to populate
     // m_supervised_warps with their scheduling policies
     virtual void order_warps() = 0;
@@ -348,6 +358,8 @@ protected:
     inline int get_sid() const;
 protected:
     shd_warp_t& warp(int i);
+    bool update_age_order();
+    static bool sort_warps_by_dynamic_id(shd_warp_t* lhs, shd_warp_t* rhs);
 
     // This is the prioritized warp list that is looped over each cycle to determine
     // which warp gets to issue.
@@ -359,6 +371,8 @@ protected:
     std::vector< shd_warp_t* > m_supervised_warps;
     // This is the iterator pointer to the last supervised warp you issued
     std::vector< shd_warp_t* >::const_iterator m_last_supervised_issued;
+    // warp id -> position in m_supervised_warps (-1 if not supervised)
+    std::vector< int > m_supervised_index;
     shader_core_stats *m_stats;
     shader_core_ctx* m_shader;
     // these things should become accessors: but would need a bigger rearchitect of how shader_core_ctx interacts with its parts.
@@ -371,6 +385,11 @@ protected:
     register_set* m_mem_out;
 
     int m_id;
+
+    // state of order_greedy_then_oldest()
+    std::vector< shd_warp_t* > m_warps_by_age; // m_supervised_warps, oldest dynamic warp id first
+    unsigned m_age_order_stamp;                // core's dynamic warp id counter when last sorted
+    shd_warp_t* m_ordered_greedy;              // greedy warp m_next_cycle_prioritized_warps was built for
 };
 
 class lrr_scheduler : public scheduler_unit {
@@ -1623,6 +1642,7 @@ public:
     unsigned isactive() const {if(m_n_active_cta>0) return 1; else return 0;}
     kernel_info_t *get_kernel() { return m_kernel; }
     unsigned get_sid() const {return m_sid;}
+    unsigned get_dynamic_warp_id_counter() const { return m_dynamic_warp_id; }
 
 // used by functional simulation:
     // modifiers
@@ -1883,6 +1903,7 @@ public:
 
     void core_cycle();
     void icnt_cycle();
+    mem_fetch *replay_icnt_cycle();
 
     void reinit();
     unsigned issue_block2core();
@@ -1929,6 +1950,9 @@ private:
     memory_stats_t **m_memory_stats;
     shader_core_ctx **m_core;
 
+    mem_fetch *icnt_pop_response();
+    void memlatstat_read_done( mem_fetch *mf );
+
     unsigned m_cta_issue_next_core;
     std::list<unsigned> m_core_sim_order;
     std::list<mem_fetch*> m_response_fifo;
@@ -0,0 +1,115 @@
+#include "thread_pool.h"
+
+#include <assert.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// polls of m_generation before an idle worker blocks on m_wakeup
+#define SIM_THREAD_SPIN_LIMIT 20000
+
+sim_thread_pool::sim_thread_pool( unsigned n_threads )
+{
+    assert(n_threads >= 1);
+    m_n_threads = n_threads;
+    m_fn = NULL;
+    m_arg = NULL;
+    m_n_tasks = 0;
+    m_next_task = 0;
+    m_busy_workers = 0;
+    m_generation = 0;
+    m_sleeping = 0;
+    m_exit = false;
+    pthread_mutex_init(&m_lock,NULL);
+    pthread_cond_init(&m_wakeup,NULL);
+    m_workers = new pthread_t[m_n_threads];
+    for (unsigned t=1; t < m_n_threads; t++) {
+        if ( pthread_create(&m_workers[t],NULL,worker_main,this) ) {
+            printf("GPGPU-Sim uArch: ERROR ** could not start simulation thread %u\n", t);
+            abort();
+        }
+    }
+}
+
+sim_thread_pool::~sim_thread_pool()
+{
+    m_exit = true;
+    __sync_fetch_and_add(&m_generation,1);
+    pthread_mutex_lock(&m_lock);
+    pthread_cond_broadcast(&m_wakeup);
+    pthread_mutex_unlock(&m_lock);
+    for (unsigned t=1; t < m_n_threads; t++)
+        pthread_join(m_workers[t],NULL);
+    delete[] m_workers;
+    pthread_cond_destroy(&m_wakeup);
+    pthread_mutex_destroy(&m_lock);
+}
+
+void sim_thread_pool::run( unsigned n_tasks, task_fn fn, void *arg )
+{
+    if ( m_n_threads == 1 || n_tasks <= 1 ) {
+        for (unsigned i=0; i < n_tasks; i++)
+            fn(arg,i);
+        return;
+    }
+    m_fn = fn;
+    m_arg = arg;
+    m_n_tasks = n_tasks;
+    m_next_task = 0;
+    m_busy_workers = m_n_threads - 1;
+    // the job must be visible before the new generation, and a worker going
+    // to sleep bumps m_sleeping before it last looks at m_generation
+    __sync_fetch_and_add(&m_generation,1);
+    if ( m_sleeping ) {
+        pthread_mutex_lock(&m_lock);
+        pthread_cond_broadcast(&m_wakeup);
+        pthread_mutex_unlock(&m_lock);
+    }
+    work();
+    for (unsigned spin=0; m_busy_workers; spin++) {
+        if ( spin >= SIM_THREAD_SPIN_LIMIT )
+            sched_yield();
+    }
+    __sync_synchronize();
+}
+
+void *sim_thread_pool::worker_main( void *pool )
+{
+    ((sim_thread_pool*)pool)->worker();
+    return NULL;
+}
+
+void sim_thread_pool::worker()
+{
+    unsigned seen = 0;
+    while (1) {
+        unsigned spin = 0;
+        while ( m_generation == seen && spin < SIM_THREAD_SPIN_LIMIT )
+            spin++;
+        if ( m_generation == seen ) {
+            pthread_mutex_lock(&m_lock);
+            __sync_fetch_and_add(&m_sleeping,1);
+            while ( m_generation == seen )
+                pthread_cond_wait(&m_wakeup,&m_lock);
+            __sync_fetch_and_sub(&m_sleeping,1);
+            pthread_mutex_unlock(&m_lock);
+        }
+        __sync_synchronize();
+        if ( m_exit )
+            return;
+        // run() waits for every worker before starting the next generation
+        seen = m_generation;
+        work();
+        __sync_fetch_and_sub(&m_busy_workers,1);
+    }
+}
+
+void sim_thread_pool::work()
+{
+    while (1) {
+        unsigned task = __sync_fetch_and_add(&m_next_task,1);
+        if ( task >= m_n_tasks )
+            break;
+        m_fn(m_arg,task);
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+/*
+ * Worker threads for stepping independent timing-model units of one clock
+ * domain in parallel (-gpgpu_sim_threads).
+ *
+ * run() hands out the task indices [0,n) to the workers and to the calling
+ * thread and returns once every task has finished, so a call acts as a
+ * fork/join barrier around one loop of gpgpu_sim::cycle(). Which thread runs
+ * which index is not fixed: tasks must only touch state owned by their unit
+ * and leave anything shared to a serial pass afterwards.
+ *
+ * Workers spin for a while between calls, since the loops they run are
+ * short and come every cycle, then block until the next call.
+ */
+
+#include <pthread.h>
+
+class sim_thread_pool {
+public:
+    typedef void (*task_fn)( void *arg, unsigned task );
+
+    sim_thread_pool( unsigned n_threads );
+    ~sim_thread_pool();
+
+    unsigned size() const { return m_n_threads; }
+    void run( unsigned n_tasks, task_fn fn, void *arg );
+
+private:
+    static void *worker_main( void *pool );
+    void worker();
+    void work();
+
+    unsigned m_n_threads; // including the thread calling run()
+    pthread_t *m_workers;
+
+    // current job
+    task_fn m_fn;
+    void *m_arg;
+    unsigned m_n_tasks;
+    volatile unsigned m_next_task;
+    volatile unsigned m_busy_workers;
+
+    volatile unsigned m_generation; // bumped once per run()
+    volatile unsigned m_sleeping;
+    volatile bool m_exit;
+    pthread_mutex_t m_lock;
+    pthread_cond_t m_wakeup;
+};
+
+#endif
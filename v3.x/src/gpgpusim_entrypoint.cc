@@ -43,6 +43,10 @@
 
 #include <pthread.h>
 #include <semaphore.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <map>
+#include <vector>
 
 #define MAX(a,b) (((a)>(b))?(a):(b))
 
@@ -64,6 +68,7 @@ stream_manager *g_stream_manager;
 
 static int sg_argc = 3;
 static const char *sg_argv[] = {"", "-config","gpgpusim.config"};
+static option_parser_t sg_opp; // kept to apply -gpgpu_sweep overrides
 std::map<unsigned long long, unsigned> m_map;
 std::map<unsigned long long, unsigned> m_map_online;
 unsigned long long int num_lines_hbm;
@@ -114,6 +119,7 @@ void *gpgpu_sim_thread_sequential(void*)
           g_the_gpu->print_stats();
           g_the_gpu->update_stats();
           print_simulation_time();
+          g_the_gpu->export_kernel_stats();
       }
       sem_post(&g_sim_signal_finish);
    } while(!done);
@@ -122,8 +128,9 @@ void *gpgpu_sim_thread_sequential(void*)
 }
 
 pthread_mutex_t g_sim_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t g_sim_cond = PTHREAD_COND_INITIALIZER; // g_sim_active went false
 bool g_sim_active = false;
-bool g_sim_done = true;
+volatile bool g_sim_done = true;
 
 void *gpgpu_sim_thread_concurrent(void*)
 {
@@ -133,8 +140,7 @@ void *gpgpu_sim_thread_concurrent(void*)
           printf("GPGPU-Sim: *** simulation thread starting and spinning waiting for work ***\n");
           fflush(stdout);
        }
-        while( g_stream_manager->empty_protected() && !g_sim_done )
-            ;
+        g_stream_manager->wait_for_work(&g_sim_done);
         if(g_debug_execution >= 3) {
            printf("GPGPU-Sim: ** START simulation thread (detected work) **\n");
            g_stream_manager->print(stdout);
@@ -174,10 +180,15 @@ void *gpgpu_sim_thread_concurrent(void*)
         if(sim_cycles) {
             g_the_gpu->update_stats();
             print_simulation_time();
+            g_the_gpu->save_checkpoint();
+            g_the_gpu->record_sample();
+            g_the_gpu->close_mem_trace();
+            g_the_gpu->export_kernel_stats();
             //g_stream_manager->print_final_stats();
         }
         pthread_mutex_lock(&g_sim_lock);
         g_sim_active = false;
+        pthread_cond_broadcast(&g_sim_cond);
         pthread_mutex_unlock(&g_sim_lock);
     } while( !g_sim_done );
     //g_stream_manager->print_final_stats();
@@ -195,12 +206,12 @@ void synchronize()
     g_stream_manager->print(stdout);
     fflush(stdout);
 //    sem_wait(&g_sim_signal_finish);
-    bool done = false;
-    do {
-        pthread_mutex_lock(&g_sim_lock);
-        done = g_stream_manager->empty() && !g_sim_active;
-        pthread_mutex_unlock(&g_sim_lock);
-    } while (!done);
+    // the simulation thread empties the streams while active, so it always
+    // goes inactive (and signals) after they become empty
+    pthread_mutex_lock(&g_sim_lock);
+    while( !g_stream_manager->empty_protected() || g_sim_active )
+        pthread_cond_wait(&g_sim_cond,&g_sim_lock);
+    pthread_mutex_unlock(&g_sim_lock);
     printf("GPGPU-Sim: detected inactive GPU simulation thread\n");
     fflush(stdout);
 //    sem_post(&g_sim_signal_start);
@@ -209,6 +220,7 @@ void synchronize()
 void exit_simulation()
 {
     g_sim_done=true;
+    g_stream_manager->wake();
     printf("GPGPU-Sim: exit_simulation called\n");
     fflush(stdout);
     sem_wait(&g_sim_signal_exit);
@@ -216,6 +228,198 @@ void exit_simulation()
     fflush(stdout);
 }
 
+// Parameter sweeps (-gpgpu_sweep). The host program runs once up to its first
+// kernel launch: runtime setup, PTX loading and the host-to-device copies are
+// shared. There the process forks one child per sweep point; each child
+// applies its overrides, restarts the simulation thread and runs the rest of
+// the program on its own. The parent waits for all of them, collects their
+// results into one file and exits.
+//
+// Only options read while simulating may differ between points; the others
+// have already been used to build the simulator.
+static const char *sg_sweep_options[] = {
+   "-enable_migration", "-migration_threshold", "-range_expansion", "-max_migrations",
+   "-migration_cost", "-magical_migration", "-flush_on_migration_enable",
+   "-block_on_migration", "-limit_migration_rate", "-drain_all_mshrs",
+   "-line_ratio", "-data_ratio", "-cachelines", "-page_ratio", "-pages",
+   "-gpgpu_max_cycle", "-gpgpu_max_insn", "-gpgpu_max_cta",
+   "-gpgpu_sim_threads", // read when the child starts its worker pool
+   NULL
+};
+
+static unsigned sg_sweep_point;
+static std::string sg_sweep_args;
+
+static std::string sweep_result_file( unsigned point )
+{
+   std::stringstream s;
+   s << g_the_gpu_config.sweep_output() << "." << point;
+   return s.str();
+}
+
+static std::string json_string( const std::string &str )
+{
+   std::string out = "\"";
+   for( unsigned i=0; i < str.size(); i++ ) {
+      if( str[i] == '"' || str[i] == '\\' )
+         out += '\\';
+      out += str[i];
+   }
+   return out + "\"";
+}
+
+static void read_sweep_points( const char *filename, std::vector<std::string> &points )
+{
+   std::ifstream file(filename);
+   if( !file.is_open() ) {
+      printf("GPGPU-Sim: ERROR ** cannot open sweep file \"%s\"\n", filename);
+      abort();
+   }
+   std::string line;
+   while( getline(file,line) ) {
+      size_t comment = line.find('#');
+      if( comment != std::string::npos )
+         line.erase(comment);
+      std::stringstream ss(line);
+      std::string token, args;
+      while( ss >> token ) {
+         // option names; values may be negative numbers
+         if( token.size() > 1 && token[0] == '-' && isalpha(token[1]) ) {
+            unsigned o;
+            for( o=0; sg_sweep_options[o] && token != sg_sweep_options[o]; o++ )
+               ;
+            if( !sg_sweep_options[o] ) {
+               printf("GPGPU-Sim: ERROR ** option %s cannot vary within a sweep\n", token.c_str());
+               abort();
+            }
+         }
+         args += (args.empty()? "" : " ") + token;
+      }
+      if( !args.empty() )
+         points.push_back(args);
+   }
+   if( points.empty() ) {
+      printf("GPGPU-Sim: ERROR ** sweep file \"%s\" has no points\n", filename);
+      abort();
+   }
+}
+
+// at exit of a sweep point
+static void write_sweep_result()
+{
+   kernel_sample_t c = g_the_gpu->total_counters();
+   FILE *fp = fopen(sweep_result_file(sg_sweep_point).c_str(),"w");
+   if( !fp )
+      return;
+   fprintf(fp,"{\"point\": %u, \"args\": %s, \"tot_sim_cycle\": %llu, \"tot_sim_insn\": %llu, "
+              "\"ipc\": %.4f, \"dram_req_sddr\": %llu, \"dram_req_hbm\": %llu, \"migrations\": %llu}\n",
+           sg_sweep_point, json_string(sg_sweep_args).c_str(),
+           c.metric[SAMPLE_CYCLES], c.insn,
+           c.metric[SAMPLE_CYCLES]? (double)c.insn / c.metric[SAMPLE_CYCLES] : 0.0,
+           c.metric[SAMPLE_DRAM_REQ_SDDR], c.metric[SAMPLE_DRAM_REQ_HBM], c.metric[SAMPLE_MIGRATIONS]);
+   fclose(fp);
+}
+
+static void collect_sweep_results( const std::vector<std::string> &points, const std::vector<int> &status )
+{
+   const char *output = g_the_gpu_config.sweep_output();
+   FILE *out = fopen(output,"w");
+   if( !out ) {
+      printf("GPGPU-Sim: ERROR ** cannot create sweep output \"%s\"\n", output);
+      abort();
+   }
+   for( unsigned p=0; p < points.size(); p++ ) {
+      std::string fname = sweep_result_file(p);
+      std::ifstream result(fname.c_str());
+      std::string line;
+      if( status[p] == 0 && getline(result,line) ) {
+         fprintf(out,"%s\n",line.c_str());
+      } else {
+         fprintf(out,"{\"point\": %u, \"args\": %s, \"failed\": %d}\n",
+                 p, json_string(points[p]).c_str(), status[p]);
+         printf("GPGPU-Sim: sweep point %u (%s) failed, see %s.log\n", p, points[p].c_str(), fname.c_str());
+      }
+      unlink(fname.c_str());
+   }
+   fclose(out);
+   printf("GPGPU-Sim: %u sweep points written to \"%s\"\n", (unsigned)points.size(), output);
+}
+
+void gpgpu_sweep_fork()
+{
+   static bool forked = false;
+   if( forked || !g_the_gpu_config.sweep() )
+      return;
+   forked = true;
+
+   std::vector<std::string> points;
+   read_sweep_points(g_the_gpu_config.sweep(), points);
+   unsigned jobs = g_the_gpu_config.sweep_jobs();
+   if( !jobs )
+      jobs = MAX(sysconf(_SC_NPROCESSORS_ONLN),1);
+   printf("GPGPU-Sim: forking %u sweep points, %u at a time\n", (unsigned)points.size(), jobs);
+
+   // only the calling thread survives fork(), so stop the simulation thread
+   // and the L2 stepping workers first; each child starts its own
+   synchronize();
+   exit_simulation();
+   g_the_gpu->stop_sim_threads();
+   fflush(stdout);
+   fflush(stderr);
+
+   std::map<pid_t,unsigned> running;
+   std::vector<int> status(points.size(),-1);
+   unsigned next = 0;
+   while( next < points.size() || !running.empty() ) {
+      if( next < points.size() && running.size() < jobs ) {
+         pid_t pid = fork();
+         if( pid < 0 ) {
+            perror("GPGPU-Sim: ERROR ** fork");
+            abort();
+         }
+         if( pid == 0 ) {
+            sg_sweep_point = next;
+            sg_sweep_args = points[next];
+            std::string log = sweep_result_file(next) + ".log";
+            if( !freopen(log.c_str(),"w",stdout) ) 
+               abort();
+            printf("GPGPU-Sim: sweep point %u: %s\n", next, sg_sweep_args.c_str());
+            option_parser_delimited_string(sg_opp, sg_sweep_args.c_str(), " ");
+            fprintf(stdout, "GPGPU-Sim: Configuration options:\n\n");
+            option_parser_print(sg_opp, stdout);
+            g_the_gpu->kernel_stats_point(next);
+            g_the_gpu->start_sim_threads(); // after the point's -gpgpu_sim_threads
+            atexit(write_sweep_result);
+            start_sim_thread(1);
+            return;
+         }
+         running[pid] = next++;
+         continue;
+      }
+      int st;
+      pid_t pid = waitpid(-1,&st,0);
+      if( pid < 0 ) {
+         perror("GPGPU-Sim: ERROR ** waitpid");
+         abort();
+      }
+      std::map<pid_t,unsigned>::iterator r = running.find(pid);
+      if( r == running.end() )
+         continue;
+      status[r->second] = WIFEXITED(st)? WEXITSTATUS(st) : 128 + WTERMSIG(st);
+      printf("GPGPU-Sim: sweep point %u done (status %d)\n", r->second, status[r->second]);
+      fflush(stdout);
+      running.erase(r);
+   }
+
+   collect_sweep_results(points,status);
+   bool failed = false;
+   for( unsigned p=0; p < points.size(); p++ ) 
+      failed |= (status[p] != 0);
+   fflush(stdout);
+   // the parent simulated nothing: skip the atexit statistics
+   _exit(failed? 1 : 0);
+}
+
 extern bool g_cuda_launch_blocking;
 
 void foo(void) {
@@ -234,6 +438,7 @@ gpgpu_sim *gpgpu_ptx_sim_init_perf()
    read_sim_environment_variables();
    read_parser_environment_variables();
    option_parser_t opp = option_parser_create();
+   sg_opp = opp;
 
    icnt_reg_options(opp);
    g_the_gpu_config.reg_options(opp); // register GPU microrachitecture options
@@ -37,6 +37,7 @@ extern time_t g_simulation_starttime;
 
 class gpgpu_sim *gpgpu_ptx_sim_init_perf();
 void start_sim_thread(int api);
+void gpgpu_sweep_fork();
 
 int gpgpu_opencl_ptx_sim_main_perf( kernel_info_t *grid );
 int gpgpu_opencl_ptx_sim_main_func( kernel_info_t *grid );
@@ -37,6 +37,7 @@ CUstream_st::CUstream_st()
     m_pending = false;
     m_uid = sm_next_stream_uid++;
     pthread_mutex_init(&m_lock,NULL);
+    pthread_cond_init(&m_cond,NULL);
 }
 
 bool CUstream_st::empty()
@@ -58,12 +59,10 @@ bool CUstream_st::busy()
 void CUstream_st::synchronize() 
 {
     // called by host thread
-    bool done=false;
-    do{
-        pthread_mutex_lock(&m_lock);
-        done = m_operations.empty();
-        pthread_mutex_unlock(&m_lock);
-    } while ( !done );
+    pthread_mutex_lock(&m_lock);
+    while( !m_operations.empty() )
+        pthread_cond_wait(&m_cond,&m_lock);
+    pthread_mutex_unlock(&m_lock);
 }
 
 void CUstream_st::push( const stream_operation &op )
@@ -81,6 +80,7 @@ void CUstream_st::record_next_done()
     assert(m_pending);
     m_operations.pop_front();
     m_pending=false;
+    pthread_cond_broadcast(&m_cond);
     pthread_mutex_unlock(&m_lock);
 }
 
@@ -154,8 +154,16 @@ void stream_operation::do_operation( gpgpu_sim *gpu )
         if( gpu->can_start_kernel() ) {
         	gpu->set_cache_config(m_kernel->name());
         	printf("kernel \'%s\' transfer to GPU hardware scheduler\n", m_kernel->name().c_str() );
-            if( m_sim_mode )
+            if( gpu->sampling_skips( m_kernel->get_uid() ) )
+                gpu->sample_kernel_functionally( *m_kernel );
+            else if( m_sim_mode )
                 gpgpu_cuda_ptx_sim_main_func( *m_kernel );
+            else if( gpu->restoring( m_kernel->get_uid() ) )
+                gpu->restore_kernel( *m_kernel );
+            else if( gpu->in_fast_forward() )
+                gpu->fast_forward_kernel( *m_kernel );
+            else if( gpu->replaying_mem_trace() )
+                gpu->replay_kernel( *m_kernel );
             else
                 gpu->launch( m_kernel );
         }
@@ -195,6 +203,7 @@ stream_manager::stream_manager( gpgpu_sim *gpu, bool cuda_launch_blocking )
     m_service_stream_zero = false;
     m_cuda_launch_blocking = cuda_launch_blocking;
     pthread_mutex_init(&m_lock,NULL);
+    pthread_cond_init(&m_cond,NULL);
 }
 
 bool stream_manager::operation( bool * sim)
@@ -204,6 +213,9 @@ bool stream_manager::operation( bool * sim)
 //    if(check)m_gpu->print_stats();
     stream_operation op =front();
     op.do_operation( m_gpu );
+    // every operation completes in here, either above or in check_finished_kernel()
+    if( check || !op.is_noop() )
+        pthread_cond_broadcast(&m_cond);
     pthread_mutex_unlock(&m_lock);
     //pthread_mutex_lock(&m_lock);
     // simulate a clock cycle on the GPU
@@ -284,7 +296,7 @@ void stream_manager::destroy_stream( CUstream_st *stream )
     // called by host thread
     pthread_mutex_lock(&m_lock);
     while( !stream->empty() )
-        ; 
+        pthread_cond_wait(&m_cond,&m_lock);
     std::list<CUstream_st *>::iterator s;
     for( s=m_streams.begin(); s != m_streams.end(); s++ ) {
         if( *s == stream ) {
@@ -363,13 +375,10 @@ void stream_manager::push( stream_operation op )
 
     // block if stream 0 (or concurrency disabled) and pending concurrent operations exist
     bool block= !stream || m_cuda_launch_blocking;
-    while(block) {
-        pthread_mutex_lock(&m_lock);
-        block = !concurrent_streams_empty();
-        pthread_mutex_unlock(&m_lock);
-    };
-
     pthread_mutex_lock(&m_lock);
+    while( block && !concurrent_streams_empty() )
+        pthread_cond_wait(&m_cond,&m_lock);
+
     if( stream && !m_cuda_launch_blocking ) {
         stream->push(op);
     } else {
@@ -378,18 +387,37 @@ void stream_manager::push( stream_operation op )
     }
     if(g_debug_execution >= 3)
        print_impl(stdout);
-    pthread_mutex_unlock(&m_lock);
+    pthread_cond_broadcast(&m_cond); // wakes the simulation thread
     if( m_cuda_launch_blocking || stream == NULL ) {
-        unsigned int wait_amount = 100; 
-        unsigned int wait_cap = 100000; // 100ms 
-        while( !empty() ) {
-            // sleep to prevent CPU hog by empty spin
-            // sleep time increased exponentially ensure fast response when needed 
-            usleep(wait_amount); 
-            wait_amount *= 2; 
-            if (wait_amount > wait_cap) 
-               wait_amount = wait_cap; 
-        }
+        while( !empty() ) 
+            pthread_cond_wait(&m_cond,&m_lock);
     }
+    pthread_mutex_unlock(&m_lock);
+}
+
+void stream_manager::wait_for_work( const volatile bool *done )
+{
+    pthread_mutex_lock(&m_lock);
+    while( empty() && !*done )
+        pthread_cond_wait(&m_cond,&m_lock);
+    pthread_mutex_unlock(&m_lock);
+}
+
+void stream_manager::wait_for_event( CUevent_st *e )
+{
+    // events are updated by stream_operation::do_operation() in operation()
+    pthread_mutex_lock(&m_lock);
+    while( !e->done() )
+        pthread_cond_wait(&m_cond,&m_lock);
+    pthread_mutex_unlock(&m_lock);
+}
+
+void stream_manager::wake()
+{
+    // taking the lock orders the caller's state change before any waiter's
+    // next check of it
+    pthread_mutex_lock(&m_lock);
+    pthread_cond_broadcast(&m_cond);
+    pthread_mutex_unlock(&m_lock);
 }
 
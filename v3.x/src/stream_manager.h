@@ -230,6 +230,7 @@ private:
     bool m_pending; // front operation has started but not yet completed
 
     pthread_mutex_t m_lock; // ensure only one host or gpu manipulates stream operation at one time
+    pthread_cond_t m_cond;  // signaled when an operation completes
 };
 
 class stream_manager {
@@ -247,6 +248,11 @@ public:
     void print( FILE *fp);
     void push( stream_operation op );
     bool operation(bool * sim);
+
+    // blocking waits; woken whenever an operation is pushed or completes
+    void wait_for_work( const volatile bool *done ); // simulation thread, until work or *done
+    void wait_for_event( CUevent_st *e );            // host thread
+    void wake(); // after changing state a waiter polls (e.g. *done)
 private:
     void print_impl( FILE *fp);
 
@@ -257,6 +263,7 @@ private:
     CUstream_st m_stream_zero;
     bool m_service_stream_zero;
     pthread_mutex_t m_lock;
+    pthread_cond_t m_cond;  // state of some stream changed; waiters hold m_lock
 };
 
 #endif